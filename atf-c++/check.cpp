@@ -43,6 +43,59 @@ extern "C" {
 namespace impl = atf::check;
 #define IMPL_NAME "atf::check"
 
+// ------------------------------------------------------------------------
+// The "capture" class.
+// ------------------------------------------------------------------------
+
+impl::capture::capture(const atf_check_capture_t* c) :
+    m_bytes(atf_check_capture_bytes(c)),
+    m_lines(atf_check_capture_lines(c)),
+    m_digest(atf_check_capture_digest(c))
+{
+    std::size_t length;
+    const char* data;
+
+    data = atf_check_capture_head(c, &length);
+    m_head.assign(data, length);
+    data = atf_check_capture_tail(c, &length);
+    m_tail.assign(data, length);
+}
+
+uint64_t
+impl::capture::bytes(void)
+    const
+{
+    return m_bytes;
+}
+
+uint64_t
+impl::capture::lines(void)
+    const
+{
+    return m_lines;
+}
+
+const std::string&
+impl::capture::digest(void)
+    const
+{
+    return m_digest;
+}
+
+const std::string&
+impl::capture::head(void)
+    const
+{
+    return m_head;
+}
+
+const std::string&
+impl::capture::tail(void)
+    const
+{
+    return m_tail;
+}
+
 // ------------------------------------------------------------------------
 // The "check_result" class.
 // ------------------------------------------------------------------------
@@ -54,7 +107,8 @@ impl::check_result::check_result(const atf_check_result_t* result)
 
 impl::check_result::~check_result(void)
 {
-    atf_check_result_fini(&m_result);
+    if (m_result.pimpl != NULL)  // Not moved away.
+        atf_check_result_fini(&m_result);
 }
 
 bool
@@ -87,6 +141,50 @@ impl::check_result::termsig(void)
     return atf_check_result_termsig(&m_result);
 }
 
+bool
+impl::check_result::timedout(void)
+    const
+{
+    return atf_check_result_timedout(&m_result);
+}
+
+::timeval
+impl::check_result::wall_time(void)
+    const
+{
+    return atf_check_result_wall_time(&m_result);
+}
+
+::timeval
+impl::check_result::cpu_time(void)
+    const
+{
+    return atf_check_result_cpu_time(&m_result);
+}
+
+bool
+impl::check_result::bounded(void)
+    const
+{
+    return atf_check_result_stdout_capture(&m_result) != NULL;
+}
+
+impl::capture
+impl::check_result::stdout_capture(void)
+    const
+{
+    PRE(bounded());
+    return capture(atf_check_result_stdout_capture(&m_result));
+}
+
+impl::capture
+impl::check_result::stderr_capture(void)
+    const
+{
+    PRE(bounded());
+    return capture(atf_check_result_stderr_capture(&m_result));
+}
+
 const std::string
 impl::check_result::stdout_path(void) const
 {
@@ -156,3 +254,45 @@ impl::exec(const atf::process::argv_array& argva)
 
     return std::auto_ptr< impl::check_result >(new impl::check_result(&result));
 }
+
+std::auto_ptr< impl::check_result >
+impl::exec_tee(const atf::process::argv_array& argva, const int fd)
+{
+    atf_check_result_t result;
+
+    atf_error_t err = atf_check_exec_array_tee(argva.exec_argv(), fd, &result);
+    if (atf_is_error(err))
+        throw_atf_error(err);
+
+    return std::auto_ptr< impl::check_result >(new impl::check_result(&result));
+}
+
+std::auto_ptr< impl::check_result >
+impl::exec_timeout(const atf::process::argv_array& argva, const int fd,
+                   const ::timeval& timeout)
+{
+    atf_check_result_t result;
+
+    atf_error_t err = atf_check_exec_array_timeout(argva.exec_argv(), fd,
+                                                   &timeout, &result);
+    if (atf_is_error(err))
+        throw_atf_error(err);
+
+    return std::auto_ptr< impl::check_result >(new impl::check_result(&result));
+}
+
+std::auto_ptr< impl::check_result >
+impl::exec_bounded(const atf::process::argv_array& argva, const int fd,
+                   const ::timeval* timeout, const std::size_t limit,
+                   const int keep)
+{
+    atf_check_result_t result;
+
+    atf_error_t err = atf_check_exec_array_bounded(argva.exec_argv(), fd,
+                                                   timeout, limit, keep,
+                                                   &result);
+    if (atf_is_error(err))
+        throw_atf_error(err);
+
+    return std::auto_ptr< impl::check_result >(new impl::check_result(&result));
+}
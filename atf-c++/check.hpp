@@ -32,6 +32,7 @@
 
 extern "C" {
 #include <atf-c/check.h>
+#include <atf-c/defs.h>
 }
 
 #include <cstddef>
@@ -47,6 +48,55 @@ class argv_array;
 
 namespace check {
 
+// ------------------------------------------------------------------------
+// The "capture" class.
+// ------------------------------------------------------------------------
+
+//!
+//! \brief A bounded summary of an output stream of a command.
+//!
+//! Holds the size and digest of the stream together with its first and
+//! last bytes, as collected by exec_bounded.
+//!
+class capture {
+    uint64_t m_bytes;
+    uint64_t m_lines;
+    std::string m_digest;
+    std::string m_head;
+    std::string m_tail;
+
+public:
+    //!
+    //! \brief Copies the summary held by a C capture object.
+    //!
+    explicit capture(const atf_check_capture_t*);
+
+    //!
+    //! \brief Returns the number of bytes in the stream.
+    //!
+    uint64_t bytes(void) const;
+
+    //!
+    //! \brief Returns the number of lines in the stream.
+    //!
+    uint64_t lines(void) const;
+
+    //!
+    //! \brief Returns the SHA-256 digest of the stream in hexadecimal.
+    //!
+    const std::string& digest(void) const;
+
+    //!
+    //! \brief Returns the first bytes of the stream.
+    //!
+    const std::string& head(void) const;
+
+    //!
+    //! \brief Returns the last bytes of the stream not in the head.
+    //!
+    const std::string& tail(void) const;
+};
+
 // ------------------------------------------------------------------------
 // The "check_result" class.
 // ------------------------------------------------------------------------
@@ -76,8 +126,23 @@ class check_result {
 
     friend check_result test_constructor(const char* const*);
     friend std::auto_ptr< check_result > exec(const atf::process::argv_array&);
+    friend std::auto_ptr< check_result > exec_tee(
+        const atf::process::argv_array&, const int);
+    friend std::auto_ptr< check_result > exec_timeout(
+        const atf::process::argv_array&, const int, const ::timeval&);
+    friend std::auto_ptr< check_result > exec_bounded(
+        const atf::process::argv_array&, const int, const ::timeval*,
+        const std::size_t, const int);
 
 public:
+#if defined(ATF_DEFS_CXX_MOVE)
+    //!
+    //! \brief Takes over the files managed by another result, which can
+    //! only be destroyed afterwards.
+    //!
+    check_result(check_result&&);
+#endif
+
     //!
     //! \brief Destroys object and removes all managed files.
     //!
@@ -103,6 +168,37 @@ public:
     //!
     int termsig(void) const;
 
+    //!
+    //! \brief Returns whether the command was killed for exceeding its
+    //! timeout.
+    //!
+    bool timedout(void) const;
+
+    //!
+    //! \brief Returns the wall time used by the command.
+    //!
+    ::timeval wall_time(void) const;
+
+    //!
+    //! \brief Returns the CPU time used by the command.
+    //!
+    ::timeval cpu_time(void) const;
+
+    //!
+    //! \brief Returns whether the command was run by exec_bounded.
+    //!
+    bool bounded(void) const;
+
+    //!
+    //! \brief Returns the summary of stdout of a bounded command.
+    //!
+    capture stdout_capture(void) const;
+
+    //!
+    //! \brief Returns the summary of stderr of a bounded command.
+    //!
+    capture stderr_capture(void) const;
+
     //!
     //! \brief Returns the path to file contaning command's stdout.
     //!
@@ -114,6 +210,15 @@ public:
     const std::string stderr_path(void) const;
 };
 
+#if defined(ATF_DEFS_CXX_MOVE)
+inline
+check_result::check_result(check_result&& r) :
+    m_result(r.m_result)
+{
+    r.m_result.pimpl = NULL;
+}
+#endif
+
 // ------------------------------------------------------------------------
 // Free functions.
 // ------------------------------------------------------------------------
@@ -125,6 +230,13 @@ bool build_cpp(const std::string&, const std::string&,
 bool build_cxx_o(const std::string&, const std::string&,
                  const atf::process::argv_array&);
 std::auto_ptr< check_result > exec(const atf::process::argv_array&);
+std::auto_ptr< check_result > exec_tee(const atf::process::argv_array&,
+                                       const int);
+std::auto_ptr< check_result > exec_timeout(const atf::process::argv_array&,
+                                           const int, const ::timeval&);
+std::auto_ptr< check_result > exec_bounded(const atf::process::argv_array&,
+                                           const int, const ::timeval*,
+                                           const std::size_t, const int);
 
 // Useful for testing only.
 check_result test_constructor(void);
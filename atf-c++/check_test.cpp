@@ -39,6 +39,7 @@ extern "C" {
 #include <iostream>
 #include <list>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <atf-c++.hpp>
@@ -245,6 +246,43 @@ ATF_TEST_CASE_BODY(build_cxx_o)
     ATF_REQUIRE(atf::utils::grep_file("UNDEFINED_SYMBOL", "stderr"));
 }
 
+ATF_TEST_CASE(exec_bounded);
+ATF_TEST_CASE_HEAD(exec_bounded)
+{
+    set_md_var("descr", "Tests that exec_bounded only keeps a summary of "
+               "the output of the command");
+}
+ATF_TEST_CASE_BODY(exec_bounded)
+{
+    std::vector< std::string > argv;
+    argv.push_back("/bin/sh");
+    argv.push_back("-c");
+    argv.push_back("echo abcdefghij; echo 0123456789; echo err >&2");
+
+    atf::process::argv_array argva(argv);
+    std::auto_ptr< atf::check::check_result > r =
+        atf::check::exec_bounded(argva, -1, NULL, 4, ATF_CHECK_KEEP_STDOUT);
+    ATF_REQUIRE(r->bounded());
+
+    const atf::check::capture out = r->stdout_capture();
+    ATF_REQUIRE_EQ(22, out.bytes());
+    ATF_REQUIRE_EQ(2, out.lines());
+    ATF_REQUIRE_EQ("abcd", out.head());
+    ATF_REQUIRE_EQ("789\n", out.tail());
+    ATF_REQUIRE_EQ(64, out.digest().length());
+    ATF_REQUIRE(atf::utils::compare_file(r->stdout_path(),
+                                         "abcdefghij\n0123456789\n"));
+
+    const atf::check::capture err = r->stderr_capture();
+    ATF_REQUIRE_EQ(4, err.bytes());
+    ATF_REQUIRE_EQ("err\n", err.head());
+    ATF_REQUIRE_EQ("", err.tail());
+    ATF_REQUIRE(!atf::fs::exists(atf::fs::path(r->stderr_path())));
+
+    r = atf::check::exec(argva);
+    ATF_REQUIRE(!r->bounded());
+}
+
 ATF_TEST_CASE(exec_cleanup);
 ATF_TEST_CASE_HEAD(exec_cleanup)
 {
@@ -268,6 +306,33 @@ ATF_TEST_CASE_BODY(exec_cleanup)
     ATF_REQUIRE(!atf::fs::exists(*err.get()));
 }
 
+#if defined(ATF_DEFS_CXX_MOVE)
+ATF_TEST_CASE(exec_move);
+ATF_TEST_CASE_HEAD(exec_move)
+{
+    set_md_var("descr", "Tests that moving a check_result transfers the "
+               "ownership of its temporary files");
+}
+ATF_TEST_CASE_BODY(exec_move)
+{
+    std::auto_ptr< atf::fs::path > out;
+
+    {
+        std::auto_ptr< atf::check::check_result > r1 =
+            do_exec(this, "exit-success");
+        out.reset(new atf::fs::path(r1->stdout_path()));
+        {
+            atf::check::check_result r2(std::move(*r1));
+            r1.reset();
+            ATF_REQUIRE(atf::fs::exists(*out.get()));
+            ATF_REQUIRE(r2.exited());
+            ATF_REQUIRE_EQ(r2.stdout_path(), out->str());
+        }
+        ATF_REQUIRE(!atf::fs::exists(*out.get()));
+    }
+}
+#endif
+
 ATF_TEST_CASE(exec_exitstatus);
 ATF_TEST_CASE_HEAD(exec_exitstatus)
 {
@@ -365,6 +430,47 @@ ATF_TEST_CASE_BODY(exec_stdout_stderr)
     check_lines(err2, "stderr", "result2");
 }
 
+ATF_TEST_CASE(exec_timeout);
+ATF_TEST_CASE_HEAD(exec_timeout)
+{
+    set_md_var("descr", "Tests that exec_timeout kills a command that runs "
+               "for too long and reports its resource usage");
+}
+ATF_TEST_CASE_BODY(exec_timeout)
+{
+    std::vector< std::string > argv;
+    argv.push_back("/bin/sh");
+    argv.push_back("-c");
+    argv.push_back("sleep 30");
+
+    ::timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 500000;
+
+    {
+        atf::process::argv_array argva(argv);
+        std::auto_ptr< atf::check::check_result > r =
+            atf::check::exec_timeout(argva, -1, timeout);
+        ATF_REQUIRE(r->timedout());
+        ATF_REQUIRE(r->signaled());
+        ATF_REQUIRE_EQ(r->termsig(), SIGKILL);
+        ATF_REQUIRE(r->wall_time().tv_sec < 30);
+    }
+
+    argv[2] = "true";
+    timeout.tv_sec = 30;
+    {
+        atf::process::argv_array argva(argv);
+        std::auto_ptr< atf::check::check_result > r =
+            atf::check::exec_timeout(argva, -1, timeout);
+        ATF_REQUIRE(!r->timedout());
+        ATF_REQUIRE(r->exited());
+        ATF_REQUIRE_EQ(r->exitcode(), EXIT_SUCCESS);
+        ATF_REQUIRE(r->wall_time().tv_sec < 30);
+        ATF_REQUIRE(r->cpu_time().tv_sec < 30);
+    }
+}
+
 ATF_TEST_CASE(exec_unknown);
 ATF_TEST_CASE_HEAD(exec_unknown)
 {
@@ -398,9 +504,14 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, build_c_o);
     ATF_ADD_TEST_CASE(tcs, build_cpp);
     ATF_ADD_TEST_CASE(tcs, build_cxx_o);
+    ATF_ADD_TEST_CASE(tcs, exec_bounded);
     ATF_ADD_TEST_CASE(tcs, exec_cleanup);
     ATF_ADD_TEST_CASE(tcs, exec_exitstatus);
+#if defined(ATF_DEFS_CXX_MOVE)
+    ATF_ADD_TEST_CASE(tcs, exec_move);
+#endif
     ATF_ADD_TEST_CASE(tcs, exec_stdout_stderr);
+    ATF_ADD_TEST_CASE(tcs, exec_timeout);
     ATF_ADD_TEST_CASE(tcs, exec_unknown);
 
     // Add the test cases for the header file.
@@ -0,0 +1,417 @@
+//
+// Automated Testing Framework (atf)
+//
+// Copyright (c) 2014 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "diff.hpp"
+#include "sanity.hpp"
+
+namespace impl = atf::diff;
+#define IMPL_NAME "atf::diff"
+
+const std::size_t impl::default_max_trace = 4 * 1024 * 1024;
+
+// ------------------------------------------------------------------------
+// Auxiliary functions.
+// ------------------------------------------------------------------------
+
+typedef std::vector< int > symbols;
+
+//!
+//! \brief Maps every distinct line to an integer to speed up comparisons.
+//!
+static
+void
+intern(const std::vector< std::string >& a, std::size_t abegin,
+       std::size_t aend, const std::vector< std::string >& b,
+       std::size_t bbegin, std::size_t bend, symbols& asyms, symbols& bsyms)
+{
+    std::map< std::string, int > ids;
+
+    asyms.reserve(aend - abegin);
+    for (std::size_t i = abegin; i < aend; i++)
+        asyms.push_back(ids.insert(std::make_pair(a[i], int(ids.size())))
+                        .first->second);
+
+    bsyms.reserve(bend - bbegin);
+    for (std::size_t i = bbegin; i < bend; i++)
+        bsyms.push_back(ids.insert(std::make_pair(b[i], int(ids.size())))
+                        .first->second);
+}
+
+//!
+//! \brief Computes the edit script using the greedy forward search.
+//!
+//! Keeps a copy of the furthest reaching paths of every step so that the
+//! script can be rebuilt by walking them backwards.  Returns false without
+//! touching the script if doing so would need more than max_trace entries.
+//!
+static
+bool
+compute_with_trace(const symbols& a, const symbols& b,
+                   const std::size_t max_trace, impl::edit_script& script)
+{
+    const int n = int(a.size());
+    const int m = int(b.size());
+    const int max = n + m;
+
+    // The trace of step d holds the diagonals in [-(d + 1), d + 1] of the
+    // paths found up to step d - 1, starting at offset d * (d + 2).
+    std::vector< int > trace;
+    std::vector< int > v(2 * max + 3, 0);
+    const int voff = max + 1;
+
+    int d;
+    bool done = false;
+    for (d = 0; !done && d <= max; d++) {
+        const std::size_t needed = std::size_t(d + 1) * std::size_t(d + 3);
+        if (needed > max_trace)
+            return false;
+        trace.insert(trace.end(), v.begin() + voff - (d + 1),
+                     v.begin() + voff + d + 2);
+
+        for (int k = -d; !done && k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && v[voff + k - 1] < v[voff + k + 1]))
+                x = v[voff + k + 1];
+            else
+                x = v[voff + k - 1] + 1;
+            int y = x - k;
+
+            while (x < n && y < m && a[x] == b[y]) {
+                x++;
+                y++;
+            }
+            v[voff + k] = x;
+
+            done = x >= n && y >= m;
+        }
+    }
+    INV(done);
+
+    impl::edit_script reversed;
+    int x = n;
+    int y = m;
+    for (d = d - 1; d >= 0; d--) {
+        const int* t = &trace[std::size_t(d) * std::size_t(d + 2)] + d + 1;
+        const int k = x - y;
+
+        int prev_k;
+        if (k == -d || (k != d && t[k - 1] < t[k + 1]))
+            prev_k = k + 1;
+        else
+            prev_k = k - 1;
+        const int prev_x = t[prev_k];
+        const int prev_y = prev_x - prev_k;
+
+        while (x > prev_x && y > prev_y) {
+            reversed.push_back(impl::edit_keep);
+            x--;
+            y--;
+        }
+
+        if (d > 0)
+            reversed.push_back(x == prev_x ? impl::edit_insert :
+                               impl::edit_delete);
+
+        x = prev_x;
+        y = prev_y;
+    }
+
+    script.insert(script.end(), reversed.rbegin(), reversed.rend());
+    return true;
+}
+
+//!
+//! \brief Finds a point in the middle of an optimal path between two
+//! ranges.
+//!
+//! Runs the forward and backward searches simultaneously until they
+//! overlap.  The ranges must be non-empty and must not have common
+//! prefixes nor suffixes, which guarantees that both halves of the split
+//! are strictly cheaper than the whole.  Returns the split point as a
+//! pair of positions in a and b.
+//!
+static
+std::pair< int, int >
+find_middle(const symbols& a, const int a0, const int a1,
+            const symbols& b, const int b0, const int b1)
+{
+    const int n = a1 - a0;
+    const int m = b1 - b0;
+    const int delta = n - m;
+    const bool odd = (delta % 2) != 0;
+    const int max = (n + m + 1) / 2;
+    const int off = max + 1;
+
+    std::vector< int > vf(2 * max + 3, 0);
+    std::vector< int > vb(2 * max + 3, 0);
+    vf[off + 1] = 0;
+    vb[off + 1] = m;
+
+    for (int d = 0; d <= max; d++) {
+        for (int k = d; k >= -d; k -= 2) {
+            int x;
+            if (k == -d || (k != d && vf[off + k - 1] < vf[off + k + 1]))
+                x = vf[off + k + 1];
+            else
+                x = vf[off + k - 1] + 1;
+            int y = x - k;
+
+            while (x < n && y < m && a[a0 + x] == b[b0 + y]) {
+                x++;
+                y++;
+            }
+            vf[off + k] = x;
+
+            const int c = k - delta;
+            if (odd && c >= -(d - 1) && c <= d - 1 && y >= vb[off + c]) {
+                return std::make_pair(a0 + x, b0 + y);
+            }
+        }
+
+        for (int c = d; c >= -d; c -= 2) {
+            int y;
+            if (c == -d || (c != d && vb[off + c - 1] > vb[off + c + 1]))
+                y = vb[off + c + 1];
+            else
+                y = vb[off + c - 1] - 1;
+            const int k = c + delta;
+            int x = y + k;
+
+            while (x > 0 && y > 0 && a[a0 + x - 1] == b[b0 + y - 1]) {
+                x--;
+                y--;
+            }
+            vb[off + c] = y;
+
+            if (!odd && k >= -d && k <= d && x <= vf[off + k]) {
+                return std::make_pair(a0 + x, b0 + y);
+            }
+        }
+    }
+    UNREACHABLE;
+
+    // Splitting both ranges in half is not optimal but still progresses.
+    return std::make_pair(a0 + (n + 1) / 2, b0 + m / 2);
+}
+
+//!
+//! \brief Computes the edit script using the linear-space search.
+//!
+static
+void
+compute_linear(const symbols& a, int a0, int a1, const symbols& b, int b0,
+               int b1, impl::edit_script& script)
+{
+    while (a0 < a1 && b0 < b1 && a[a0] == b[b0]) {
+        script.push_back(impl::edit_keep);
+        a0++;
+        b0++;
+    }
+
+    int suffix = 0;
+    while (a0 < a1 && b0 < b1 && a[a1 - 1] == b[b1 - 1]) {
+        suffix++;
+        a1--;
+        b1--;
+    }
+
+    if (a0 == a1)
+        script.insert(script.end(), std::size_t(b1 - b0), impl::edit_insert);
+    else if (b0 == b1)
+        script.insert(script.end(), std::size_t(a1 - a0), impl::edit_delete);
+    else {
+        const std::pair< int, int > split =
+            find_middle(a, a0, a1, b, b0, b1);
+        compute_linear(a, a0, split.first, b, b0, split.second, script);
+        compute_linear(a, split.first, a1, b, split.second, b1, script);
+    }
+
+    script.insert(script.end(), std::size_t(suffix), impl::edit_keep);
+}
+
+//!
+//! \brief Formats a range of lines as used in the hunk headers.
+//!
+static
+void
+print_range(std::ostream& os, const std::size_t start,
+            const std::size_t count)
+{
+    if (count == 1)
+        os << start + 1;
+    else if (count == 0)
+        os << start << ",0";
+    else
+        os << start + 1 << "," << count;
+}
+
+static
+void
+print_line(std::ostream& os, const char prefix, const std::string& line)
+{
+    os << prefix << line;
+    if (line.empty() || line[line.length() - 1] != '\n')
+        os << "\n\\ No newline at end of file\n";
+}
+
+// ------------------------------------------------------------------------
+// Free functions.
+// ------------------------------------------------------------------------
+
+std::vector< std::string >
+impl::read_lines(std::istream& is)
+{
+    std::vector< std::string > lines;
+
+    std::string line;
+    while (std::getline(is, line).good()) {
+        line += '\n';
+        lines.push_back(line);
+    }
+    if (!line.empty() && is.eof())
+        lines.push_back(line);
+
+    return lines;
+}
+
+impl::edit_script
+impl::compute(const std::vector< std::string >& a,
+              const std::vector< std::string >& b,
+              const std::size_t max_trace)
+{
+    edit_script script;
+
+    std::size_t prefix = 0;
+    while (prefix < a.size() && prefix < b.size() && a[prefix] == b[prefix])
+        prefix++;
+
+    std::size_t suffix = 0;
+    while (suffix < a.size() - prefix && suffix < b.size() - prefix &&
+           a[a.size() - suffix - 1] == b[b.size() - suffix - 1])
+        suffix++;
+
+    script.reserve(a.size() + b.size() - prefix - suffix);
+    script.insert(script.end(), prefix, edit_keep);
+
+    symbols asyms, bsyms;
+    intern(a, prefix, a.size() - suffix, b, prefix, b.size() - suffix,
+           asyms, bsyms);
+
+    if (!compute_with_trace(asyms, bsyms, max_trace, script))
+        compute_linear(asyms, 0, int(asyms.size()), bsyms, 0,
+                       int(bsyms.size()), script);
+
+    script.insert(script.end(), suffix, edit_keep);
+
+    return script;
+}
+
+std::size_t
+impl::unified(std::ostream& os, const std::string& alabel,
+              const std::vector< std::string >& a, const std::string& blabel,
+              const std::vector< std::string >& b, const std::size_t context,
+              const std::size_t max_hunks)
+{
+    const edit_script script = compute(a, b);
+
+    // Indexes into the script of the first and past-the-last entries of
+    // every hunk, including their context.
+    std::vector< std::pair< std::size_t, std::size_t > > hunks;
+    for (std::size_t i = 0; i < script.size(); i++) {
+        if (script[i] == edit_keep)
+            continue;
+
+        const std::size_t begin = i > context ? i - context : 0;
+        std::size_t last = i;
+        for (std::size_t j = i + 1; j < script.size() &&
+             j - last <= 2 * context + 1; j++) {
+            if (script[j] != edit_keep)
+                last = j;
+        }
+        const std::size_t end = std::min(script.size(), last + 1 + context);
+
+        hunks.push_back(std::make_pair(begin, end));
+        i = last;
+    }
+
+    if (hunks.empty())
+        return 0;
+
+    os << "--- " << alabel << "\n";
+    os << "+++ " << blabel << "\n";
+
+    std::size_t apos = 0, bpos = 0, spos = 0;
+    for (std::size_t h = 0; h < hunks.size() &&
+         (max_hunks == 0 || h < max_hunks); h++) {
+        for (; spos < hunks[h].first; spos++) {
+            if (script[spos] != edit_insert)
+                apos++;
+            if (script[spos] != edit_delete)
+                bpos++;
+        }
+
+        std::size_t acount = 0, bcount = 0;
+        for (std::size_t i = hunks[h].first; i < hunks[h].second; i++) {
+            if (script[i] != edit_insert)
+                acount++;
+            if (script[i] != edit_delete)
+                bcount++;
+        }
+
+        os << "@@ -";
+        print_range(os, apos, acount);
+        os << " +";
+        print_range(os, bpos, bcount);
+        os << " @@\n";
+
+        for (; spos < hunks[h].second; spos++) {
+            switch (script[spos]) {
+            case edit_keep:
+                print_line(os, ' ', a[apos++]);
+                bpos++;
+                break;
+            case edit_delete:
+                print_line(os, '-', a[apos++]);
+                break;
+            case edit_insert:
+                print_line(os, '+', b[bpos++]);
+                break;
+            }
+        }
+    }
+
+    if (max_hunks != 0 && hunks.size() > max_hunks)
+        os << "[" << hunks.size() - max_hunks << " more hunks not shown]\n";
+
+    return hunks.size();
+}
@@ -0,0 +1,105 @@
+//
+// Automated Testing Framework (atf)
+//
+// Copyright (c) 2014 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#if !defined(_ATF_CXX_DIFF_HPP_)
+#define _ATF_CXX_DIFF_HPP_
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace atf {
+namespace diff {
+
+//!
+//! \brief The operations that can appear in an edit script.
+//!
+enum edit_type {
+    edit_keep,
+    edit_delete,
+    edit_insert
+};
+
+//!
+//! \brief A sequence of operations that transforms one text into another.
+//!
+//! Every entry applies to a single line: keep and delete entries consume a
+//! line of the old text, while keep and insert entries consume a line of
+//! the new text.
+//!
+typedef std::vector< edit_type > edit_script;
+
+//!
+//! \brief The default memory budget for compute, in number of entries.
+//!
+extern const std::size_t default_max_trace;
+
+//!
+//! \brief Splits a stream into lines.
+//!
+//! The lines keep their terminating newline character, if any, so that a
+//! missing newline at the end of the input shows up as a difference.
+//!
+std::vector< std::string > read_lines(std::istream&);
+
+//!
+//! \brief Computes the shortest edit script between two texts.
+//!
+//! Uses Myers' O(ND) algorithm after discarding the common prefix and
+//! suffix of the inputs.  The state of every step is kept in memory to
+//! rebuild the script at the end as long as it fits within the given
+//! number of entries; beyond that, the linear-space variant of the
+//! algorithm is used instead, which is slower but whose memory usage does
+//! not depend on the number of differences.
+//!
+edit_script compute(const std::vector< std::string >&,
+                    const std::vector< std::string >&,
+                    const std::size_t = default_max_trace);
+
+//!
+//! \brief Prints the differences between two texts in unified format.
+//!
+//! Prints nothing if the texts are equal.  Otherwise, prints a header
+//! with the given labels followed by up to max_hunks hunks, each with the
+//! given number of context lines; a max_hunks of 0 means no limit.
+//!
+//! Returns the total number of hunks, which can be larger than the number
+//! of hunks printed.
+//!
+std::size_t unified(std::ostream&, const std::string&,
+                    const std::vector< std::string >&, const std::string&,
+                    const std::vector< std::string >&,
+                    const std::size_t = 3, const std::size_t = 0);
+
+} // namespace diff
+} // namespace atf
+
+#endif // !defined(_ATF_CXX_DIFF_HPP_)
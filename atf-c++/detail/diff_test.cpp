@@ -0,0 +1,278 @@
+//
+// Automated Testing Framework (atf)
+//
+// Copyright (c) 2014 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../macros.hpp"
+
+#include "diff.hpp"
+
+// ------------------------------------------------------------------------
+// Auxiliary functions.
+// ------------------------------------------------------------------------
+
+static
+std::vector< std::string >
+lines(const std::string& text)
+{
+    std::istringstream is(text);
+    return atf::diff::read_lines(is);
+}
+
+//!
+//! \brief Checks that an edit script transforms a text into another and
+//! returns its number of insertions and deletions.
+//!
+static
+std::size_t
+apply(const std::vector< std::string >& a,
+      const std::vector< std::string >& b,
+      const atf::diff::edit_script& script)
+{
+    std::vector< std::string > result;
+    std::size_t apos = 0, bpos = 0, cost = 0;
+
+    for (atf::diff::edit_script::const_iterator iter = script.begin();
+         iter != script.end(); iter++) {
+        switch (*iter) {
+        case atf::diff::edit_keep:
+            ATF_REQUIRE(apos < a.size() && bpos < b.size());
+            ATF_REQUIRE_EQ(a[apos], b[bpos]);
+            result.push_back(a[apos]);
+            apos++;
+            bpos++;
+            break;
+        case atf::diff::edit_delete:
+            ATF_REQUIRE(apos < a.size());
+            apos++;
+            cost++;
+            break;
+        case atf::diff::edit_insert:
+            ATF_REQUIRE(bpos < b.size());
+            result.push_back(b[bpos]);
+            bpos++;
+            cost++;
+            break;
+        }
+    }
+    ATF_REQUIRE_EQ(apos, a.size());
+    ATF_REQUIRE(result == b);
+
+    return cost;
+}
+
+static
+std::string
+unified(const std::string& a, const std::string& b,
+        const std::size_t max_hunks = 0)
+{
+    std::ostringstream os;
+    atf::diff::unified(os, "old", lines(a), "new", lines(b), 3, max_hunks);
+    return os.str();
+}
+
+static
+std::string
+numbered_lines(const std::size_t first, const std::size_t last)
+{
+    std::ostringstream os;
+    for (std::size_t i = first; i <= last; i++)
+        os << i << "\n";
+    return os.str();
+}
+
+// ------------------------------------------------------------------------
+// Test cases for the free functions.
+// ------------------------------------------------------------------------
+
+ATF_TEST_CASE_WITHOUT_HEAD(read_lines);
+ATF_TEST_CASE_BODY(read_lines)
+{
+    ATF_REQUIRE(lines("").empty());
+
+    std::vector< std::string > exp;
+    exp.push_back("foo\n");
+    exp.push_back("\n");
+    exp.push_back("bar\n");
+    ATF_REQUIRE(lines("foo\n\nbar\n") == exp);
+
+    exp.back() = "bar";
+    ATF_REQUIRE(lines("foo\n\nbar") == exp);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(compute_trivial);
+ATF_TEST_CASE_BODY(compute_trivial)
+{
+    using atf::diff::compute;
+
+    ATF_REQUIRE(compute(lines(""), lines("")).empty());
+    ATF_REQUIRE_EQ(apply(lines("a\nb\n"), lines("a\nb\n"),
+                         compute(lines("a\nb\n"), lines("a\nb\n"))), 0);
+    ATF_REQUIRE_EQ(apply(lines(""), lines("a\nb\n"),
+                         compute(lines(""), lines("a\nb\n"))), 2);
+    ATF_REQUIRE_EQ(apply(lines("a\nb\n"), lines(""),
+                         compute(lines("a\nb\n"), lines(""))), 2);
+    ATF_REQUIRE_EQ(apply(lines("a\nb"), lines("a\nb\n"),
+                         compute(lines("a\nb"), lines("a\nb\n"))), 2);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(compute_shortest);
+ATF_TEST_CASE_BODY(compute_shortest)
+{
+    using atf::diff::compute;
+
+    // The example from Myers' paper, whose shortest edit script has 5
+    // operations.
+    const std::vector< std::string > a = lines("a\nb\nc\na\nb\nb\na\n");
+    const std::vector< std::string > b = lines("c\nb\na\nb\na\nc\n");
+
+    ATF_REQUIRE_EQ(apply(a, b, compute(a, b)), 5);
+    ATF_REQUIRE_EQ(apply(a, b, compute(a, b, 0)), 5);
+    ATF_REQUIRE_EQ(apply(b, a, compute(b, a, 0)), 5);
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(compute_linear_space);
+ATF_TEST_CASE_BODY(compute_linear_space)
+{
+    using atf::diff::compute;
+
+    std::srand(1234);
+    for (int i = 0; i < 200; i++) {
+        std::vector< std::string > a, b;
+
+        const int alen = std::rand() % 40;
+        for (int j = 0; j < alen; j++)
+            a.push_back(std::string(1, char('a' + std::rand() % 4)));
+        const int blen = std::rand() % 40;
+        for (int j = 0; j < blen; j++)
+            b.push_back(std::string(1, char('a' + std::rand() % 4)));
+
+        const std::size_t cost = apply(a, b, compute(a, b));
+        ATF_REQUIRE_EQ(apply(a, b, compute(a, b, 0)), cost);
+        ATF_REQUIRE_EQ(apply(a, b, compute(a, b, 10)), cost);
+    }
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(unified_equal);
+ATF_TEST_CASE_BODY(unified_equal)
+{
+    ATF_REQUIRE_EQ(unified("", ""), "");
+    ATF_REQUIRE_EQ(unified("foo\nbar\n", "foo\nbar\n"), "");
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(unified_format);
+ATF_TEST_CASE_BODY(unified_format)
+{
+    ATF_REQUIRE_EQ(unified("", "foo\n"),
+                   "--- old\n"
+                   "+++ new\n"
+                   "@@ -0,0 +1 @@\n"
+                   "+foo\n");
+
+    ATF_REQUIRE_EQ(unified(numbered_lines(1, 10),
+                           "1\n2\n3\n4\n5\nfive\n6\n7\n8\n9\n10\n"),
+                   "--- old\n"
+                   "+++ new\n"
+                   "@@ -3,6 +3,7 @@\n"
+                   " 3\n 4\n 5\n+five\n 6\n 7\n 8\n");
+
+    ATF_REQUIRE_EQ(unified("a\nb\n", "a\nc"),
+                   "--- old\n"
+                   "+++ new\n"
+                   "@@ -1,2 +1,2 @@\n"
+                   " a\n"
+                   "-b\n"
+                   "+c\n"
+                   "\\ No newline at end of file\n");
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(unified_hunks);
+ATF_TEST_CASE_BODY(unified_hunks)
+{
+    // Changes separated by up to twice the context are merged.
+    ATF_REQUIRE_EQ(unified(numbered_lines(1, 10),
+                           "1\nX\n3\n4\n5\n6\n7\nY\n9\n10\n"),
+                   "--- old\n"
+                   "+++ new\n"
+                   "@@ -1,10 +1,10 @@\n"
+                   " 1\n-2\n+X\n 3\n 4\n 5\n 6\n 7\n-8\n+Y\n 9\n 10\n");
+
+    ATF_REQUIRE_EQ(unified(numbered_lines(1, 12),
+                           "X\n2\n3\n4\n5\n6\n7\n8\n9\n10\n11\nY\n"),
+                   "--- old\n"
+                   "+++ new\n"
+                   "@@ -1,4 +1,4 @@\n"
+                   "-1\n+X\n 2\n 3\n 4\n"
+                   "@@ -9,4 +9,4 @@\n"
+                   " 9\n 10\n 11\n-12\n+Y\n");
+
+    ATF_REQUIRE_EQ(unified(numbered_lines(1, 12),
+                           "X\n2\n3\n4\n5\n6\n7\n8\n9\n10\n11\nY\n", 1),
+                   "--- old\n"
+                   "+++ new\n"
+                   "@@ -1,4 +1,4 @@\n"
+                   "-1\n+X\n 2\n 3\n 4\n"
+                   "[1 more hunks not shown]\n");
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(unified_large);
+ATF_TEST_CASE_BODY(unified_large)
+{
+    // Big enough to exceed the default budget of the trace-based search.
+    const std::string a = numbered_lines(1, 4000);
+    const std::string b = numbered_lines(2001, 6000);
+
+    std::ostringstream os;
+    ATF_REQUIRE_EQ(atf::diff::unified(os, "old", lines(a), "new", lines(b)),
+                   2);
+    ATF_REQUIRE(os.str().find("@@ -1,2003 +1,3 @@\n-1\n-2\n") !=
+                std::string::npos);
+    ATF_REQUIRE(os.str().find("@@ -3998,3 +1998,2003 @@\n 3998\n") !=
+                std::string::npos);
+}
+
+// ------------------------------------------------------------------------
+// Main.
+// ------------------------------------------------------------------------
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    // Add the test cases for the free functions.
+    ATF_ADD_TEST_CASE(tcs, read_lines);
+    ATF_ADD_TEST_CASE(tcs, compute_trivial);
+    ATF_ADD_TEST_CASE(tcs, compute_shortest);
+    ATF_ADD_TEST_CASE(tcs, compute_linear_space);
+    ATF_ADD_TEST_CASE(tcs, unified_equal);
+    ATF_ADD_TEST_CASE(tcs, unified_format);
+    ATF_ADD_TEST_CASE(tcs, unified_hunks);
+    ATF_ADD_TEST_CASE(tcs, unified_large);
+}
@@ -305,6 +305,11 @@ impl::file_info::file_info(const path& p)
         throw_atf_error(err);
 }
 
+impl::file_info::file_info(const atf_fs_stat_t *st)
+{
+    atf_fs_stat_copy(&m_stat, st);
+}
+
 impl::file_info::file_info(const file_info& fi)
 {
     atf_fs_stat_copy(&m_stat, &fi.m_stat);
@@ -336,6 +341,13 @@ impl::file_info::get_mode(void)
     return atf_fs_stat_get_mode(&m_stat);
 }
 
+time_t
+impl::file_info::get_mtime(void)
+    const
+{
+    return atf_fs_stat_get_mtime(&m_stat);
+}
+
 off_t
 impl::file_info::get_size(void)
     const
@@ -414,25 +426,95 @@ impl::file_info::is_other_executable(void)
 }
 
 // ------------------------------------------------------------------------
-// The "directory" class.
+// The "directory_reader" class.
 // ------------------------------------------------------------------------
 
-impl::directory::directory(const path& p)
+impl::directory_reader::directory_reader(const path& p) :
+    m_path(p),
+    m_entry(NULL)
 {
-    DIR* dp = ::opendir(p.c_str());
-    if (dp == NULL)
-        throw system_error(IMPL_NAME "::directory::directory(" +
+    m_dir = ::opendir(p.c_str());
+    if (m_dir == NULL)
+        throw system_error(IMPL_NAME "::directory_reader::directory_reader(" +
                            p.str() + ")", "opendir(3) failed", errno);
+}
+
+impl::directory_reader::~directory_reader(void)
+{
+    (void)::closedir(m_dir);
+}
 
-    struct dirent* dep;
-    while ((dep = ::readdir(dp)) != NULL) {
-        path entryp = p / dep->d_name;
-        insert(value_type(dep->d_name, file_info(entryp)));
+bool
+impl::directory_reader::next(void)
+{
+    errno = 0;
+    m_entry = ::readdir(m_dir);
+    if (m_entry == NULL && errno != 0)
+        throw system_error(IMPL_NAME "::directory_reader::next(" +
+                           m_path.str() + ")", "readdir(3) failed", errno);
+    return m_entry != NULL;
+}
+
+const char*
+impl::directory_reader::name(void)
+    const
+{
+    PRE(m_entry != NULL);
+    return m_entry->d_name;
+}
+
+int
+impl::directory_reader::type(void)
+    const
+{
+    PRE(m_entry != NULL);
+
+#if defined(DT_UNKNOWN)
+    switch (m_entry->d_type) {
+    case DT_BLK:  return file_info::blk_type;
+    case DT_CHR:  return file_info::chr_type;
+    case DT_DIR:  return file_info::dir_type;
+    case DT_FIFO: return file_info::fifo_type;
+    case DT_LNK:  return file_info::lnk_type;
+    case DT_REG:  return file_info::reg_type;
+    case DT_SOCK: return file_info::sock_type;
+#if defined(DT_WHT)
+    case DT_WHT:  return file_info::wht_type;
+#endif
+    default:
+        break;
     }
+#endif
+
+    return stat().get_type();
+}
+
+impl::file_info
+impl::directory_reader::stat(void)
+    const
+{
+    PRE(m_entry != NULL);
+
+    atf_fs_stat_t st;
+    atf_error_t err = atf_fs_stat_init_at(&st, ::dirfd(m_dir),
+                                          m_entry->d_name);
+    if (atf_is_error(err))
+        throw_atf_error(err);
+
+    const file_info fi(&st);
+    atf_fs_stat_fini(&st);
+    return fi;
+}
 
-    if (::closedir(dp) == -1)
-        throw system_error(IMPL_NAME "::directory::directory(" +
-                           p.str() + ")", "closedir(3) failed", errno);
+// ------------------------------------------------------------------------
+// The "directory" class.
+// ------------------------------------------------------------------------
+
+impl::directory::directory(const path& p)
+{
+    directory_reader reader(p);
+    while (reader.next())
+        insert(end(), value_type(reader.name(), reader.stat()));
 }
 
 std::set< std::string >
@@ -515,3 +597,11 @@ impl::rmdir(const path& p)
     if (atf_is_error(err))
         throw_atf_error(err);
 }
+
+void
+impl::remove_tree(const path& p)
+{
+    atf_error_t err = atf_fs_rmtree(p.c_path());
+    if (atf_is_error(err))
+        throw_atf_error(err);
+}
@@ -32,6 +32,9 @@
 
 extern "C" {
 #include <sys/types.h>
+#include <dirent.h>
+
+#include <atf-c/defs.h>
 }
 
 #include <map>
@@ -42,9 +45,12 @@ extern "C" {
 #include <string>
 
 extern "C" {
+#include "../../atf-c/error.h"
 #include "../../atf-c/detail/fs.h"
 }
 
+#include "exceptions.hpp"
+
 namespace atf {
 
 namespace io {
@@ -96,6 +102,23 @@ public:
     //!
     path(const atf_fs_path_t *);
 
+#if defined(ATF_DEFS_CXX_MOVE)
+    //!
+    //! \brief Move constructor.
+    //!
+    //! Takes over the buffer of the given path, which is left pointing to
+    //! the current directory.
+    //!
+    path(path&&);
+
+    //!
+    //! \brief Move assignment operator.
+    //!
+    //! Swaps the contents of both paths without copying them.
+    //!
+    path& operator=(path&&);
+#endif
+
     //!
     //! \brief Destructor for the path class.
     //!
@@ -199,6 +222,30 @@ public:
     bool operator<(const path&) const;
 };
 
+#if defined(ATF_DEFS_CXX_MOVE)
+inline
+path::path(path&& p)
+{
+    atf_fs_path_t tmp;
+    atf_error_t err = atf_fs_path_init_fmt(&tmp, ".");
+    if (atf_is_error(err))
+        throw_atf_error(err);
+
+    m_path = p.m_path;
+    p.m_path = tmp;
+}
+
+inline
+path&
+path::operator=(path&& p)
+{
+    const atf_fs_path_t tmp = m_path;
+    m_path = p.m_path;
+    p.m_path = tmp;
+    return *this;
+}
+#endif
+
 // ------------------------------------------------------------------------
 // The "file_info" class.
 // ------------------------------------------------------------------------
@@ -236,6 +283,11 @@ public:
     //!
     explicit file_info(const path&);
 
+    //!
+    //! \brief Constructs a new file_info from already gathered data.
+    //!
+    file_info(const atf_fs_stat_t *);
+
     //!
     //! \brief The copy constructor.
     //!
@@ -261,6 +313,11 @@ public:
     //!
     mode_t get_mode(void) const;
 
+    //!
+    //! \brief Returns the file's last modification time.
+    //!
+    time_t get_mtime(void) const;
+
     //!
     //! \brief Returns the file's size.
     //!
@@ -323,6 +380,73 @@ public:
     bool is_other_executable(void) const;
 };
 
+// ------------------------------------------------------------------------
+// The "directory_reader" class.
+// ------------------------------------------------------------------------
+
+//!
+//! \brief A class to walk over the entries of a directory one at a time.
+//!
+//! Unlike the directory class, the directory_reader class does not load
+//! the whole directory in memory and only queries the file system for the
+//! details of an entry when they are requested.  As with directory, the
+//! entries include '.' and '..'.
+//!
+class directory_reader {
+    // Non-copyable.
+    directory_reader(const directory_reader&);
+    directory_reader& operator=(const directory_reader&);
+
+    path m_path;
+    ::DIR* m_dir;
+    const struct dirent* m_entry;
+
+public:
+    //!
+    //! \brief Opens the given directory for reading.
+    //!
+    //! The reader is positioned before the first entry, so next must be
+    //! called before querying any entry.
+    //!
+    explicit directory_reader(const path&);
+
+    //!
+    //! \brief Closes the directory.
+    //!
+    ~directory_reader(void);
+
+    //!
+    //! \brief Moves to the next entry of the directory.
+    //!
+    //! Returns false once there are no more entries.
+    //!
+    bool next(void);
+
+    //!
+    //! \brief Returns the leaf name of the current entry.
+    //!
+    //! The returned string is only valid until the next call to next.
+    //!
+    const char* name(void) const;
+
+    //!
+    //! \brief Returns the type of the current entry.
+    //!
+    //! The type is one of the file_info type constants.  It comes from
+    //! readdir(3) when the file system provides it, so the entry is only
+    //! stat'ed when it does not.
+    //!
+    int type(void) const;
+
+    //!
+    //! \brief Returns the details of the current entry.
+    //!
+    //! The entry is stat'ed relative to the open directory, without
+    //! building its full path.
+    //!
+    file_info stat(void) const;
+};
+
 // ------------------------------------------------------------------------
 // The "directory" class.
 // ------------------------------------------------------------------------
@@ -385,6 +509,11 @@ void remove(const path&);
 //!
 void rmdir(const path&);
 
+//!
+//! \brief Removes a file or a directory and all of its contents.
+//!
+void remove_tree(const path&);
+
 } // namespace fs
 } // namespace atf
 
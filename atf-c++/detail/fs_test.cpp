@@ -30,11 +30,13 @@
 extern "C" {
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <utime.h>
 }
 
 #include <fstream>
 #include <cerrno>
 #include <cstdio>
+#include <utility>
 
 #include "../macros.hpp"
 
@@ -260,6 +262,32 @@ ATF_TEST_CASE_BODY(path_op_less)
     ATF_REQUIRE(!(path("abc") < path("aab")));
 }
 
+#if defined(ATF_DEFS_CXX_MOVE)
+ATF_TEST_CASE(path_move);
+ATF_TEST_CASE_HEAD(path_move)
+{
+    set_md_var("descr", "Tests that moving a path takes over its contents");
+}
+ATF_TEST_CASE_BODY(path_move)
+{
+    using atf::fs::path;
+
+    path p1("/some/long/path");
+    const char* buffer = p1.c_str();
+
+    path p2(std::move(p1));
+    ATF_REQUIRE_EQ(p2.str(), "/some/long/path");
+    ATF_REQUIRE_EQ(p2.c_str(), buffer);
+    ATF_REQUIRE_EQ(p1.str(), ".");
+
+    path p3("other");
+    p3 = std::move(p2);
+    ATF_REQUIRE_EQ(p3.str(), "/some/long/path");
+    ATF_REQUIRE_EQ(p3.c_str(), buffer);
+    ATF_REQUIRE_EQ(p2.str(), "other");
+}
+#endif
+
 // ------------------------------------------------------------------------
 // Test cases for the "directory" class.
 // ------------------------------------------------------------------------
@@ -285,6 +313,44 @@ ATF_TEST_CASE_BODY(directory_read)
     ATF_REQUIRE(d.find("reg") != d.end());
 }
 
+ATF_TEST_CASE(directory_reader);
+ATF_TEST_CASE_HEAD(directory_reader)
+{
+    set_md_var("descr", "Tests that the directory_reader class walks over "
+               "all the entries of a directory and reports their details");
+}
+ATF_TEST_CASE_BODY(directory_reader)
+{
+    using atf::fs::directory_reader;
+    using atf::fs::file_info;
+    using atf::fs::path;
+
+    create_files();
+
+    std::set< std::string > names;
+    directory_reader reader(path("files"));
+    while (reader.next()) {
+        const std::string name = reader.name();
+        names.insert(name);
+
+        const file_info fi = reader.stat();
+        ATF_REQUIRE_EQ(reader.type(), fi.get_type());
+        if (name == "reg")
+            ATF_REQUIRE(fi.get_type() == file_info::reg_type);
+        else
+            ATF_REQUIRE(fi.get_type() == file_info::dir_type);
+    }
+    ATF_REQUIRE(!reader.next());
+
+    ATF_REQUIRE_EQ(names.size(), 4);
+    ATF_REQUIRE(names.find(".") != names.end());
+    ATF_REQUIRE(names.find("..") != names.end());
+    ATF_REQUIRE(names.find("dir") != names.end());
+    ATF_REQUIRE(names.find("reg") != names.end());
+
+    ATF_REQUIRE_THROW(atf::system_error, directory_reader(path("missing")));
+}
+
 ATF_TEST_CASE(directory_file_info);
 ATF_TEST_CASE_HEAD(directory_file_info)
 {
@@ -364,6 +430,16 @@ ATF_TEST_CASE_BODY(file_info_stat)
         file_info fi(p);
         ATF_REQUIRE(fi.get_type() == file_info::reg_type);
     }
+
+    {
+        struct utimbuf times;
+        times.actime = 1000000000;
+        times.modtime = 1234567890;
+        ATF_REQUIRE(::utime("files/reg", &times) != -1);
+
+        file_info fi(path("files/reg"));
+        ATF_REQUIRE_EQ(1234567890, fi.get_mtime());
+    }
 }
 
 ATF_TEST_CASE(file_info_perms);
@@ -511,6 +587,27 @@ ATF_TEST_CASE_BODY(remove)
     ATF_REQUIRE( exists(path("files/dir")));
 }
 
+ATF_TEST_CASE(remove_tree);
+ATF_TEST_CASE_HEAD(remove_tree)
+{
+    set_md_var("descr", "Tests the remove_tree function");
+}
+ATF_TEST_CASE_BODY(remove_tree)
+{
+    using atf::fs::exists;
+    using atf::fs::path;
+    using atf::fs::remove_tree;
+
+    create_files();
+    ATF_REQUIRE(::mkdir("files/dir/sub", 0755) != -1);
+    ATF_REQUIRE(::chmod("files/dir", 0555) != -1);
+
+    remove_tree(path("files"));
+    ATF_REQUIRE(!exists(path("files")));
+
+    ATF_REQUIRE_THROW(atf::system_error, remove_tree(path("files")));
+}
+
 // ------------------------------------------------------------------------
 // Main.
 // ------------------------------------------------------------------------
@@ -528,6 +625,9 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, path_concat);
     ATF_ADD_TEST_CASE(tcs, path_to_absolute);
     ATF_ADD_TEST_CASE(tcs, path_op_less);
+#if defined(ATF_DEFS_CXX_MOVE)
+    ATF_ADD_TEST_CASE(tcs, path_move);
+#endif
 
     // Add the tests for the "file_info" class.
     ATF_ADD_TEST_CASE(tcs, file_info_stat);
@@ -537,9 +637,11 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, directory_read);
     ATF_ADD_TEST_CASE(tcs, directory_names);
     ATF_ADD_TEST_CASE(tcs, directory_file_info);
+    ATF_ADD_TEST_CASE(tcs, directory_reader);
 
     // Add the tests for the free functions.
     ATF_ADD_TEST_CASE(tcs, exists);
     ATF_ADD_TEST_CASE(tcs, is_executable);
     ATF_ADD_TEST_CASE(tcs, remove);
+    ATF_ADD_TEST_CASE(tcs, remove_tree);
 }
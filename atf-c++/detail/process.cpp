@@ -231,6 +231,55 @@ impl::stream_redirect_path::stream_redirect_path(const fs::path& p)
     m_inited = true;
 }
 
+impl::stream_tee::stream_tee(const fs::path& p, const int fd)
+{
+    atf_error_t err = atf_process_stream_init_tee(&m_sb, p.c_path(), fd);
+    if (atf_is_error(err))
+        throw_atf_error(err);
+    m_inited = true;
+}
+
+// ------------------------------------------------------------------------
+// The "attrs" type.
+// ------------------------------------------------------------------------
+
+impl::attrs::attrs(void)
+{
+    atf_error_t err = atf_process_attrs_init(&m_attrs);
+    if (atf_is_error(err))
+        throw_atf_error(err);
+}
+
+impl::attrs::~attrs(void)
+{
+    atf_process_attrs_fini(&m_attrs);
+}
+
+const atf_process_attrs_t*
+impl::attrs::get_attrs(void)
+    const
+{
+    return &m_attrs;
+}
+
+void
+impl::attrs::set_close_fds(const bool close_fds)
+{
+    atf_process_attrs_set_close_fds(&m_attrs, close_fds);
+}
+
+void
+impl::attrs::set_limit(const int resource, const rlim_t value)
+{
+    atf_process_attrs_set_limit(&m_attrs, resource, value);
+}
+
+void
+impl::attrs::set_nice(const int value)
+{
+    atf_process_attrs_set_nice(&m_attrs, value);
+}
+
 // ------------------------------------------------------------------------
 // The "status" type.
 // ------------------------------------------------------------------------
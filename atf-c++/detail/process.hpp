@@ -32,6 +32,9 @@
 
 extern "C" {
 #include <sys/types.h>
+#include <sys/resource.h>
+
+#include <atf-c/defs.h>
 
 #include "../../atf-c/error.h"
 
@@ -48,6 +51,7 @@ extern "C" {
 namespace atf {
 namespace process {
 
+class attrs;
 class child;
 class status;
 
@@ -75,6 +79,9 @@ public:
     explicit argv_array(const char* const*);
     template< class C > explicit argv_array(const C&);
     argv_array(const argv_array&);
+#if defined(ATF_DEFS_CXX_MOVE)
+    argv_array(argv_array&&);
+#endif
 
     const char* const* exec_argv(void) const;
     size_type size(void) const;
@@ -84,6 +91,9 @@ public:
     const_iterator end(void) const;
 
     argv_array& operator=(const argv_array&);
+#if defined(ATF_DEFS_CXX_MOVE)
+    argv_array& operator=(argv_array&&);
+#endif
 };
 
 template< class C >
@@ -95,6 +105,30 @@ argv_array::argv_array(const C& c)
     ctor_init_exec_argv();
 }
 
+#if defined(ATF_DEFS_CXX_MOVE)
+// Swapping the vectors keeps the strings at the same addresses, so the
+// exec argv can be taken over instead of being rebuilt.  The moved-from
+// array is left empty and can only be destroyed or assigned to.
+inline
+argv_array::argv_array(argv_array&& a) :
+    m_exec_argv(a.m_exec_argv.release())
+{
+    m_args.swap(a.m_args);
+}
+
+inline
+argv_array&
+argv_array::operator=(argv_array&& a)
+{
+    if (this != &a) {
+        m_args.clear();
+        m_args.swap(a.m_args);
+        m_exec_argv.reset(a.m_exec_argv.release());
+    }
+    return *this;
+}
+#endif
+
 // ------------------------------------------------------------------------
 // The "stream" types.
 // ------------------------------------------------------------------------
@@ -108,16 +142,30 @@ protected:
 
 public:
     basic_stream(void);
+#if defined(ATF_DEFS_CXX_MOVE)
+    basic_stream(basic_stream&&);
+#endif
     ~basic_stream(void);
 };
 
+#if defined(ATF_DEFS_CXX_MOVE)
+inline
+basic_stream::basic_stream(basic_stream&& s) :
+    m_sb(s.m_sb),
+    m_inited(s.m_inited)
+{
+    s.m_inited = false;
+}
+#endif
+
 class stream_capture : basic_stream {
     // Allow access to the getters.
     template< class OutStream, class ErrStream > friend
     child fork(void (*)(void*), const OutStream&, const ErrStream&, void*);
     template< class OutStream, class ErrStream > friend
     status exec(const atf::fs::path&, const argv_array&,
-                const OutStream&, const ErrStream&, void (*)(void));
+                const OutStream&, const ErrStream&, const attrs&,
+                void (*)(void));
 
 public:
     stream_capture(void);
@@ -129,7 +177,8 @@ class stream_connect : basic_stream {
     child fork(void (*)(void*), const OutStream&, const ErrStream&, void*);
     template< class OutStream, class ErrStream > friend
     status exec(const atf::fs::path&, const argv_array&,
-                const OutStream&, const ErrStream&, void (*)(void));
+                const OutStream&, const ErrStream&, const attrs&,
+                void (*)(void));
 
 public:
     stream_connect(const int, const int);
@@ -141,7 +190,8 @@ class stream_inherit : basic_stream {
     child fork(void (*)(void*), const OutStream&, const ErrStream&, void*);
     template< class OutStream, class ErrStream > friend
     status exec(const atf::fs::path&, const argv_array&,
-                const OutStream&, const ErrStream&, void (*)(void));
+                const OutStream&, const ErrStream&, const attrs&,
+                void (*)(void));
 
 public:
     stream_inherit(void);
@@ -153,7 +203,8 @@ class stream_redirect_fd : basic_stream {
     child fork(void (*)(void*), const OutStream&, const ErrStream&, void*);
     template< class OutStream, class ErrStream > friend
     status exec(const atf::fs::path&, const argv_array&,
-                const OutStream&, const ErrStream&, void (*)(void));
+                const OutStream&, const ErrStream&, const attrs&,
+                void (*)(void));
 
 public:
     stream_redirect_fd(const int);
@@ -165,12 +216,50 @@ class stream_redirect_path : basic_stream {
     child fork(void (*)(void*), const OutStream&, const ErrStream&, void*);
     template< class OutStream, class ErrStream > friend
     status exec(const atf::fs::path&, const argv_array&,
-                const OutStream&, const ErrStream&, void (*)(void));
+                const OutStream&, const ErrStream&, const attrs&,
+                void (*)(void));
 
 public:
     stream_redirect_path(const fs::path&);
 };
 
+class stream_tee : basic_stream {
+    // Allow access to the getters.
+    template< class OutStream, class ErrStream > friend
+    child fork(void (*)(void*), const OutStream&, const ErrStream&, void*);
+    template< class OutStream, class ErrStream > friend
+    status exec(const atf::fs::path&, const argv_array&,
+                const OutStream&, const ErrStream&, const attrs&,
+                void (*)(void));
+
+public:
+    stream_tee(const fs::path&, const int);
+};
+
+// ------------------------------------------------------------------------
+// The "attrs" type.
+// ------------------------------------------------------------------------
+
+class attrs {
+    atf_process_attrs_t m_attrs;
+
+    const atf_process_attrs_t* get_attrs(void) const;
+
+    // Allow access to the getters.
+    template< class OutStream, class ErrStream > friend
+    status exec(const atf::fs::path&, const argv_array&,
+                const OutStream&, const ErrStream&, const attrs&,
+                void (*)(void));
+
+public:
+    attrs(void);
+    ~attrs(void);
+
+    void set_close_fds(const bool);
+    void set_limit(const int, const rlim_t);
+    void set_nice(const int);
+};
+
 // ------------------------------------------------------------------------
 // The "status" type.
 // ------------------------------------------------------------------------
@@ -181,7 +270,8 @@ class status {
     friend class child;
     template< class OutStream, class ErrStream > friend
     status exec(const atf::fs::path&, const argv_array&,
-                const OutStream&, const ErrStream&, void (*)(void));
+                const OutStream&, const ErrStream&, const attrs&,
+                void (*)(void));
 
     status(atf_process_status_t&);
 
@@ -249,7 +339,7 @@ template< class OutStream, class ErrStream >
 status
 exec(const atf::fs::path& prog, const argv_array& argv,
      const OutStream& outsb, const ErrStream& errsb,
-     void (*prehook)(void))
+     const attrs& childattrs, void (*prehook)(void))
 {
     atf_process_status_t s;
 
@@ -258,6 +348,7 @@ exec(const atf::fs::path& prog, const argv_array& argv,
                                              argv.exec_argv(),
                                              outsb.get_sb(),
                                              errsb.get_sb(),
+                                             childattrs.get_attrs(),
                                              prehook);
     if (atf_is_error(err))
         throw_atf_error(err);
@@ -265,6 +356,15 @@ exec(const atf::fs::path& prog, const argv_array& argv,
     return status(s);
 }
 
+template< class OutStream, class ErrStream >
+status
+exec(const atf::fs::path& prog, const argv_array& argv,
+     const OutStream& outsb, const ErrStream& errsb,
+     void (*prehook)(void))
+{
+    return exec(prog, argv, outsb, errsb, attrs(), prehook);
+}
+
 template< class OutStream, class ErrStream >
 status
 exec(const atf::fs::path& prog, const argv_array& argv,
@@ -27,10 +27,19 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+extern "C" {
+#include <sys/resource.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+}
+
 #include <cstdlib>
 #include <cstring>
+#include <utility>
 
 #include "../macros.hpp"
+#include "../utils.hpp"
 
 #include "process.hpp"
 #include "test_helpers.hpp"
@@ -246,6 +255,42 @@ ATF_TEST_CASE_BODY(argv_array_copy)
     argv2.release();
 }
 
+#if defined(ATF_DEFS_CXX_MOVE)
+ATF_TEST_CASE(argv_array_move);
+ATF_TEST_CASE_HEAD(argv_array_move)
+{
+    set_md_var("descr", "Tests that moving an argv_array reuses its exec "
+               "argv instead of rebuilding it");
+}
+ATF_TEST_CASE_BODY(argv_array_move)
+{
+    using atf::process::argv_array;
+
+    const char* const carray1[] = { "arg1", NULL };
+    const char* const carray2[] = { "arg1", "arg2", NULL };
+
+    argv_array argv1(carray2);
+    const char* const* eargv1 = argv1.exec_argv();
+
+    argv_array argv2(std::move(argv1));
+    ATF_REQUIRE_EQ(argv2.size(), 2);
+    ATF_REQUIRE_EQ(argv1.size(), 0);
+    ATF_REQUIRE_EQ(argv2.exec_argv(), eargv1);
+    ATF_REQUIRE(std::strcmp(argv2.exec_argv()[1], carray2[1]) == 0);
+
+    argv_array argv3(carray1);
+    argv3 = std::move(argv2);
+    ATF_REQUIRE_EQ(argv3.size(), 2);
+    ATF_REQUIRE_EQ(argv3.exec_argv(), eargv1);
+    ATF_REQUIRE(std::strcmp(argv3[0], carray2[0]) == 0);
+    ATF_REQUIRE_EQ(argv3.exec_argv()[2], static_cast< const char* >(NULL));
+
+    argv2 = argv3;
+    ATF_REQUIRE_EQ(argv2.size(), 2);
+    ATF_REQUIRE(argv2.exec_argv() != eargv1);
+}
+#endif
+
 ATF_TEST_CASE(argv_array_exec_argv);
 ATF_TEST_CASE_HEAD(argv_array_exec_argv)
 {
@@ -323,6 +368,60 @@ ATF_TEST_CASE_BODY(exec_failure)
     ATF_REQUIRE_EQ(s.exitstatus(), EXIT_FAILURE);
 }
 
+ATF_TEST_CASE(exec_limits);
+ATF_TEST_CASE_HEAD(exec_limits)
+{
+    set_md_var("descr", "Tests execing a command with resource limits");
+}
+ATF_TEST_CASE_BODY(exec_limits)
+{
+    std::vector< std::string > argv;
+    argv.push_back(get_process_helpers_path(*this, true).leaf_name());
+    argv.push_back("print-limits");
+
+    atf::process::attrs attrs;
+    attrs.set_limit(RLIMIT_CORE, 0);
+    attrs.set_limit(RLIMIT_CPU, 60);
+
+    const atf::fs::path outpath("stdout");
+    const atf::process::status s = atf::process::exec(
+        get_process_helpers_path(*this, true), atf::process::argv_array(argv),
+        atf::process::stream_redirect_path(outpath),
+        atf::process::stream_inherit(), attrs, NULL);
+    ATF_REQUIRE(s.exited());
+    ATF_REQUIRE_EQ(s.exitstatus(), EXIT_SUCCESS);
+
+    ATF_REQUIRE(atf::utils::grep_file("^core 0$", "stdout"));
+    ATF_REQUIRE(atf::utils::grep_file("^cpu 60$", "stdout"));
+}
+
+ATF_TEST_CASE(exec_tee);
+ATF_TEST_CASE_HEAD(exec_tee)
+{
+    set_md_var("descr", "Tests execing a command with its output teed");
+}
+ATF_TEST_CASE_BODY(exec_tee)
+{
+    std::vector< std::string > argv;
+    argv.push_back(get_process_helpers_path(*this, true).leaf_name());
+    argv.push_back("echo");
+    argv.push_back("test-message");
+
+    const int fd = ::open("stdout.fwd", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ATF_REQUIRE(fd != -1);
+    const atf::fs::path outpath("stdout");
+    const atf::process::status s = atf::process::exec(
+        get_process_helpers_path(*this, true), atf::process::argv_array(argv),
+        atf::process::stream_tee(outpath, fd),
+        atf::process::stream_inherit());
+    ::close(fd);
+    ATF_REQUIRE(s.exited());
+    ATF_REQUIRE_EQ(s.exitstatus(), EXIT_SUCCESS);
+
+    ATF_REQUIRE(atf::utils::compare_file("stdout", "test-message\n"));
+    ATF_REQUIRE(atf::utils::compare_file("stdout.fwd", "test-message\n"));
+}
+
 ATF_TEST_CASE(exec_success);
 ATF_TEST_CASE_HEAD(exec_success)
 {
@@ -350,8 +449,13 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, argv_array_init_empty);
     ATF_ADD_TEST_CASE(tcs, argv_array_init_varargs);
     ATF_ADD_TEST_CASE(tcs, argv_array_iter);
+#if defined(ATF_DEFS_CXX_MOVE)
+    ATF_ADD_TEST_CASE(tcs, argv_array_move);
+#endif
 
     // Add the test cases for the free functions.
     ATF_ADD_TEST_CASE(tcs, exec_failure);
+    ATF_ADD_TEST_CASE(tcs, exec_limits);
     ATF_ADD_TEST_CASE(tcs, exec_success);
+    ATF_ADD_TEST_CASE(tcs, exec_tee);
 }
@@ -27,10 +27,6 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
-extern "C" {
-#include <regex.h>
-}
-
 #include <cctype>
 #include <cstring>
 
@@ -55,29 +51,37 @@ impl::duplicate(const char* str)
 }
 
 bool
-impl::match(const std::string& str, const std::string& regex)
+impl::match(const std::string& str, const std::string& expr)
 {
-    bool found;
+    return impl::regex(expr).matches(str);
+}
 
+impl::regex::regex(const std::string& expr) :
+    m_empty(expr.empty())
+{
     // Special case: regcomp does not like empty regular expressions.
-    if (regex.empty()) {
-        found = str.empty();
-    } else {
-        ::regex_t preg;
+    if (!m_empty && ::regcomp(&m_preg, expr.c_str(), REG_EXTENDED) != 0)
+        throw std::runtime_error("Invalid regular expression '" + expr + "'");
+}
 
-        if (::regcomp(&preg, regex.c_str(), REG_EXTENDED) != 0)
-            throw std::runtime_error("Invalid regular expression '" + regex +
-                                     "'");
+impl::regex::~regex(void)
+{
+    if (!m_empty)
+        ::regfree(&m_preg);
+}
 
-        const int res = ::regexec(&preg, str.c_str(), 0, NULL, 0);
-        regfree(&preg);
-        if (res != 0 && res != REG_NOMATCH)
-            throw std::runtime_error("Invalid regular expression " + regex);
+bool
+impl::regex::matches(const std::string& str)
+    const
+{
+    if (m_empty)
+        return str.empty();
 
-        found = res == 0;
-    }
+    const int res = ::regexec(&m_preg, str.c_str(), 0, NULL, 0);
+    if (res != 0 && res != REG_NOMATCH)
+        throw std::runtime_error("Failed to match regular expression");
 
-    return found;
+    return res == 0;
 }
 
 std::string
@@ -31,6 +31,7 @@
 #define _ATF_CXX_TEXT_HPP_
 
 extern "C" {
+#include <regex.h>
 #include <stdint.h>
 }
 
@@ -79,8 +80,30 @@ join(const T& words, const std::string& separator)
 //!
 //! \brief Checks if the string matches a regular expression.
 //!
+//! The expression is compiled on every call.  Use the regex class instead
+//! to match the same expression against many strings.
+//!
 bool match(const std::string&, const std::string&);
 
+//!
+//! \brief A compiled extended regular expression.
+//!
+//! As with match, an empty expression only matches the empty string.
+//!
+class regex {
+    ::regex_t m_preg;
+    bool m_empty;
+
+    regex(const regex&);
+    regex& operator=(const regex&);
+
+public:
+    explicit regex(const std::string&);
+    ~regex(void);
+
+    bool matches(const std::string&) const;
+};
+
 //!
 //! \brief Splits a string into words.
 //!
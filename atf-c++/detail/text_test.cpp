@@ -159,6 +159,29 @@ ATF_TEST_CASE_BODY(match)
     ATF_REQUIRE(!match("hello", "^ [a-z]+$"));
 }
 
+ATF_TEST_CASE(regex);
+ATF_TEST_CASE_HEAD(regex)
+{
+    set_md_var("descr", "Tests the regex class");
+}
+ATF_TEST_CASE_BODY(regex)
+{
+    using atf::text::regex;
+
+    ATF_REQUIRE_THROW(std::runtime_error, regex("["));
+
+    const regex empty("");
+    ATF_REQUIRE(empty.matches(""));
+    ATF_REQUIRE(!empty.matches("foo"));
+
+    const regex re("^[a-z]+$");
+    ATF_REQUIRE(re.matches("hello"));
+    ATF_REQUIRE(re.matches("bye"));
+    ATF_REQUIRE(!re.matches(""));
+    ATF_REQUIRE(!re.matches("hello5"));
+    ATF_REQUIRE(re.matches("again"));
+}
+
 ATF_TEST_CASE(split);
 ATF_TEST_CASE_HEAD(split)
 {
@@ -380,6 +403,7 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, duplicate);
     ATF_ADD_TEST_CASE(tcs, join);
     ATF_ADD_TEST_CASE(tcs, match);
+    ATF_ADD_TEST_CASE(tcs, regex);
     ATF_ADD_TEST_CASE(tcs, split);
     ATF_ADD_TEST_CASE(tcs, split_delims);
     ATF_ADD_TEST_CASE(tcs, trim);
@@ -30,6 +30,7 @@
 #if !defined(_ATF_CXX_MACROS_HPP_)
 #define _ATF_CXX_MACROS_HPP_
 
+#include <cstddef>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
@@ -219,4 +220,17 @@
         (tcs).push_back(atfu_tcptr_ ## tcname); \
     } while (0);
 
+#define ATF_ADD_TEST_CASE_PARAMS(tcs, tcname, params, field) \
+    do { \
+        atfu_tcptr_ ## tcname = new atfu_tc_ ## tcname(); \
+        (tcs).push_back(atfu_tcptr_ ## tcname); \
+        for (std::size_t atfu_i = 0; \
+             atfu_i < sizeof(params) / sizeof((params)[0]); atfu_i++) { \
+            atfu_tc_ ## tcname* atfu_inst = new atfu_tc_ ## tcname(); \
+            (tcs).push_back(atfu_inst); \
+            atfu_inst->set_param(*atfu_tcptr_ ## tcname, \
+                                 (params)[atfu_i].field, &(params)[atfu_i]); \
+        } \
+    } while (0);
+
 #endif // !defined(_ATF_CXX_MACROS_HPP_)
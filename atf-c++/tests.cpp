@@ -45,6 +45,7 @@ extern "C" {
 #include <iostream>
 #include <map>
 #include <memory>
+#include <new>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
@@ -116,11 +117,16 @@ detail::match(const std::string& regexp, const std::string& str)
 }
 
 // ------------------------------------------------------------------------
-// The "tc" class.
+// The "md_visitor" class.
 // ------------------------------------------------------------------------
 
-static std::map< atf_tc_t*, impl::tc* > wraps;
-static std::map< const atf_tc_t*, const impl::tc* > cwraps;
+impl::md_visitor::~md_visitor(void)
+{
+}
+
+// ------------------------------------------------------------------------
+// The "tc" class.
+// ------------------------------------------------------------------------
 
 struct impl::tc_impl {
 private:
@@ -133,43 +139,103 @@ public:
     atf_tc_t m_tc;
     bool m_has_cleanup;
 
+    // Only set for the instances of parameterized test cases.
+    const impl::tc* m_base;
+    const void* m_param;
+    std::string m_param_name;
+
+    // Whether the test case only provides the metadata of its instances.
+    bool m_is_base;
+
     tc_impl(const std::string& ident, const bool has_cleanup) :
         m_ident(ident),
-        m_has_cleanup(has_cleanup)
+        m_has_cleanup(has_cleanup),
+        m_base(NULL),
+        m_param(NULL),
+        m_is_base(false)
     {
     }
 
+    // The C test case carries a pointer to its C++ counterpart, so the
+    // wrappers below do not need any global state to find it.
+    static impl::tc*
+    get_tc(const atf_tc_t *tc)
+    {
+        impl::tc* const wrap = static_cast< impl::tc* >(atf_tc_get_data(tc));
+        INV(wrap != NULL);
+        return wrap;
+    }
+
     static void
     wrap_head(atf_tc_t *tc)
     {
-        std::map< atf_tc_t*, impl::tc* >::iterator iter = wraps.find(tc);
-        INV(iter != wraps.end());
-        (*iter).second->head();
+        get_tc(tc)->head();
     }
 
     static void
     wrap_body(const atf_tc_t *tc)
     {
-        std::map< const atf_tc_t*, const impl::tc* >::const_iterator iter =
-            cwraps.find(tc);
-        INV(iter != cwraps.end());
+        const impl::tc* wrap = get_tc(tc);
         try {
-            (*iter).second->body();
+            wrap->body();
         } catch (const std::exception& e) {
-            (*iter).second->fail("Caught unhandled exception: " + std::string(
-                                     e.what()));
+            wrap->fail("Caught unhandled exception: " + std::string(
+                           e.what()));
         } catch (...) {
-            (*iter).second->fail("Caught unknown exception");
+            wrap->fail("Caught unknown exception");
         }
     }
 
     static void
     wrap_cleanup(const atf_tc_t *tc)
     {
-        std::map< const atf_tc_t*, const impl::tc* >::const_iterator iter =
-            cwraps.find(tc);
-        INV(iter != cwraps.end());
-        (*iter).second->cleanup();
+        const impl::tc* wrap = get_tc(tc);
+        wrap->cleanup();
+    }
+
+    static const std::string&
+    get_ident(const impl::tc& tc)
+    {
+        return tc.pimpl->m_ident;
+    }
+
+    static bool
+    is_base(const impl::tc& tc)
+    {
+        return tc.pimpl->m_is_base;
+    }
+
+    // Writes the metadata of a test case straight from the array returned
+    // by the C library, without building an intermediate vars_map.  The
+    // variables are printed in the same order as the C test programs do.
+    static void
+    write_md_vars(const impl::tc& tc, detail::atf_tp_writer& writer)
+    {
+        char **array = atf_tc_get_md_vars(&tc.pimpl->m_tc);
+        if (array == NULL)
+            throw std::bad_alloc();
+
+        try {
+            char **ptr;
+            for (ptr = array; *ptr != NULL; ptr += 2) {
+                if (std::strcmp(*ptr, "ident") == 0) {
+                    writer.start_tc(*(ptr + 1));
+                    break;
+                }
+            }
+            INV(*ptr != NULL);
+
+            for (ptr = array; *ptr != NULL; ptr += 2) {
+                if (std::strcmp(*ptr, "ident") != 0)
+                    writer.tc_meta_data(*ptr, *(ptr + 1));
+            }
+
+            writer.end_tc();
+        } catch (...) {
+            atf_utils_free_charpp(array);
+            throw;
+        }
+        atf_utils_free_charpp(array);
     }
 };
 
@@ -180,9 +246,6 @@ impl::tc::tc(const std::string& ident, const bool has_cleanup) :
 
 impl::tc::~tc(void)
 {
-    cwraps.erase(&pimpl->m_tc);
-    wraps.erase(&pimpl->m_tc);
-
     atf_tc_fini(&pimpl->m_tc);
 }
 
@@ -201,16 +264,46 @@ impl::tc::init(const vars_map& config)
     }
     *ptr = NULL;
 
-    wraps[&pimpl->m_tc] = this;
-    cwraps[&pimpl->m_tc] = this;
-
-    err = atf_tc_init(&pimpl->m_tc, pimpl->m_ident.c_str(), pimpl->wrap_head,
-        pimpl->wrap_body, pimpl->m_has_cleanup ? pimpl->wrap_cleanup : NULL,
-        array.get());
+    if (pimpl->m_base != NULL) {
+        // The base was initialized before, as it precedes its instances.
+        err = atf_tc_init_instance(&pimpl->m_tc, &pimpl->m_base->pimpl->m_tc,
+            pimpl->m_param_name.c_str(), pimpl->m_param, this);
+    } else {
+        err = atf_tc_init_data(&pimpl->m_tc, pimpl->m_ident.c_str(),
+            pimpl->wrap_head, pimpl->wrap_body,
+            pimpl->m_has_cleanup ? pimpl->wrap_cleanup : NULL, array.get(),
+            this);
+    }
     if (atf_is_error(err))
         throw_atf_error(err);
 }
 
+//!
+//! \brief Turns the test case into an instance of a parameterized one.
+//!
+//! The test case runs the body of the given base test case, which must
+//! be of the same class, with the given parameter, and takes its metadata
+//! from the base.  The base itself is not listed nor run.
+//!
+void
+impl::tc::set_param(tc& base, const std::string& name, const void* param)
+{
+    PRE(base.pimpl->m_base == NULL);
+
+    base.pimpl->m_is_base = true;
+    pimpl->m_base = &base;
+    pimpl->m_param = param;
+    pimpl->m_param_name = name;
+    pimpl->m_ident = base.pimpl->m_ident + "/" + name;
+}
+
+const void*
+impl::tc::get_param_ptr(void)
+    const
+{
+    return atf_tc_get_param(&pimpl->m_tc);
+}
+
 bool
 impl::tc::has_config_var(const std::string& var)
     const
@@ -246,23 +339,58 @@ impl::tc::get_md_var(const std::string& var)
     return atf_tc_get_md_var(&pimpl->m_tc, var.c_str());
 }
 
+namespace {
+
+// Collects the meta-data of a test case into a vars_map.  The C library
+// returns the variables sorted by name, so every insertion goes after the
+// previous one.
+class map_builder : public impl::md_visitor {
+    impl::vars_map& m_vars;
+    impl::vars_map::iterator m_hint;
+
+public:
+    explicit map_builder(impl::vars_map& vars) :
+        m_vars(vars),
+        m_hint(vars.begin())
+    {
+    }
+
+    void
+    visit(const char* name, const char* value)
+    {
+        m_hint = m_vars.insert(m_hint, impl::vars_map::value_type(name,
+                                                                   value));
+    }
+};
+
+} // anonymous namespace
+
 const impl::vars_map
 impl::tc::get_md_vars(void)
     const
 {
     vars_map vars;
+    map_builder builder(vars);
+    visit_md_vars(builder);
+    return vars;
+}
 
+void
+impl::tc::visit_md_vars(md_visitor& visitor)
+    const
+{
     char **array = atf_tc_get_md_vars(&pimpl->m_tc);
+    if (array == NULL)
+        throw std::bad_alloc();
+
     try {
-        char **ptr;
-        for (ptr = array; *ptr != NULL; ptr += 2)
-            vars[*ptr] = *(ptr + 1);
+        for (char **ptr = array; *ptr != NULL; ptr += 2)
+            visitor.visit(*ptr, *(ptr + 1));
     } catch (...) {
         atf_utils_free_charpp(array);
         throw;
     }
-
-    return vars;
+    atf_utils_free_charpp(array);
 }
 
 void
@@ -411,7 +539,7 @@ private:
     void parse_vflag(const std::string&);
     void handle_srcdir(void);
 
-    tc_vector init_tcs(void);
+    const tc_vector& init_tcs(void);
 
     enum tc_part {
         BODY,
@@ -419,7 +547,7 @@ private:
     };
 
     void list_tcs(void);
-    impl::tc* find_tc(tc_vector, const std::string&);
+    impl::tc* find_tc(const tc_vector&, const std::string&);
     static std::pair< std::string, tc_part > process_tcarg(const std::string&);
     int run_tc(const std::string&);
 
@@ -539,7 +667,7 @@ tp::handle_srcdir(void)
     m_vars["srcdir"] = m_srcdir.str();
 }
 
-tp::tc_vector
+const tp::tc_vector&
 tp::init_tcs(void)
 {
     m_add_tcs(m_tcs);
@@ -574,39 +702,25 @@ public:
 void
 tp::list_tcs(void)
 {
-    tc_vector tcs = init_tcs();
+    const tc_vector& tcs = init_tcs();
     detail::atf_tp_writer writer(std::cout);
 
     for (tc_vector::const_iterator iter = tcs.begin();
          iter != tcs.end(); iter++) {
-        const impl::vars_map vars = (*iter)->get_md_vars();
-
-        {
-            impl::vars_map::const_iterator iter2 = vars.find("ident");
-            INV(iter2 != vars.end());
-            writer.start_tc((*iter2).second);
-        }
-
-        for (impl::vars_map::const_iterator iter2 = vars.begin();
-             iter2 != vars.end(); iter2++) {
-            const std::string& key = (*iter2).first;
-            if (key != "ident")
-                writer.tc_meta_data(key, (*iter2).second);
-        }
-
-        writer.end_tc();
+        if (!impl::tc_impl::is_base(**iter))
+            impl::tc_impl::write_md_vars(**iter, writer);
     }
 }
 
 impl::tc*
-tp::find_tc(tc_vector tcs, const std::string& name)
+tp::find_tc(const tc_vector& tcs, const std::string& name)
 {
-    std::vector< std::string > ids;
-    for (tc_vector::iterator iter = tcs.begin();
+    for (tc_vector::const_iterator iter = tcs.begin();
          iter != tcs.end(); iter++) {
         impl::tc* tc = *iter;
 
-        if (tc->get_md_var("ident") == name)
+        if (impl::tc_impl::get_ident(*tc) == name &&
+            !impl::tc_impl::is_base(*tc))
             return tc;
     }
     throw atf::application::usage_error("Unknown test case `%s'",
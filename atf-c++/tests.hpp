@@ -66,6 +66,41 @@ bool match(const std::string&, const std::string&);
 
 typedef std::map< std::string, std::string > vars_map;
 
+// ------------------------------------------------------------------------
+// The "md_visitor" class.
+// ------------------------------------------------------------------------
+
+//!
+//! \brief Receives the meta-data variables of a test case one at a time.
+//!
+//! The name and the value passed to visit are only valid during the call.
+//!
+class md_visitor {
+public:
+    virtual ~md_visitor(void);
+
+    virtual void visit(const char*, const char*) = 0;
+};
+
+#if defined(ATF_DEFS_CXX_MOVE)
+namespace detail {
+
+template< class F >
+class md_visitor_adapter : public md_visitor {
+    F& m_func;
+
+public:
+    explicit md_visitor_adapter(F& func) : m_func(func) {}
+
+    void visit(const char* name, const char* value)
+    {
+        m_func(name, value);
+    }
+};
+
+} // namespace
+#endif
+
 // ------------------------------------------------------------------------
 // The "tc" class.
 // ------------------------------------------------------------------------
@@ -86,6 +121,20 @@ protected:
 
     void require_prog(const std::string&) const;
 
+    const void* get_param_ptr(void) const;
+
+    //!
+    //! \brief Returns the parameter of an instance of a parameterized test
+    //! case.
+    //!
+    template< class T >
+    const T&
+    get_param(void)
+        const
+    {
+        return *static_cast< const T* >(get_param_ptr());
+    }
+
     friend struct tc_impl;
 
 public:
@@ -93,6 +142,7 @@ public:
     virtual ~tc(void);
 
     void init(const vars_map&);
+    void set_param(tc&, const std::string&, const void*);
 
     const std::string get_config_var(const std::string&) const;
     const std::string get_config_var(const std::string&, const std::string&)
@@ -102,6 +152,35 @@ public:
     bool has_config_var(const std::string&) const;
     bool has_md_var(const std::string&) const;
     void set_md_var(const std::string&, const std::string&);
+    void visit_md_vars(md_visitor&) const;
+
+#if defined(ATF_DEFS_CXX_MOVE)
+    //!
+    //! \brief Returns a configuration variable, or takes over the given
+    //! default value if it is not defined.
+    //!
+    std::string
+    get_config_var(const std::string& var, std::string&& defval)
+        const
+    {
+        if (has_config_var(var))
+            return get_config_var(var);
+        return std::move(defval);
+    }
+
+    //!
+    //! \brief Calls 'func' with the name and the value of every meta-data
+    //! variable, as visit_md_vars does.
+    //!
+    template< class F >
+    void
+    for_each_md_var(F func)
+        const
+    {
+        detail::md_visitor_adapter< F > visitor(func);
+        visit_md_vars(visitor);
+    }
+#endif
 
     void run(const std::string&) const;
     void run_cleanup(void) const;
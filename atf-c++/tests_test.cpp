@@ -35,6 +35,7 @@ extern "C" {
 #include <unistd.h>
 }
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -181,6 +182,83 @@ ATF_TEST_CASE_BODY(atf_tp_writer)
 #undef RESET
 }
 
+// ------------------------------------------------------------------------
+// Tests for the meta-data accessors of the "tc" class.
+// ------------------------------------------------------------------------
+
+namespace {
+
+class md_collector : public atf::tests::md_visitor {
+public:
+    std::vector< std::string > m_seen;
+
+    void
+    visit(const char* name, const char* value)
+    {
+        m_seen.push_back(std::string(name) + "=" + value);
+    }
+};
+
+} // anonymous namespace
+
+ATF_TEST_CASE(visit_md_vars);
+ATF_TEST_CASE_HEAD(visit_md_vars)
+{
+    set_md_var("descr", "Tests that visit_md_vars reports every meta-data "
+               "variable, as get_md_vars does");
+    set_md_var("X-custom", "some value");
+}
+ATF_TEST_CASE_BODY(visit_md_vars)
+{
+    md_collector collector;
+    visit_md_vars(collector);
+
+    const atf::tests::vars_map vars = get_md_vars();
+    ATF_REQUIRE_EQ(vars.size(), collector.m_seen.size());
+    for (atf::tests::vars_map::const_iterator iter = vars.begin();
+         iter != vars.end(); iter++) {
+        const std::string entry = (*iter).first + "=" + (*iter).second;
+        ATF_REQUIRE(std::find(collector.m_seen.begin(),
+                              collector.m_seen.end(), entry) !=
+                    collector.m_seen.end());
+    }
+    ATF_REQUIRE(std::find(collector.m_seen.begin(), collector.m_seen.end(),
+                          "X-custom=some value") != collector.m_seen.end());
+    ATF_REQUIRE(std::find(collector.m_seen.begin(), collector.m_seen.end(),
+                          "ident=visit_md_vars") != collector.m_seen.end());
+}
+
+#if defined(ATF_DEFS_CXX_MOVE)
+ATF_TEST_CASE(md_vars_move);
+ATF_TEST_CASE_HEAD(md_vars_move)
+{
+    set_md_var("descr", "Tests the meta-data and configuration accessors "
+               "that are only available with move support");
+    set_md_var("X-custom", "some value");
+}
+ATF_TEST_CASE_BODY(md_vars_move)
+{
+    std::size_t count = 0;
+    std::string custom;
+    for_each_md_var([&](const char* name, const char* value) {
+        count++;
+        if (std::string(name) == "X-custom")
+            custom = value;
+    });
+    ATF_REQUIRE_EQ(get_md_vars().size(), count);
+    ATF_REQUIRE_EQ("some value", custom);
+
+    std::string defval("a default value that is long enough to be "
+                       "allocated on the heap");
+    const char* buffer = defval.c_str();
+    const std::string value = get_config_var("undefined-variable",
+                                             std::move(defval));
+    ATF_REQUIRE_EQ(buffer, value.c_str());
+    ATF_REQUIRE_EQ(get_config_var("srcdir"),
+                   get_config_var("srcdir", std::string("unused")));
+}
+#endif
+
 // ------------------------------------------------------------------------
 // Tests cases for the header file.
 // ------------------------------------------------------------------------
@@ -196,6 +274,12 @@ ATF_INIT_TEST_CASES(tcs)
     // Add tests for the "atf_tp_writer" class.
     ATF_ADD_TEST_CASE(tcs, atf_tp_writer);
 
+    // Add tests for the meta-data accessors of the "tc" class.
+    ATF_ADD_TEST_CASE(tcs, visit_md_vars);
+#if defined(ATF_DEFS_CXX_MOVE)
+    ATF_ADD_TEST_CASE(tcs, md_vars_move);
+#endif
+
     // Add the test cases for the header file.
     ATF_ADD_TEST_CASE(tcs, include);
 }
@@ -42,6 +42,14 @@ atf::utils::cat_file(const std::string& path, const std::string& prefix)
     atf_utils_cat_file(path.c_str(), prefix.c_str());
 }
 
+void
+atf::utils::clone_tree(const std::string& source,
+                       const std::string& destination,
+                       const bool link_read_only)
+{
+    atf_utils_clone_tree(source.c_str(), destination.c_str(), link_read_only);
+}
+
 void
 atf::utils::copy_file(const std::string& source, const std::string& destination)
 {
@@ -54,6 +62,13 @@ atf::utils::compare_file(const std::string& path, const std::string& contents)
     return atf_utils_compare_file(path.c_str(), contents.c_str());
 }
 
+bool
+atf::utils::compare_file_digest(const std::string& path,
+                                const std::string& digest)
+{
+    return atf_utils_compare_file_digest(path.c_str(), digest.c_str());
+}
+
 void
 atf::utils::create_file(const std::string& path, const std::string& contents)
 {
@@ -86,6 +101,13 @@ atf::utils::grep_string(const std::string& regex, const std::string& str)
     return atf_utils_grep_string("%s", str.c_str(), regex.c_str());
 }
 
+bool
+atf::utils::detail::grep_strings(const std::string& regex,
+                                 const char* const* strs)
+{
+    return atf_utils_grep_strings(regex.c_str(), strs);
+}
+
 void
 atf::utils::redirect(const int fd, const std::string& path)
 {
@@ -96,9 +118,56 @@ atf::utils::redirect(const int fd, const std::string& path)
     atf_utils_redirect(fd, path.c_str());
 }
 
+void
+atf::utils::remove_tree(const std::string& path)
+{
+    atf_utils_remove_tree(path.c_str());
+}
+
 void
 atf::utils::wait(const pid_t pid, const int exitstatus,
                  const std::string& expout, const std::string& experr)
 {
     atf_utils_wait(pid, exitstatus, expout.c_str(), experr.c_str());
 }
+
+pid_t
+atf::utils::wait_any(const int exitstatus, const std::string& expout,
+                     const std::string& experr)
+{
+    return atf_utils_wait_any(exitstatus, expout.c_str(), experr.c_str());
+}
+
+void
+atf::utils::wait_all(const int exitstatus, const std::string& expout,
+                     const std::string& experr)
+{
+    atf_utils_wait_all(exitstatus, expout.c_str(), experr.c_str());
+}
+
+atf::utils::line_reader::line_reader(const int fd)
+{
+    atf_utils_reader_init(&m_reader, fd);
+}
+
+atf::utils::line_reader::~line_reader(void)
+{
+    atf_utils_reader_fini(&m_reader);
+}
+
+bool
+atf::utils::line_reader::readline(std::string& line)
+{
+    char* raw = atf_utils_reader_readline(&m_reader);
+    if (raw == NULL)
+        return false;
+
+    try {
+        line = raw;
+    } catch (...) {
+        std::free(raw);
+        throw;
+    }
+    std::free(raw);
+    return true;
+}
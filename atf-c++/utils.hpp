@@ -32,15 +32,20 @@
 
 extern "C" {
 #include <unistd.h>
+
+#include <atf-c/utils.h>
 }
 
 #include <string>
+#include <vector>
 
 namespace atf {
 namespace utils {
 
 void cat_file(const std::string&, const std::string&);
+void clone_tree(const std::string&, const std::string&, const bool = false);
 bool compare_file(const std::string&, const std::string&);
+bool compare_file_digest(const std::string&, const std::string&);
 void copy_file(const std::string&, const std::string&);
 void create_file(const std::string&, const std::string&);
 bool file_exists(const std::string&);
@@ -48,18 +53,46 @@ pid_t fork(void);
 bool grep_file(const std::string&, const std::string&);
 bool grep_string(const std::string&, const std::string&);
 void redirect(const int, const std::string&);
+void remove_tree(const std::string&);
 void wait(const pid_t, const int, const std::string&, const std::string&);
+pid_t wait_any(const int, const std::string&, const std::string&);
+void wait_all(const int, const std::string&, const std::string&);
+
+//!
+//! \brief Reads the lines of a descriptor in large chunks.
+//!
+//! The reader keeps the data read past the returned lines to itself, so
+//! the descriptor must not be read by other means while the reader is in
+//! use.  The descriptor is not closed on destruction.
+//!
+class line_reader {
+    atf_utils_reader_t m_reader;
+
+    // Non-copyable.
+    line_reader(const line_reader&);
+    line_reader& operator=(const line_reader&);
+
+public:
+    explicit line_reader(const int);
+    ~line_reader(void);
+
+    bool readline(std::string&);
+};
+
+namespace detail {
+bool grep_strings(const std::string&, const char* const*);
+} // namespace detail
 
 template< typename Collection >
 bool
 grep_collection(const std::string& regexp, const Collection& collection)
 {
+    std::vector< const char* > strings;
     for (typename Collection::const_iterator iter = collection.begin();
-         iter != collection.end(); ++iter) {
-        if (grep_string(regexp, *iter))
-            return true;
-    }
-    return false;
+         iter != collection.end(); ++iter)
+        strings.push_back((*iter).c_str());
+    strings.push_back(NULL);
+    return detail::grep_strings(regexp, &strings[0]);
 }
 
 } // namespace utils
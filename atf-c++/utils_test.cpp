@@ -38,6 +38,7 @@ extern "C" {
 #include <cstdlib>
 #include <iostream>
 #include <set>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -117,6 +118,20 @@ ATF_TEST_CASE_BODY(cat_file__no_newline_eof)
     ATF_REQUIRE_EQ("PREFIXFoo\nPREFIX bar baz", read_file("captured.txt"));
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(clone_tree);
+ATF_TEST_CASE_BODY(clone_tree)
+{
+    ATF_REQUIRE(::mkdir("fixture", 0755) != -1);
+    ATF_REQUIRE(::mkdir("fixture/sub", 0755) != -1);
+    atf::utils::create_file("fixture/file.txt", "Contents\n");
+    atf::utils::create_file("fixture/sub/file.txt", "Nested\n");
+
+    atf::utils::clone_tree("fixture", "work");
+
+    ATF_REQUIRE(atf::utils::compare_file("work/file.txt", "Contents\n"));
+    ATF_REQUIRE(atf::utils::compare_file("work/sub/file.txt", "Nested\n"));
+}
+
 ATF_TEST_CASE_WITHOUT_HEAD(compare_file__empty__match);
 ATF_TEST_CASE_BODY(compare_file__empty__match)
 {
@@ -181,6 +196,16 @@ ATF_TEST_CASE_BODY(compare_file__long__not_match)
     ATF_REQUIRE(!atf::utils::compare_file("test.txt", long_contents));
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(compare_file_digest);
+ATF_TEST_CASE_BODY(compare_file_digest)
+{
+    atf::utils::create_file("test.txt", "this is a short file");
+    ATF_REQUIRE(atf::utils::compare_file_digest("test.txt", "sha256:"
+        "f77c69eab04e986d3bb0c35db8d4acefd2cb94f95784660795c72aaf2bdcdecd"));
+    ATF_REQUIRE(!atf::utils::compare_file_digest("test.txt", "sha256:"
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+}
+
 ATF_TEST_CASE_WITHOUT_HEAD(copy_file__empty);
 ATF_TEST_CASE_BODY(copy_file__empty)
 {
@@ -238,8 +263,11 @@ ATF_TEST_CASE_BODY(fork)
     ATF_REQUIRE(WIFEXITED(status));
     ATF_REQUIRE_EQ(EXIT_SUCCESS, WEXITSTATUS(status));
 
-    ATF_REQUIRE_EQ("Child stdout\n", read_file("atf_utils_fork_out.txt"));
-    ATF_REQUIRE_EQ("Child stderr\n", read_file("atf_utils_fork_err.txt"));
+    std::ostringstream out_name, err_name;
+    out_name << "atf_utils_fork_" << pid << "_out.txt";
+    err_name << "atf_utils_fork_" << pid << "_err.txt";
+    ATF_REQUIRE_EQ("Child stdout\n", read_file(out_name.str().c_str()));
+    ATF_REQUIRE_EQ("Child stderr\n", read_file(err_name.str().c_str()));
 }
 
 ATF_TEST_CASE_WITHOUT_HEAD(grep_collection__set);
@@ -292,6 +320,53 @@ ATF_TEST_CASE_BODY(grep_string)
     ATF_REQUIRE(!atf::utils::grep_string("aaaaa", str));
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(line_reader);
+ATF_TEST_CASE_BODY(line_reader)
+{
+    int fds[2];
+    ATF_REQUIRE(pipe(fds) != -1);
+
+    const pid_t pid = atf::utils::fork();
+    if (pid == 0) {
+        close(fds[0]);
+        std::string data;
+        for (int i = 0; i < 10000; i++) {
+            std::ostringstream line;
+            line << "Line " << i << "\n";
+            data += line.str();
+        }
+        data += "Unterminated";
+        const char* ptr = data.c_str();
+        size_t left = data.length();
+        while (left > 0) {
+            const ssize_t cnt = write(fds[1], ptr, left);
+            if (cnt == -1)
+                std::exit(EXIT_FAILURE);
+            ptr += cnt;
+            left -= cnt;
+        }
+        std::exit(EXIT_SUCCESS);
+    }
+    close(fds[1]);
+
+    {
+        atf::utils::line_reader reader(fds[0]);
+        std::string line;
+        for (int i = 0; i < 10000; i++) {
+            std::ostringstream exp;
+            exp << "Line " << i;
+            ATF_REQUIRE(reader.readline(line));
+            ATF_REQUIRE_EQ(exp.str(), line);
+        }
+        ATF_REQUIRE(reader.readline(line));
+        ATF_REQUIRE_EQ("Unterminated", line);
+        ATF_REQUIRE(!reader.readline(line));
+    }
+    close(fds[0]);
+
+    atf::utils::wait(pid, EXIT_SUCCESS, "", "");
+}
+
 ATF_TEST_CASE_WITHOUT_HEAD(redirect__stdout);
 ATF_TEST_CASE_BODY(redirect__stdout)
 {
@@ -325,6 +400,19 @@ ATF_TEST_CASE_BODY(redirect__other)
     ATF_REQUIRE_EQ(message, read_file("captured.txt"));
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(remove_tree);
+ATF_TEST_CASE_BODY(remove_tree)
+{
+    ATF_REQUIRE(::mkdir("work", 0755) != -1);
+    ATF_REQUIRE(::mkdir("work/sub", 0755) != -1);
+    atf::utils::create_file("work/file.txt", "Contents\n");
+    atf::utils::create_file("work/sub/file.txt", "Nested\n");
+    ATF_REQUIRE(::chmod("work/sub", 0500) != -1);
+
+    atf::utils::remove_tree("work");
+    ATF_REQUIRE(!atf::utils::file_exists("work"));
+}
+
 static void
 fork_and_wait(const int exitstatus, const char* expout, const char* experr)
 {
@@ -398,6 +486,24 @@ ATF_TEST_CASE_BODY(wait__invalid_stderr)
     }
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(wait__digest);
+ATF_TEST_CASE_BODY(wait__digest)
+{
+    const pid_t control = fork();
+    ATF_REQUIRE(control != -1);
+    if (control == 0)
+        fork_and_wait(123, "digest:sha256:"
+                      "cf49e86df5074a7b1ffd4b822a1a7184f93863d34d541fea384eff26ae04bc59",
+                      "digest:sha256:"
+                      "413c15f11cf5e72827dc4b5515c6a7b9793a9a96c93e3b2271b79b20ec9a92e9");
+    else {
+        int status;
+        ATF_REQUIRE(waitpid(control, &status, 0) != -1);
+        ATF_REQUIRE(WIFEXITED(status));
+        ATF_REQUIRE_EQ(EXIT_SUCCESS, WEXITSTATUS(status));
+    }
+}
+
 ATF_TEST_CASE_WITHOUT_HEAD(wait__save_stdout);
 ATF_TEST_CASE_BODY(wait__save_stdout)
 {
@@ -432,6 +538,42 @@ ATF_TEST_CASE_BODY(wait__save_stderr)
     }
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(wait_any);
+ATF_TEST_CASE_BODY(wait_any)
+{
+    std::set< pid_t > pids;
+    for (int i = 0; i < 4; i++) {
+        const pid_t pid = atf::utils::fork();
+        if (pid == 0) {
+            std::cout << "Some output\n";
+            std::exit(EXIT_SUCCESS);
+        }
+        pids.insert(pid);
+    }
+
+    while (!pids.empty()) {
+        const pid_t pid = atf::utils::wait_any(EXIT_SUCCESS, "Some output\n",
+                                               "");
+        ATF_REQUIRE(pids.erase(pid) == 1);
+    }
+}
+
+ATF_TEST_CASE_WITHOUT_HEAD(wait_all);
+ATF_TEST_CASE_BODY(wait_all)
+{
+    for (int i = 0; i < 32; i++) {
+        const pid_t pid = atf::utils::fork();
+        if (pid == 0) {
+            std::cout << "Some output\n";
+            std::cerr << "Some error\n";
+            std::exit(123);
+        }
+    }
+
+    atf::utils::wait_all(123, "Some output\n", "Some error\n");
+    ATF_REQUIRE(waitpid(-1, NULL, WNOHANG) == -1);
+}
+
 // ------------------------------------------------------------------------
 // Tests cases for the header file.
 // ------------------------------------------------------------------------
@@ -450,6 +592,8 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, cat_file__several_lines);
     ATF_ADD_TEST_CASE(tcs, cat_file__no_newline_eof);
 
+    ATF_ADD_TEST_CASE(tcs, clone_tree);
+
     ATF_ADD_TEST_CASE(tcs, compare_file__empty__match);
     ATF_ADD_TEST_CASE(tcs, compare_file__empty__not_match);
     ATF_ADD_TEST_CASE(tcs, compare_file__short__match);
@@ -457,6 +601,8 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, compare_file__long__match);
     ATF_ADD_TEST_CASE(tcs, compare_file__long__not_match);
 
+    ATF_ADD_TEST_CASE(tcs, compare_file_digest);
+
     ATF_ADD_TEST_CASE(tcs, copy_file__empty);
     ATF_ADD_TEST_CASE(tcs, copy_file__some_contents);
 
@@ -470,17 +616,23 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, grep_collection__vector);
     ATF_ADD_TEST_CASE(tcs, grep_file);
     ATF_ADD_TEST_CASE(tcs, grep_string);
+    ATF_ADD_TEST_CASE(tcs, line_reader);
 
     ATF_ADD_TEST_CASE(tcs, redirect__stdout);
     ATF_ADD_TEST_CASE(tcs, redirect__stderr);
     ATF_ADD_TEST_CASE(tcs, redirect__other);
 
+    ATF_ADD_TEST_CASE(tcs, remove_tree);
+
     ATF_ADD_TEST_CASE(tcs, wait__ok);
     ATF_ADD_TEST_CASE(tcs, wait__invalid_exitstatus);
     ATF_ADD_TEST_CASE(tcs, wait__invalid_stdout);
     ATF_ADD_TEST_CASE(tcs, wait__invalid_stderr);
     ATF_ADD_TEST_CASE(tcs, wait__save_stdout);
     ATF_ADD_TEST_CASE(tcs, wait__save_stderr);
+    ATF_ADD_TEST_CASE(tcs, wait__digest);
+    ATF_ADD_TEST_CASE(tcs, wait_any);
+    ATF_ADD_TEST_CASE(tcs, wait_all);
 
     // Add the test cases for the header file.
     ATF_ADD_TEST_CASE(tcs, include);
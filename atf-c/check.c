@@ -27,13 +27,17 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/time.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
 
 #include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "atf-c/build.h"
@@ -48,6 +52,201 @@
 #include "detail/list.h"
 #include "detail/process.h"
 #include "detail/sanity.h"
+#include "detail/sha256.h"
+
+/* ---------------------------------------------------------------------
+ * The "atf_check_capture" type.
+ * --------------------------------------------------------------------- */
+
+/* A bounded summary of an output stream: its digest and size, plus the
+ * first and last m_limit bytes of it.  The tail is kept in a ring buffer
+ * while the data flows and is made contiguous once the stream ends. */
+struct atf_check_capture {
+    size_t m_limit;
+
+    char *m_head;
+    size_t m_head_length;
+
+    char *m_tail;
+    size_t m_tail_start;
+    size_t m_tail_length;
+
+    uint64_t m_bytes;
+    uint64_t m_lines;
+    bool m_partial_line;
+
+    atf_sha256_t m_sha256;
+    char m_digest[ATF_SHA256_HEX_LENGTH + 1];
+};
+
+static
+atf_error_t
+capture_init(atf_check_capture_t *c, const size_t limit)
+{
+    PRE(limit > 0);
+
+    c->m_head = malloc(limit);
+    if (c->m_head == NULL)
+        return atf_no_memory_error();
+    c->m_tail = malloc(limit);
+    if (c->m_tail == NULL) {
+        free(c->m_head);
+        return atf_no_memory_error();
+    }
+
+    c->m_limit = limit;
+    c->m_head_length = 0;
+    c->m_tail_start = 0;
+    c->m_tail_length = 0;
+    c->m_bytes = 0;
+    c->m_lines = 0;
+    c->m_partial_line = false;
+    atf_sha256_init(&c->m_sha256);
+    c->m_digest[0] = '\0';
+
+    return atf_no_error();
+}
+
+static
+void
+capture_fini(atf_check_capture_t *c)
+{
+    free(c->m_head);
+    free(c->m_tail);
+}
+
+static
+void
+capture_ring_append(atf_check_capture_t *c, const char *data, size_t length)
+{
+    const size_t limit = c->m_limit;
+
+    if (length >= limit) {
+        memcpy(c->m_tail, data + length - limit, limit);
+        c->m_tail_start = 0;
+        c->m_tail_length = limit;
+    } else {
+        const size_t end = (c->m_tail_start + c->m_tail_length) % limit;
+        const size_t first = length < limit - end ? length : limit - end;
+
+        memcpy(c->m_tail + end, data, first);
+        memcpy(c->m_tail, data + first, length - first);
+
+        if (c->m_tail_length + length > limit) {
+            c->m_tail_start = (c->m_tail_start + c->m_tail_length + length -
+                               limit) % limit;
+            c->m_tail_length = limit;
+        } else
+            c->m_tail_length += length;
+    }
+}
+
+/** Accounts for a chunk of output; used as a process stream observer. */
+static
+void
+capture_observe(const char *data, size_t length, void *v)
+{
+    atf_check_capture_t *c = v;
+    const char *ptr;
+
+    atf_sha256_update(&c->m_sha256, data, length);
+    c->m_bytes += length;
+
+    for (ptr = data; (ptr = memchr(ptr, '\n', data + length - ptr)) != NULL;
+         ptr++)
+        c->m_lines++;
+    if (length > 0)
+        c->m_partial_line = data[length - 1] != '\n';
+
+    if (c->m_head_length < c->m_limit) {
+        size_t n = c->m_limit - c->m_head_length;
+        if (n > length)
+            n = length;
+        memcpy(c->m_head + c->m_head_length, data, n);
+        c->m_head_length += n;
+        data += n;
+        length -= n;
+    }
+    if (length > 0)
+        capture_ring_append(c, data, length);
+}
+
+static
+void
+reverse(char *begin, char *end)
+{
+    while (begin < end) {
+        char aux;
+
+        end--;
+        aux = *begin;
+        *begin = *end;
+        *end = aux;
+        begin++;
+    }
+}
+
+static
+void
+capture_finish(atf_check_capture_t *c)
+{
+    atf_sha256_final_hex(&c->m_sha256, c->m_digest);
+    if (c->m_partial_line)
+        c->m_lines++;
+
+    if (c->m_tail_start != 0) {
+        /* Rotate the full ring so that it starts at the oldest byte. */
+        INV(c->m_tail_length == c->m_limit);
+        reverse(c->m_tail, c->m_tail + c->m_tail_start);
+        reverse(c->m_tail + c->m_tail_start, c->m_tail + c->m_limit);
+        reverse(c->m_tail, c->m_tail + c->m_limit);
+        c->m_tail_start = 0;
+    }
+}
+
+/** Returns the total number of bytes in the stream. */
+uint64_t
+atf_check_capture_bytes(const atf_check_capture_t *c)
+{
+    return c->m_bytes;
+}
+
+/** Returns the number of lines in the stream, counting a last line that
+ * lacks a newline character. */
+uint64_t
+atf_check_capture_lines(const atf_check_capture_t *c)
+{
+    return c->m_lines;
+}
+
+/** Returns the SHA-256 digest of the stream in hexadecimal form. */
+const char *
+atf_check_capture_digest(const atf_check_capture_t *c)
+{
+    return c->m_digest;
+}
+
+/** Returns the first bytes of the stream, up to the limit given when
+ * executing the command, and stores their number in 'length'. */
+const char *
+atf_check_capture_head(const atf_check_capture_t *c, size_t *length)
+{
+    *length = c->m_head_length;
+    return c->m_head;
+}
+
+/** Returns the last bytes of the stream that are not part of the head, up
+ * to the limit given when executing the command, and stores their number
+ * in 'length'.
+ *
+ * If the head and the tail together are shorter than the stream, the bytes
+ * in between them were discarded. */
+const char *
+atf_check_capture_tail(const atf_check_capture_t *c, size_t *length)
+{
+    *length = c->m_tail_length;
+    return c->m_tail;
+}
 
 /* ---------------------------------------------------------------------
  * Auxiliary functions.
@@ -77,33 +276,10 @@ out:
 
 static
 void
-cleanup_tmpdir(const atf_fs_path_t *dir, const atf_fs_path_t *outfile,
-               const atf_fs_path_t *errfile)
+cleanup_tmpdir(const atf_fs_path_t *dir)
 {
-    {
-        atf_error_t err = atf_fs_unlink(outfile);
-        if (atf_is_error(err)) {
-            INV(atf_error_is(err, "libc") &&
-                atf_libc_error_code(err) == ENOENT);
-            atf_error_free(err);
-        } else
-            INV(!atf_is_error(err));
-    }
-
-    {
-        atf_error_t err = atf_fs_unlink(errfile);
-        if (atf_is_error(err)) {
-            INV(atf_error_is(err, "libc") &&
-                atf_libc_error_code(err) == ENOENT);
-            atf_error_free(err);
-        } else
-            INV(!atf_is_error(err));
-    }
-
-    {
-        atf_error_t err = atf_fs_rmdir(dir);
-        INV(!atf_is_error(err));
-    }
+    atf_error_t err = atf_fs_rmtree(dir);
+    INV(!atf_is_error(err));
 }
 
 static
@@ -117,12 +293,19 @@ const_execvp(const char *file, const char *const *argv)
 
 static
 atf_error_t
-init_sb(const atf_fs_path_t *path, atf_process_stream_t *sb)
+init_sb(const atf_fs_path_t *path, const int fwdfd,
+        atf_check_capture_t *capture, atf_process_stream_t *sb)
 {
     atf_error_t err;
 
-    if (path == NULL)
+    if (capture != NULL) {
+        err = atf_process_stream_init_tee(sb, path, fwdfd);
+        if (!atf_is_error(err))
+            atf_process_stream_set_observer(sb, capture_observe, capture);
+    } else if (path == NULL)
         err = atf_process_stream_init_inherit(sb);
+    else if (fwdfd != -1)
+        err = atf_process_stream_init_tee(sb, path, fwdfd);
     else
         err = atf_process_stream_init_redirect_path(sb, path);
 
@@ -131,16 +314,19 @@ init_sb(const atf_fs_path_t *path, atf_process_stream_t *sb)
 
 static
 atf_error_t
-init_sbs(const atf_fs_path_t *outfile, atf_process_stream_t *outsb,
-         const atf_fs_path_t *errfile, atf_process_stream_t *errsb)
+init_sbs(const atf_fs_path_t *outfile, atf_check_capture_t *outcap,
+         atf_process_stream_t *outsb,
+         const atf_fs_path_t *errfile, atf_check_capture_t *errcap,
+         atf_process_stream_t *errsb,
+         const int fwdfd)
 {
     atf_error_t err;
 
-    err = init_sb(outfile, outsb);
+    err = init_sb(outfile, fwdfd, outcap, outsb);
     if (atf_is_error(err))
         goto out;
 
-    err = init_sb(errfile, errsb);
+    err = init_sb(errfile, fwdfd, errcap, errsb);
     if (atf_is_error(err)) {
         atf_process_stream_fini(outsb);
         goto out;
@@ -154,6 +340,13 @@ struct exec_data {
     const char *const *m_argv;
 };
 
+/* Resources used by an executed command. */
+struct exec_stats {
+    bool m_timedout;
+    struct timeval m_wall_time;
+    struct timeval m_cpu_time;
+};
+
 static void exec_child(void *) ATF_DEFS_ATTRIBUTE_NORETURN;
 
 static
@@ -167,26 +360,159 @@ exec_child(void *v)
     exit(127);
 }
 
+static volatile sig_atomic_t timeout_fired;
+
+static
+void
+timeout_handler(const int signo ATF_DEFS_ATTRIBUTE_UNUSED)
+{
+    timeout_fired = 1;
+}
+
+/** Waits for a child that was started in its own process group, killing
+ * the whole group if it does not terminate within the given timeout.
+ *
+ * The timer keeps firing periodically once expired so that a signal that
+ * arrives right before the child is waited for cannot be missed. */
 static
 atf_error_t
-fork_and_wait(const char *const *argv, const atf_fs_path_t *outfile,
-              const atf_fs_path_t *errfile, atf_process_status_t *status)
+wait_with_timeout(atf_process_child_t *child, const struct timeval *timeout,
+                  atf_process_status_t *status, struct rusage *usage,
+                  bool *timedout)
+{
+    atf_error_t err;
+    struct sigaction sa, oldsa;
+    struct itimerval it, oldit;
+    const pid_t pid = atf_process_child_pid(child);
+
+    *timedout = false;
+    timeout_fired = 0;
+
+    sa.sa_handler = timeout_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    if (sigaction(SIGALRM, &sa, &oldsa) == -1) {
+        err = atf_libc_error(errno, "Cannot install SIGALRM handler");
+        goto out;
+    }
+
+    it.it_value = *timeout;
+    it.it_interval.tv_sec = 0;
+    it.it_interval.tv_usec = 100000;
+    if (setitimer(ITIMER_REAL, &it, &oldit) == -1) {
+        err = atf_libc_error(errno, "Cannot program timer");
+        goto out_sa;
+    }
+
+    for (;;) {
+        err = atf_process_child_wait_rusage(child, status, usage);
+        if (!atf_is_error(err) || !atf_error_is(err, "libc") ||
+            atf_libc_error_code(err) != EINTR)
+            break;
+        atf_error_free(err);
+
+        if (timeout_fired && !*timedout) {
+            *timedout = true;
+            if (kill(-pid, SIGKILL) == -1)
+                (void)kill(pid, SIGKILL);
+        }
+    }
+
+    (void)setitimer(ITIMER_REAL, &oldit, NULL);
+out_sa:
+    (void)sigaction(SIGALRM, &oldsa, NULL);
+out:
+    return err;
+}
+
+static
+void
+timespec_to_timeval(const struct timespec *ts, struct timeval *tv)
+{
+    tv->tv_sec = ts->tv_sec;
+    tv->tv_usec = ts->tv_nsec / 1000;
+}
+
+/** Runs a command and waits for it to finish.
+ *
+ * The output goes to the given files, or is inherited if they are NULL.
+ * If captures are given, they observe the corresponding output, in which
+ * case a NULL file means that the output is not stored anywhere else.
+ * The descriptors of the caller above stderr are only passed to the
+ * command if 'inherit_fds' is true. */
+static
+atf_error_t
+fork_and_wait(const char *const *argv,
+              const atf_fs_path_t *outfile, atf_check_capture_t *outcap,
+              const atf_fs_path_t *errfile, atf_check_capture_t *errcap,
+              const int fwdfd, const bool inherit_fds,
+              const struct timeval *timeout, atf_process_status_t *status,
+              struct exec_stats *stats)
 {
     atf_error_t err;
     atf_process_child_t child;
     atf_process_stream_t outsb, errsb;
+    atf_process_attrs_t attrs;
     struct exec_data ea = { argv };
+    struct timespec start, end;
+    struct rusage usage;
+    bool timedout = false;
 
-    err = init_sbs(outfile, &outsb, errfile, &errsb);
+    err = init_sbs(outfile, outcap, &outsb, errfile, errcap, &errsb, fwdfd);
     if (atf_is_error(err))
         goto out;
 
-    err = atf_process_fork(&child, exec_child, &outsb, &errsb, &ea);
+    err = atf_process_attrs_init(&attrs);
     if (atf_is_error(err))
         goto out_sbs;
+    if (inherit_fds)
+        atf_process_attrs_set_close_fds(&attrs, false);
+    if (timeout != NULL)
+        atf_process_attrs_set_new_pgrp(&attrs, true);
+
+    if (clock_gettime(CLOCK_MONOTONIC, &start) == -1) {
+        err = atf_libc_error(errno, "Cannot measure resource usage");
+        goto out_attrs;
+    }
+
+    err = atf_process_fork_attrs(&child, exec_child, &outsb, &errsb, &attrs,
+                                 &ea);
+    if (atf_is_error(err))
+        goto out_attrs;
+
+    if (timeout != NULL) {
+        /* Set the process group from the parent too so that it exists by
+         * the time we may need to kill it; the child may have already
+         * done it, and even exec'ed, in which case this fails. */
+        (void)setpgid(atf_process_child_pid(&child),
+                      atf_process_child_pid(&child));
+        err = wait_with_timeout(&child, timeout, status, &usage,
+                                &timedout);
+    } else
+        err = atf_process_child_wait_rusage(&child, status, &usage);
+    if (atf_is_error(err))
+        goto out_attrs;
+
+    if (stats != NULL) {
+        if (clock_gettime(CLOCK_MONOTONIC, &end) == -1) {
+            atf_process_status_fini(status);
+            err = atf_libc_error(errno, "Cannot measure resource usage");
+            goto out_attrs;
+        }
 
-    err = atf_process_child_wait(&child, status);
+        stats->m_timedout = timedout;
+        {
+            struct timeval tv_start, tv_end;
 
+            timespec_to_timeval(&start, &tv_start);
+            timespec_to_timeval(&end, &tv_end);
+            timersub(&tv_end, &tv_start, &stats->m_wall_time);
+        }
+        timeradd(&usage.ru_utime, &usage.ru_stime, &stats->m_cpu_time);
+    }
+
+out_attrs:
+    atf_process_attrs_fini(&attrs);
 out_sbs:
     atf_process_stream_fini(&errsb);
     atf_process_stream_fini(&outsb);
@@ -271,7 +597,8 @@ check_build_run(const char *const *argv, bool *success)
 
     print_array(argv, ">");
 
-    err = fork_and_wait(argv, NULL, NULL, &status);
+    err = fork_and_wait(argv, NULL, NULL, NULL, NULL, -1, false, NULL,
+                        &status, NULL);
     if (atf_is_error(err))
         goto out;
 
@@ -293,6 +620,11 @@ struct atf_check_result_impl {
     atf_fs_path_t m_stdout;
     atf_fs_path_t m_stderr;
     atf_process_status_t m_status;
+    struct exec_stats m_stats;
+
+    /* NULL unless the command ran with bounded capture. */
+    atf_check_capture_t *m_stdout_capture;
+    atf_check_capture_t *m_stderr_capture;
 };
 
 static
@@ -305,6 +637,8 @@ atf_check_result_init(atf_check_result_t *r, const char *const *argv,
     r->pimpl = malloc(sizeof(struct atf_check_result_impl));
     if (r->pimpl == NULL)
         return atf_no_memory_error();
+    r->pimpl->m_stdout_capture = NULL;
+    r->pimpl->m_stderr_capture = NULL;
 
     err = array_to_list(argv, &r->pimpl->m_argv);
     if (atf_is_error(err))
@@ -337,13 +671,63 @@ out:
     return err;
 }
 
+static
+void
+free_captures(atf_check_result_t *r)
+{
+    if (r->pimpl->m_stdout_capture != NULL) {
+        capture_fini(r->pimpl->m_stdout_capture);
+        free(r->pimpl->m_stdout_capture);
+        r->pimpl->m_stdout_capture = NULL;
+    }
+    if (r->pimpl->m_stderr_capture != NULL) {
+        capture_fini(r->pimpl->m_stderr_capture);
+        free(r->pimpl->m_stderr_capture);
+        r->pimpl->m_stderr_capture = NULL;
+    }
+}
+
+static
+atf_error_t
+alloc_capture(const size_t limit, atf_check_capture_t **c)
+{
+    atf_error_t err;
+
+    *c = malloc(sizeof(atf_check_capture_t));
+    if (*c == NULL)
+        return atf_no_memory_error();
+
+    err = capture_init(*c, limit);
+    if (atf_is_error(err)) {
+        free(*c);
+        *c = NULL;
+    }
+    return err;
+}
+
+static
+atf_error_t
+atf_check_result_init_captures(atf_check_result_t *r, const size_t limit)
+{
+    atf_error_t err;
+
+    err = alloc_capture(limit, &r->pimpl->m_stdout_capture);
+    if (atf_is_error(err))
+        return err;
+
+    err = alloc_capture(limit, &r->pimpl->m_stderr_capture);
+    if (atf_is_error(err))
+        free_captures(r);
+    return err;
+}
+
 void
 atf_check_result_fini(atf_check_result_t *r)
 {
     atf_process_status_fini(&r->pimpl->m_status);
+    free_captures(r);
 
-    cleanup_tmpdir(&r->pimpl->m_dir, &r->pimpl->m_stdout,
-                   &r->pimpl->m_stderr);
+    cleanup_tmpdir(&r->pimpl->m_dir);
     atf_fs_path_fini(&r->pimpl->m_stdout);
     atf_fs_path_fini(&r->pimpl->m_stderr);
     atf_fs_path_fini(&r->pimpl->m_dir);
@@ -389,6 +773,46 @@ atf_check_result_termsig(const atf_check_result_t *r)
     return atf_process_status_termsig(&r->pimpl->m_status);
 }
 
+/** Returns whether the command was killed because it exceeded the timeout
+ * given to atf_check_exec_array_timeout. */
+bool
+atf_check_result_timedout(const atf_check_result_t *r)
+{
+    return r->pimpl->m_stats.m_timedout;
+}
+
+/** Returns the wall time elapsed from the start of the command until its
+ * termination. */
+struct timeval
+atf_check_result_wall_time(const atf_check_result_t *r)
+{
+    return r->pimpl->m_stats.m_wall_time;
+}
+
+/** Returns the user plus system CPU time consumed by the command and by
+ * all the descendants it waited for. */
+struct timeval
+atf_check_result_cpu_time(const atf_check_result_t *r)
+{
+    return r->pimpl->m_stats.m_cpu_time;
+}
+
+/** Returns the summary of the stdout of a command executed by
+ * atf_check_exec_array_bounded, or NULL for other commands. */
+const atf_check_capture_t *
+atf_check_result_stdout_capture(const atf_check_result_t *r)
+{
+    return r->pimpl->m_stdout_capture;
+}
+
+/** Returns the summary of the stderr of a command executed by
+ * atf_check_exec_array_bounded, or NULL for other commands. */
+const atf_check_capture_t *
+atf_check_result_stderr_capture(const atf_check_result_t *r)
+{
+    return r->pimpl->m_stderr_capture;
+}
+
 /* ---------------------------------------------------------------------
  * Free functions.
  * --------------------------------------------------------------------- */
@@ -456,11 +880,18 @@ out:
     return err;
 }
 
+/* A zero 'limit' captures the whole output into files; otherwise, only a
+ * summary of each stream is kept, plus its full copy if requested in
+ * 'keep'. */
+static
 atf_error_t
-atf_check_exec_array(const char *const *argv, atf_check_result_t *r)
+exec_array(const char *const *argv, const int fwdfd,
+           const struct timeval *timeout, const size_t limit, const int keep,
+           atf_check_result_t *r)
 {
     atf_error_t err;
     atf_fs_path_t dir;
+    const atf_fs_path_t *outfile, *errfile;
 
     err = create_tmpdir(&dir);
     if (atf_is_error(err))
@@ -473,16 +904,107 @@ atf_check_exec_array(const char *const *argv, atf_check_result_t *r)
         goto out;
     }
 
-    err = fork_and_wait(argv, &r->pimpl->m_stdout, &r->pimpl->m_stderr,
-                        &r->pimpl->m_status);
+    outfile = &r->pimpl->m_stdout;
+    errfile = &r->pimpl->m_stderr;
+    if (limit > 0) {
+        err = atf_check_result_init_captures(r, limit);
+        if (atf_is_error(err)) {
+            atf_check_result_fini(r);
+            goto out;
+        }
+        if (!(keep & ATF_CHECK_KEEP_STDOUT))
+            outfile = NULL;
+        if (!(keep & ATF_CHECK_KEEP_STDERR))
+            errfile = NULL;
+    }
+
+    err = fork_and_wait(argv, outfile, r->pimpl->m_stdout_capture,
+                        errfile, r->pimpl->m_stderr_capture,
+                        fwdfd, keep & ATF_CHECK_INHERIT_FDS, timeout,
+                        &r->pimpl->m_status,
+                        &r->pimpl->m_stats);
     if (atf_is_error(err)) {
         atf_check_result_fini(r);
         goto out;
     }
 
+    if (r->pimpl->m_stdout_capture != NULL) {
+        capture_finish(r->pimpl->m_stdout_capture);
+        capture_finish(r->pimpl->m_stderr_capture);
+    }
+
     INV(!atf_is_error(err));
 
     atf_fs_path_fini(&dir);
 out:
     return err;
 }
+
+atf_error_t
+atf_check_exec_array(const char *const *argv, atf_check_result_t *r)
+{
+    return exec_array(argv, -1, NULL, 0, 0, r);
+}
+
+/** Executes a command like atf_check_exec_array but also forwards its
+ * stdout and stderr to the given descriptor as they are produced.
+ *
+ * The output is still captured into the files returned by the result
+ * object, so the caller can inspect it once the command terminates. */
+atf_error_t
+atf_check_exec_array_tee(const char *const *argv, const int fwdfd,
+                         atf_check_result_t *r)
+{
+    PRE(fwdfd >= 0);
+    return exec_array(argv, fwdfd, NULL, 0, 0, r);
+}
+
+/** Executes a command like atf_check_exec_array but kills it if it runs
+ * for longer than the given timeout.
+ *
+ * The command runs in its own process group and the whole group receives
+ * a SIGKILL when the timeout expires, so that descendants of the command
+ * do not outlive it.  atf_check_result_timedout tells whether this
+ * happened.  If fwdfd is not -1, the output of the command is also
+ * forwarded to it as in atf_check_exec_array_tee.  SIGALRM and the real
+ * interval timer of the caller are saved and restored around the wait. */
+atf_error_t
+atf_check_exec_array_timeout(const char *const *argv, const int fwdfd,
+                             const struct timeval *timeout,
+                             atf_check_result_t *r)
+{
+    PRE(fwdfd >= -1);
+    PRE(timeout != NULL);
+    PRE(timeout->tv_sec > 0 || timeout->tv_usec > 0);
+    return exec_array(argv, fwdfd, timeout, 0, 0, r);
+}
+
+/** Executes a command keeping only a bounded summary of its output.
+ *
+ * Instead of storing the full stdout and stderr of the command, this only
+ * keeps their digest, their size and their first and last 'limit' bytes,
+ * which are available through atf_check_result_stdout_capture and
+ * atf_check_result_stderr_capture.  The streams selected in 'keep' with
+ * ATF_CHECK_KEEP_STDOUT and ATF_CHECK_KEEP_STDERR are additionally stored
+ * in full in the files returned by atf_check_result_stdout and
+ * atf_check_result_stderr; the files of the other streams do not exist.
+ * A zero 'limit' stores both streams in full as atf_check_exec_array does.
+ * 'fwdfd' and 'timeout' behave as in atf_check_exec_array_timeout, but
+ * both can be omitted by passing -1 and NULL respectively.
+ *
+ * The command does not inherit the descriptors of the caller above stderr
+ * unless ATF_CHECK_INHERIT_FDS is also set in 'keep'. */
+atf_error_t
+atf_check_exec_array_bounded(const char *const *argv, const int fwdfd,
+                             const struct timeval *timeout,
+                             const size_t limit, const int keep,
+                             atf_check_result_t *r)
+{
+    PRE(fwdfd >= -1);
+    PRE(timeout == NULL || timeout->tv_sec > 0 || timeout->tv_usec > 0);
+    PRE(limit > 0 ||
+        (keep & (ATF_CHECK_KEEP_STDOUT | ATF_CHECK_KEEP_STDERR)) == 0);
+    PRE((keep & ~(ATF_CHECK_KEEP_STDOUT | ATF_CHECK_KEEP_STDERR |
+                  ATF_CHECK_INHERIT_FDS)) == 0);
+    return exec_array(argv, fwdfd, timeout, limit, keep, r);
+}
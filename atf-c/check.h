@@ -30,10 +30,28 @@
 #if !defined(ATF_C_CHECK_H)
 #define ATF_C_CHECK_H
 
+#include <sys/time.h>
+
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include <atf-c/error_fwd.h>
 
+/* ---------------------------------------------------------------------
+ * The "atf_check_capture" type.
+ * --------------------------------------------------------------------- */
+
+struct atf_check_capture;
+typedef struct atf_check_capture atf_check_capture_t;
+
+/* Getters */
+uint64_t atf_check_capture_bytes(const atf_check_capture_t *);
+uint64_t atf_check_capture_lines(const atf_check_capture_t *);
+const char *atf_check_capture_digest(const atf_check_capture_t *);
+const char *atf_check_capture_head(const atf_check_capture_t *, size_t *);
+const char *atf_check_capture_tail(const atf_check_capture_t *, size_t *);
+
 /* ---------------------------------------------------------------------
  * The "atf_check_result" type.
  * --------------------------------------------------------------------- */
@@ -54,6 +72,13 @@ bool atf_check_result_exited(const atf_check_result_t *);
 int atf_check_result_exitcode(const atf_check_result_t *);
 bool atf_check_result_signaled(const atf_check_result_t *);
 int atf_check_result_termsig(const atf_check_result_t *);
+bool atf_check_result_timedout(const atf_check_result_t *);
+struct timeval atf_check_result_wall_time(const atf_check_result_t *);
+struct timeval atf_check_result_cpu_time(const atf_check_result_t *);
+const atf_check_capture_t *atf_check_result_stdout_capture(
+    const atf_check_result_t *);
+const atf_check_capture_t *atf_check_result_stderr_capture(
+    const atf_check_result_t *);
 
 /* ---------------------------------------------------------------------
  * Free functions.
@@ -69,5 +94,18 @@ atf_error_t atf_check_build_cxx_o(const char *, const char *,
                                   const char *const [],
                                   bool *);
 atf_error_t atf_check_exec_array(const char *const *, atf_check_result_t *);
+atf_error_t atf_check_exec_array_tee(const char *const *, const int,
+                                     atf_check_result_t *);
+atf_error_t atf_check_exec_array_timeout(const char *const *, const int,
+                                         const struct timeval *,
+                                         atf_check_result_t *);
+
+#define ATF_CHECK_KEEP_STDOUT 0x01
+#define ATF_CHECK_KEEP_STDERR 0x02
+#define ATF_CHECK_INHERIT_FDS 0x04
+atf_error_t atf_check_exec_array_bounded(const char *const *, const int,
+                                         const struct timeval *,
+                                         const size_t, const int,
+                                         atf_check_result_t *);
 
 #endif /* ATF_C_CHECK_H */
@@ -42,6 +42,7 @@
 #include "detail/fs.h"
 #include "detail/map.h"
 #include "detail/process.h"
+#include "detail/sha256.h"
 #include "detail/test_helpers.h"
 
 /* ---------------------------------------------------------------------
@@ -332,6 +333,75 @@ ATF_TC_BODY(exec_array, tc)
     atf_fs_path_fini(&process_helpers);
 }
 
+ATF_TC(exec_bounded);
+ATF_TC_HEAD(exec_bounded, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_check_exec_array_bounded "
+                      "only keeps a summary of the output of the command");
+}
+ATF_TC_BODY(exec_bounded, tc)
+{
+    atf_check_result_t result;
+    const atf_check_capture_t *c;
+    atf_sha256_t sha256;
+    char exp_digest[ATF_SHA256_HEX_LENGTH + 1];
+    char line[32];
+    const char *data;
+    size_t length;
+    int i;
+    const char *argv[4];
+
+    argv[0] = "/bin/sh";
+    argv[1] = "-c";
+    argv[2] = "i=0; while [ ${i} -lt 1000 ]; do echo \"line ${i}\"; "
+              "i=$((${i} + 1)); done; printf 'no newline' >&2";
+    argv[3] = NULL;
+
+    atf_sha256_init(&sha256);
+    for (i = 0; i < 1000; i++) {
+        snprintf(line, sizeof(line), "line %d\n", i);
+        atf_sha256_update(&sha256, line, strlen(line));
+    }
+    atf_sha256_final_hex(&sha256, exp_digest);
+
+    RE(atf_check_exec_array_bounded(argv, -1, NULL, 64,
+                                    ATF_CHECK_KEEP_STDERR, &result));
+    ATF_CHECK(atf_check_result_exited(&result));
+    ATF_CHECK_EQ(EXIT_SUCCESS, atf_check_result_exitcode(&result));
+
+    c = atf_check_result_stdout_capture(&result);
+    ATF_REQUIRE(c != NULL);
+    ATF_CHECK_EQ(8890, atf_check_capture_bytes(c));
+    ATF_CHECK_EQ(1000, atf_check_capture_lines(c));
+    ATF_CHECK_STREQ(exp_digest, atf_check_capture_digest(c));
+    data = atf_check_capture_head(c, &length);
+    ATF_CHECK_EQ(64, length);
+    ATF_CHECK(strncmp(data, "line 0\nline 1\n", 14) == 0);
+    data = atf_check_capture_tail(c, &length);
+    ATF_CHECK_EQ(64, length);
+    ATF_CHECK(strncmp(data + 64 - 18, "line 998\nline 999\n", 18) == 0);
+    ATF_CHECK(access(atf_check_result_stdout(&result), F_OK) == -1);
+
+    c = atf_check_result_stderr_capture(&result);
+    ATF_REQUIRE(c != NULL);
+    ATF_CHECK_EQ(10, atf_check_capture_bytes(c));
+    ATF_CHECK_EQ(1, atf_check_capture_lines(c));
+    data = atf_check_capture_head(c, &length);
+    ATF_CHECK_EQ(10, length);
+    ATF_CHECK(strncmp(data, "no newline", 10) == 0);
+    (void)atf_check_capture_tail(c, &length);
+    ATF_CHECK_EQ(0, length);
+    ATF_CHECK(atf_utils_compare_file(atf_check_result_stderr(&result),
+                                     "no newline"));
+
+    atf_check_result_fini(&result);
+
+    RE(atf_check_exec_array(argv, &result));
+    ATF_CHECK(atf_check_result_stdout_capture(&result) == NULL);
+    ATF_CHECK(atf_check_result_stderr_capture(&result) == NULL);
+    atf_check_result_fini(&result);
+}
+
 ATF_TC(exec_cleanup);
 ATF_TC_HEAD(exec_cleanup, tc)
 {
@@ -459,6 +529,152 @@ ATF_TC_BODY(exec_stdout_stderr, tc)
     atf_check_result_fini(&result1);
 }
 
+ATF_TC(exec_tee);
+ATF_TC_HEAD(exec_tee, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_check_exec_array_tee "
+                      "captures the stdout and stderr streams of the child "
+                      "process while forwarding them");
+}
+ATF_TC_BODY(exec_tee, tc)
+{
+    atf_check_result_t result;
+    atf_fs_path_t process_helpers;
+    const char *argv[4];
+    int fd;
+
+    get_process_helpers_path(tc, false, &process_helpers);
+    argv[0] = atf_fs_path_cstring(&process_helpers);
+    argv[1] = "stdout-stderr";
+    argv[2] = "result";
+    argv[3] = NULL;
+
+    fd = open("forwarded", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ATF_REQUIRE(fd != -1);
+    RE(atf_check_exec_array_tee(argv, fd, &result));
+    ATF_REQUIRE(close(fd) != -1);
+
+    ATF_CHECK(atf_check_result_exited(&result));
+    ATF_CHECK(atf_check_result_exitcode(&result) == EXIT_SUCCESS);
+
+    ATF_CHECK(atf_utils_compare_file(atf_check_result_stdout(&result),
+        "Line 1 to stdout for result\nLine 2 to stdout for result\n"));
+    ATF_CHECK(atf_utils_compare_file(atf_check_result_stderr(&result),
+        "Line 1 to stderr for result\nLine 2 to stderr for result\n"));
+
+    ATF_CHECK(atf_utils_grep_file("Line 2 to stdout for result", "forwarded"));
+    ATF_CHECK(atf_utils_grep_file("Line 2 to stderr for result", "forwarded"));
+
+    atf_check_result_fini(&result);
+    atf_fs_path_fini(&process_helpers);
+}
+
+ATF_TC(exec_timeout);
+ATF_TC_HEAD(exec_timeout, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_check_exec_array_timeout "
+                      "kills the process group of a command that runs for "
+                      "too long");
+}
+ATF_TC_BODY(exec_timeout, tc)
+{
+    atf_check_result_t result;
+    struct timeval timeout;
+    const char *argv[4];
+
+    argv[0] = "/bin/sh";
+    argv[1] = "-c";
+    argv[2] = "(sleep 2; touch grandchild) & echo started; sleep 30";
+    argv[3] = NULL;
+
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 500000;
+    RE(atf_check_exec_array_timeout(argv, -1, &timeout, &result));
+    ATF_CHECK(atf_check_result_timedout(&result));
+    ATF_CHECK(atf_check_result_signaled(&result));
+    ATF_CHECK_EQ(SIGKILL, atf_check_result_termsig(&result));
+    ATF_CHECK(atf_check_result_wall_time(&result).tv_sec < 30);
+    ATF_CHECK(atf_utils_compare_file(atf_check_result_stdout(&result),
+                                     "started\n"));
+    atf_check_result_fini(&result);
+
+    sleep(3);
+    ATF_CHECK_MSG(access("grandchild", F_OK) == -1,
+                  "The descendants of the command were not killed");
+
+    argv[2] = "exit 3";
+    timeout.tv_sec = 30;
+    timeout.tv_usec = 0;
+    RE(atf_check_exec_array_timeout(argv, -1, &timeout, &result));
+    ATF_CHECK(!atf_check_result_timedout(&result));
+    ATF_CHECK(atf_check_result_exited(&result));
+    ATF_CHECK_EQ(3, atf_check_result_exitcode(&result));
+    atf_check_result_fini(&result);
+}
+
+ATF_TC(exec_timeout_forward);
+ATF_TC_HEAD(exec_timeout_forward, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_check_exec_array_timeout "
+                      "kills a command even if nobody reads its forwarded "
+                      "output");
+    atf_tc_set_md_var(tc, "timeout", "30");
+}
+ATF_TC_BODY(exec_timeout_forward, tc)
+{
+    atf_check_result_t result;
+    struct timeval timeout;
+    const char *argv[4];
+    int fds[2];
+
+    argv[0] = "/bin/sh";
+    argv[1] = "-c";
+    argv[2] = "i=0; while [ $i -lt 20000 ]; do "
+        "echo 0123456789012345678901234567890123456789; i=$(($i + 1)); "
+        "done; sleep 30";
+    argv[3] = NULL;
+
+    ATF_REQUIRE(pipe(fds) != -1);
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    RE(atf_check_exec_array_timeout(argv, fds[1], &timeout, &result));
+    ATF_CHECK(atf_check_result_timedout(&result));
+    ATF_CHECK(atf_check_result_wall_time(&result).tv_sec < 20);
+    atf_check_result_fini(&result);
+    ATF_REQUIRE(close(fds[0]) != -1);
+    ATF_REQUIRE(close(fds[1]) != -1);
+}
+
+ATF_TC(exec_times);
+ATF_TC_HEAD(exec_times, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_check_exec_array "
+                      "measures the wall and CPU time used by the command");
+}
+ATF_TC_BODY(exec_times, tc)
+{
+    atf_check_result_t result;
+    struct timeval wall, cpu;
+    const char *argv[4];
+
+    argv[0] = "/bin/sh";
+    argv[1] = "-c";
+    argv[2] = "sleep 1";
+    argv[3] = NULL;
+
+    RE(atf_check_exec_array(argv, &result));
+    ATF_CHECK(!atf_check_result_timedout(&result));
+    wall = atf_check_result_wall_time(&result);
+    cpu = atf_check_result_cpu_time(&result);
+    printf("Wall time: %ld.%06ld, CPU time: %ld.%06ld\n",
+           (long)wall.tv_sec, (long)wall.tv_usec,
+           (long)cpu.tv_sec, (long)cpu.tv_usec);
+    ATF_CHECK(wall.tv_sec >= 1 || wall.tv_usec >= 900000);
+    ATF_CHECK(wall.tv_sec < 30);
+    ATF_CHECK(timercmp(&cpu, &wall, <));
+    atf_check_result_fini(&result);
+}
+
 ATF_TC(exec_umask);
 ATF_TC_HEAD(exec_umask, tc)
 {
@@ -526,9 +742,14 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, build_cpp);
     ATF_TP_ADD_TC(tp, build_cxx_o);
     ATF_TP_ADD_TC(tp, exec_array);
+    ATF_TP_ADD_TC(tp, exec_bounded);
     ATF_TP_ADD_TC(tp, exec_cleanup);
     ATF_TP_ADD_TC(tp, exec_exitstatus);
     ATF_TP_ADD_TC(tp, exec_stdout_stderr);
+    ATF_TP_ADD_TC(tp, exec_tee);
+    ATF_TP_ADD_TC(tp, exec_timeout);
+    ATF_TP_ADD_TC(tp, exec_timeout_forward);
+    ATF_TP_ADD_TC(tp, exec_times);
     ATF_TP_ADD_TC(tp, exec_umask);
     ATF_TP_ADD_TC(tp, exec_unknown);
 
@@ -39,6 +39,7 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <libgen.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -65,6 +66,12 @@ static atf_error_t do_mkdtemp(char *);
 static atf_error_t normalize(atf_dynstr_t *, char *);
 static atf_error_t normalize_ap(atf_dynstr_t *, const char *, va_list);
 static void replace_contents(atf_fs_path_t *, const char *);
+static atf_error_t rmtree_at(const int, const char *, const bool,
+                             const char *);
+static atf_error_t rmtree_next_subdir(const int, const char *, char **);
+static atf_error_t rmtree_open(const int, const char *, const char *, int *,
+                               struct stat *);
+static atf_error_t set_stat_type(atf_fs_stat_t *, const char *);
 static const char *stat_type_to_string(const int);
 
 /* ---------------------------------------------------------------------
@@ -310,6 +317,316 @@ replace_contents(atf_fs_path_t *p, const char *buf)
     INV(!atf_is_error(err));
 }
 
+static
+atf_error_t
+set_stat_type(atf_fs_stat_t *st, const char *pstr)
+{
+    atf_error_t err;
+    int type = st->m_sb.st_mode & S_IFMT;
+
+    err = atf_no_error();
+    switch (type) {
+        case S_IFBLK:  st->m_type = atf_fs_stat_blk_type;  break;
+        case S_IFCHR:  st->m_type = atf_fs_stat_chr_type;  break;
+        case S_IFDIR:  st->m_type = atf_fs_stat_dir_type;  break;
+        case S_IFIFO:  st->m_type = atf_fs_stat_fifo_type; break;
+        case S_IFLNK:  st->m_type = atf_fs_stat_lnk_type;  break;
+        case S_IFREG:  st->m_type = atf_fs_stat_reg_type;  break;
+        case S_IFSOCK: st->m_type = atf_fs_stat_sock_type; break;
+#if defined(S_IFWHT)
+        case S_IFWHT:  st->m_type = atf_fs_stat_wht_type;  break;
+#endif
+        default:
+            err = unknown_type_error(pstr, type);
+    }
+
+    return err;
+}
+
+/*
+ * A directory being emptied by rmtree_at.  Only the directory at the bottom
+ * of the walk has a descriptor open, so the depth of the tree is not
+ * limited by the number of open files.  The ancestors are reopened through
+ * ".." when the walk goes back up, and their device and inode numbers make
+ * sure that this reaches the directory that was left.
+ */
+struct rmtree_level {
+    struct rmtree_level *m_parent;
+    char *m_name;  /* Name within the parent; NULL for the top level. */
+    dev_t m_dev;
+    ino_t m_ino;
+};
+
+static
+atf_error_t
+rmtree_push(struct rmtree_level **top, const char *name, const struct stat *sb)
+{
+    atf_error_t err;
+    struct rmtree_level *level;
+
+    level = malloc(sizeof(*level));
+    if (level == NULL) {
+        err = atf_no_memory_error();
+        goto out;
+    }
+
+    if (name == NULL)
+        level->m_name = NULL;
+    else {
+        level->m_name = strdup(name);
+        if (level->m_name == NULL) {
+            free(level);
+            err = atf_no_memory_error();
+            goto out;
+        }
+    }
+    level->m_parent = *top;
+    level->m_dev = sb->st_dev;
+    level->m_ino = sb->st_ino;
+    *top = level;
+    err = atf_no_error();
+
+out:
+    return err;
+}
+
+static
+void
+rmtree_pop(struct rmtree_level **top)
+{
+    struct rmtree_level *level = *top;
+
+    *top = level->m_parent;
+    free(level->m_name);
+    free(level);
+}
+
+/*
+ * Removes the entry 'name' of the directory open in dirfd and, if it is a
+ * directory, everything below it.  Entries are always addressed relative
+ * to their parent's descriptor, so the walk neither builds nor resolves
+ * full paths, and it goes down and back up the tree instead of recursing
+ * so that only one directory is open at a time.  'root' is only used to
+ * report errors.
+ */
+static
+atf_error_t
+rmtree_at(const int dirfd, const char *name, const bool is_dir,
+          const char *root)
+{
+    atf_error_t err;
+    struct rmtree_level *top = NULL;
+    struct stat sb;
+    int fd = -1;
+
+    if (!is_dir)
+        goto remove;
+
+    err = rmtree_open(dirfd, name, root, &fd, &sb);
+    if (atf_is_error(err))
+        goto out;
+    err = rmtree_push(&top, NULL, &sb);
+    if (atf_is_error(err))
+        goto out_fd;
+
+    for (;;) {
+        char *subdir;
+        int newfd;
+
+        err = rmtree_next_subdir(fd, root, &subdir);
+        if (atf_is_error(err))
+            goto out_fd;
+
+        if (subdir != NULL) {
+            err = rmtree_open(fd, subdir, root, &newfd, &sb);
+            if (!atf_is_error(err)) {
+                err = rmtree_push(&top, subdir, &sb);
+                if (atf_is_error(err))
+                    close(newfd);
+            }
+            free(subdir);
+            if (atf_is_error(err))
+                goto out_fd;
+        } else if (top->m_parent == NULL) {
+            /* The top level is removed through the caller's descriptor. */
+            break;
+        } else {
+            newfd = openat(fd, "..", O_RDONLY | O_DIRECTORY);
+            if (newfd == -1) {
+                err = atf_libc_error(errno, "Cannot go back to the parent "
+                                     "of %s while removing %s", top->m_name,
+                                     root);
+                goto out_fd;
+            }
+            if (fstat(newfd, &sb) == -1) {
+                err = atf_libc_error(errno, "Cannot get information of the "
+                                     "parent of %s while removing %s",
+                                     top->m_name, root);
+                close(newfd);
+                goto out_fd;
+            }
+            if (sb.st_dev != top->m_parent->m_dev ||
+                sb.st_ino != top->m_parent->m_ino) {
+                err = atf_libc_error(ENOENT, "The parent of %s was moved "
+                                     "while removing %s", top->m_name, root);
+                close(newfd);
+                goto out_fd;
+            }
+            if (unlinkat(newfd, top->m_name, AT_REMOVEDIR) == -1) {
+                err = atf_libc_error(errno, "Cannot remove %s while "
+                                     "removing %s", top->m_name, root);
+                close(newfd);
+                goto out_fd;
+            }
+            rmtree_pop(&top);
+        }
+
+        close(fd);
+        fd = newfd;
+    }
+    close(fd);
+    fd = -1;
+
+remove:
+    if (unlinkat(dirfd, name, is_dir ? AT_REMOVEDIR : 0) == -1)
+        err = atf_libc_error(errno, "Cannot remove %s while removing %s",
+                             name, root);
+    else
+        err = atf_no_error();
+
+out_fd:
+    if (fd != -1)
+        close(fd);
+out:
+    while (top != NULL)
+        rmtree_pop(&top);
+    return err;
+}
+
+/*
+ * Removes the entries of the directory open in fd that are not
+ * directories, up to its first subdirectory, whose name is returned in
+ * 'subdir' so that the caller empties it first.  Sets 'subdir' to NULL if
+ * the directory is empty on return.  fd is left open.
+ */
+static
+atf_error_t
+rmtree_next_subdir(const int fd, const char *root, char **subdir)
+{
+    atf_error_t err;
+    DIR *dir;
+    struct dirent *de;
+    int dupfd;
+
+    *subdir = NULL;
+
+    dupfd = dup(fd);
+    if (dupfd == -1) {
+        err = atf_libc_error(errno, "Cannot read directory while removing "
+                             "%s", root);
+        goto out;
+    }
+    dir = fdopendir(dupfd);
+    if (dir == NULL) {
+        err = atf_libc_error(errno, "Cannot read directory while removing "
+                             "%s", root);
+        close(dupfd);
+        goto out;
+    }
+    rewinddir(dir);
+
+    err = atf_no_error();
+    while (!atf_is_error(err) && *subdir == NULL) {
+        bool is_dir;
+
+        errno = 0;
+        de = readdir(dir);
+        if (de == NULL) {
+            if (errno != 0)
+                err = atf_libc_error(errno, "Cannot read directory while "
+                                     "removing %s", root);
+            break;
+        }
+
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+
+#if defined(DT_UNKNOWN)
+        if (de->d_type != DT_UNKNOWN)
+            is_dir = de->d_type == DT_DIR;
+        else
+#endif
+        {
+            struct stat sb;
+
+            if (fstatat(fd, de->d_name, &sb, AT_SYMLINK_NOFOLLOW) == -1) {
+                err = atf_libc_error(errno, "Cannot get information of %s "
+                                     "while removing %s", de->d_name, root);
+                break;
+            }
+            is_dir = S_ISDIR(sb.st_mode);
+        }
+
+        if (is_dir) {
+            *subdir = strdup(de->d_name);
+            if (*subdir == NULL)
+                err = atf_no_memory_error();
+        } else if (unlinkat(fd, de->d_name, 0) == -1)
+            err = atf_libc_error(errno, "Cannot remove %s while removing %s",
+                                 de->d_name, root);
+    }
+
+    closedir(dir);
+out:
+    return err;
+}
+
+/*
+ * Opens the directory 'name' of the directory open in dirfd to remove its
+ * contents, and returns its status in 'sb'.  Test cases often leave
+ * read-only or unsearchable directories behind, so the owner is given full
+ * access to the directory if it lacks any of it; the directory is about to
+ * go away anyway.
+ */
+static
+atf_error_t
+rmtree_open(const int dirfd, const char *name, const char *root, int *fdout,
+            struct stat *sb)
+{
+    atf_error_t err;
+    int fd;
+
+    fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (fd == -1 && errno == EACCES && fchmodat(dirfd, name, S_IRWXU, 0) != -1)
+        fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (fd == -1) {
+        err = atf_libc_error(errno, "Cannot open directory %s while "
+                             "removing %s", name, root);
+        goto out;
+    }
+
+    if (fstat(fd, sb) == -1) {
+        err = atf_libc_error(errno, "Cannot get information of %s while "
+                             "removing %s", name, root);
+        close(fd);
+        goto out;
+    }
+
+    if ((sb->st_mode & S_IRWXU) != S_IRWXU &&
+        fchmod(fd, (sb->st_mode & 07777) | S_IRWXU) == -1) {
+        err = atf_libc_error(errno, "Cannot change permissions of %s while "
+                             "removing %s", name, root);
+        close(fd);
+        goto out;
+    }
+
+    *fdout = fd;
+    err = atf_no_error();
+
+out:
+    return err;
+}
+
 static
 const char *
 stat_type_to_string(const int type)
@@ -555,24 +872,27 @@ atf_fs_stat_init(atf_fs_stat_t *st, const atf_fs_path_t *p)
     if (lstat(pstr, &st->m_sb) == -1) {
         err = atf_libc_error(errno, "Cannot get information of %s; "
                              "lstat(2) failed", pstr);
-    } else {
-        int type = st->m_sb.st_mode & S_IFMT;
-        err = atf_no_error();
-        switch (type) {
-            case S_IFBLK:  st->m_type = atf_fs_stat_blk_type;  break;
-            case S_IFCHR:  st->m_type = atf_fs_stat_chr_type;  break;
-            case S_IFDIR:  st->m_type = atf_fs_stat_dir_type;  break;
-            case S_IFIFO:  st->m_type = atf_fs_stat_fifo_type; break;
-            case S_IFLNK:  st->m_type = atf_fs_stat_lnk_type;  break;
-            case S_IFREG:  st->m_type = atf_fs_stat_reg_type;  break;
-            case S_IFSOCK: st->m_type = atf_fs_stat_sock_type; break;
-#if defined(S_IFWHT)
-            case S_IFWHT:  st->m_type = atf_fs_stat_wht_type;  break;
-#endif
-            default:
-                err = unknown_type_error(pstr, type);
-        }
-    }
+    } else
+        err = set_stat_type(st, pstr);
+
+    return err;
+}
+
+/*
+ * Like atf_fs_stat_init, but the name is resolved relative to the
+ * directory open in dirfd, which saves building and resolving the full
+ * path of every entry when walking a directory.
+ */
+atf_error_t
+atf_fs_stat_init_at(atf_fs_stat_t *st, const int dirfd, const char *name)
+{
+    atf_error_t err;
+
+    if (fstatat(dirfd, name, &st->m_sb, AT_SYMLINK_NOFOLLOW) == -1) {
+        err = atf_libc_error(errno, "Cannot get information of %s; "
+                             "fstatat(2) failed", name);
+    } else
+        err = set_stat_type(st, name);
 
     return err;
 }
@@ -611,6 +931,12 @@ atf_fs_stat_get_mode(const atf_fs_stat_t *st)
     return st->m_sb.st_mode & ~S_IFMT;
 }
 
+time_t
+atf_fs_stat_get_mtime(const atf_fs_stat_t *st)
+{
+    return st->m_sb.st_mtime;
+}
+
 off_t
 atf_fs_stat_get_size(const atf_fs_stat_t *st)
 {
@@ -871,6 +1197,29 @@ atf_fs_rmdir(const atf_fs_path_t *p)
     return err;
 }
 
+/*
+ * Removes the given path and, if it is a directory, everything below it,
+ * fixing the permissions of the directories that would otherwise prevent
+ * it.  Symbolic links are removed, never followed.
+ */
+atf_error_t
+atf_fs_rmtree(const atf_fs_path_t *p)
+{
+    atf_error_t err;
+    const char *pstr;
+    struct stat sb;
+
+    pstr = atf_fs_path_cstring(p);
+
+    if (lstat(pstr, &sb) == -1)
+        err = atf_libc_error(errno, "Cannot get information of %s; "
+                             "lstat(2) failed", pstr);
+    else
+        err = rmtree_at(AT_FDCWD, pstr, S_ISDIR(sb.st_mode), pstr);
+
+    return err;
+}
+
 atf_error_t
 atf_fs_unlink(const atf_fs_path_t *p)
 {
@@ -94,6 +94,7 @@ extern const int atf_fs_stat_wht_type;
 
 /* Constructors/destructors. */
 atf_error_t atf_fs_stat_init(atf_fs_stat_t *, const atf_fs_path_t *);
+atf_error_t atf_fs_stat_init_at(atf_fs_stat_t *, const int, const char *);
 void atf_fs_stat_copy(atf_fs_stat_t *, const atf_fs_stat_t *);
 void atf_fs_stat_fini(atf_fs_stat_t *);
 
@@ -101,6 +102,7 @@ void atf_fs_stat_fini(atf_fs_stat_t *);
 dev_t atf_fs_stat_get_device(const atf_fs_stat_t *);
 ino_t atf_fs_stat_get_inode(const atf_fs_stat_t *);
 mode_t atf_fs_stat_get_mode(const atf_fs_stat_t *);
+time_t atf_fs_stat_get_mtime(const atf_fs_stat_t *);
 off_t atf_fs_stat_get_size(const atf_fs_stat_t *);
 int atf_fs_stat_get_type(const atf_fs_stat_t *);
 bool atf_fs_stat_is_owner_readable(const atf_fs_stat_t *);
@@ -128,6 +130,7 @@ atf_error_t atf_fs_getcwd(atf_fs_path_t *);
 atf_error_t atf_fs_mkdtemp(atf_fs_path_t *);
 atf_error_t atf_fs_mkstemp(atf_fs_path_t *, int *);
 atf_error_t atf_fs_rmdir(const atf_fs_path_t *);
+atf_error_t atf_fs_rmtree(const atf_fs_path_t *);
 atf_error_t atf_fs_unlink(const atf_fs_path_t *);
 
 #endif /* !defined(ATF_C_FS_H) */
@@ -28,6 +28,7 @@
  */
 
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 
 #include <errno.h>
@@ -36,6 +37,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <utime.h>
 
 #include <atf-c.h>
 
@@ -457,6 +459,66 @@ ATF_TC_BODY(stat_mode, tc)
     atf_fs_path_fini(&p);
 }
 
+ATF_TC(stat_mtime);
+ATF_TC_HEAD(stat_mtime, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests the atf_fs_stat_get_mtime "
+                      "function");
+}
+ATF_TC_BODY(stat_mtime, tc)
+{
+    atf_fs_path_t p;
+    atf_fs_stat_t st;
+    struct utimbuf times;
+
+    create_file("f1", 0644);
+    times.actime = 1000000000;
+    times.modtime = 1234567890;
+    ATF_REQUIRE(utime("f1", &times) != -1);
+
+    RE(atf_fs_path_init_fmt(&p, "f1"));
+    RE(atf_fs_stat_init(&st, &p));
+    ATF_CHECK_EQ(1234567890, atf_fs_stat_get_mtime(&st));
+    atf_fs_stat_fini(&st);
+    atf_fs_path_fini(&p);
+}
+
+ATF_TC(stat_init_at);
+ATF_TC_HEAD(stat_init_at, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests the atf_fs_stat_init_at "
+                      "constructor");
+}
+ATF_TC_BODY(stat_init_at, tc)
+{
+    atf_fs_stat_t st;
+    atf_error_t err;
+    int dirfd;
+
+    create_dir("dir", 0755);
+    create_dir("dir/sub", 0755);
+    create_file("dir/reg", 0644);
+
+    dirfd = open("dir", O_RDONLY);
+    ATF_REQUIRE(dirfd != -1);
+
+    RE(atf_fs_stat_init_at(&st, dirfd, "sub"));
+    ATF_REQUIRE_EQ(atf_fs_stat_get_type(&st), atf_fs_stat_dir_type);
+    atf_fs_stat_fini(&st);
+
+    RE(atf_fs_stat_init_at(&st, dirfd, "reg"));
+    ATF_REQUIRE_EQ(atf_fs_stat_get_type(&st), atf_fs_stat_reg_type);
+    atf_fs_stat_fini(&st);
+
+    err = atf_fs_stat_init_at(&st, dirfd, "missing");
+    ATF_REQUIRE(atf_is_error(err));
+    ATF_REQUIRE(atf_error_is(err, "libc"));
+    ATF_REQUIRE_EQ(atf_libc_error_code(err), ENOENT);
+    atf_error_free(err);
+
+    close(dirfd);
+}
+
 ATF_TC(stat_type);
 ATF_TC_HEAD(stat_type, tc)
 {
@@ -812,6 +874,120 @@ ATF_TC_BODY(rmdir_eperm, tc)
     atf_fs_path_fini(&p);
 }
 
+ATF_TC(rmtree);
+ATF_TC_HEAD(rmtree, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests the atf_fs_rmtree function");
+}
+ATF_TC_BODY(rmtree, tc)
+{
+    atf_fs_path_t p;
+
+    create_dir("outside", 0755);
+    create_file("outside/keep", 0644);
+
+    create_dir("test-dir", 0755);
+    create_file("test-dir/foo", 0644);
+    create_dir("test-dir/a", 0755);
+    create_dir("test-dir/a/b", 0755);
+    create_file("test-dir/a/b/bar", 0444);
+    ATF_REQUIRE(symlink("../outside", "test-dir/a/link") != -1);
+
+    RE(atf_fs_path_init_fmt(&p, "test-dir"));
+    RE(atf_fs_rmtree(&p));
+    ATF_REQUIRE(!exists(&p));
+    atf_fs_path_fini(&p);
+
+    RE(atf_fs_path_init_fmt(&p, "outside/keep"));
+    ATF_REQUIRE(exists(&p));
+    RE(atf_fs_rmtree(&p));
+    ATF_REQUIRE(!exists(&p));
+    atf_fs_path_fini(&p);
+}
+
+ATF_TC(rmtree_perms);
+ATF_TC_HEAD(rmtree_perms, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_fs_rmtree fixes the "
+                      "permissions of the directories it removes");
+}
+ATF_TC_BODY(rmtree_perms, tc)
+{
+    atf_fs_path_t p;
+
+    create_dir("test-dir", 0755);
+    create_dir("test-dir/ro", 0755);
+    create_file("test-dir/ro/foo", 0644);
+    ATF_REQUIRE(chmod("test-dir/ro", 0555) != -1);
+    create_dir("test-dir/noexec", 0755);
+    create_file("test-dir/noexec/foo", 0644);
+    ATF_REQUIRE(chmod("test-dir/noexec", 0644) != -1);
+    create_dir("test-dir/none", 0755);
+    create_dir("test-dir/none/sub", 0755);
+    ATF_REQUIRE(chmod("test-dir/none", 0) != -1);
+    ATF_REQUIRE(chmod("test-dir", 0500) != -1);
+
+    RE(atf_fs_path_init_fmt(&p, "test-dir"));
+    RE(atf_fs_rmtree(&p));
+    ATF_REQUIRE(!exists(&p));
+    atf_fs_path_fini(&p);
+}
+
+ATF_TC(rmtree_deep);
+ATF_TC_HEAD(rmtree_deep, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_fs_rmtree removes "
+                      "trees deeper than the number of descriptors it can "
+                      "open");
+}
+ATF_TC_BODY(rmtree_deep, tc)
+{
+    atf_fs_path_t p;
+    char path[1024];
+    struct rlimit rl;
+    size_t len;
+    int i;
+
+    len = (size_t)snprintf(path, sizeof(path), "test-dir");
+    create_dir(path, 0755);
+    for (i = 0; i < 200; i++) {
+        len += (size_t)snprintf(path + len, sizeof(path) - len, "/d");
+        create_dir(path, 0755);
+    }
+    create_file("test-dir/d/foo", 0644);
+
+    ATF_REQUIRE(getrlimit(RLIMIT_NOFILE, &rl) != -1);
+    rl.rlim_cur = 32;
+    ATF_REQUIRE(setrlimit(RLIMIT_NOFILE, &rl) != -1);
+
+    RE(atf_fs_path_init_fmt(&p, "test-dir"));
+    RE(atf_fs_rmtree(&p));
+    ATF_REQUIRE(!exists(&p));
+    atf_fs_path_fini(&p);
+}
+
+ATF_TC(rmtree_missing);
+ATF_TC_HEAD(rmtree_missing, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_fs_rmtree reports "
+                      "missing paths");
+}
+ATF_TC_BODY(rmtree_missing, tc)
+{
+    atf_fs_path_t p;
+    atf_error_t err;
+
+    RE(atf_fs_path_init_fmt(&p, "test-dir"));
+
+    err = atf_fs_rmtree(&p);
+    ATF_REQUIRE(atf_is_error(err));
+    ATF_REQUIRE(atf_error_is(err, "libc"));
+    ATF_REQUIRE_EQ(atf_libc_error_code(err), ENOENT);
+    atf_error_free(err);
+
+    atf_fs_path_fini(&p);
+}
+
 ATF_TC(mkdtemp_ok);
 ATF_TC_HEAD(mkdtemp_ok, tc)
 {
@@ -1061,6 +1237,8 @@ ATF_TP_ADD_TCS(tp)
 
     /* Add the tests for the "atf_fs_stat" type. */
     ATF_TP_ADD_TC(tp, stat_mode);
+    ATF_TP_ADD_TC(tp, stat_mtime);
+    ATF_TP_ADD_TC(tp, stat_init_at);
     ATF_TP_ADD_TC(tp, stat_type);
     ATF_TP_ADD_TC(tp, stat_perms);
 
@@ -1071,6 +1249,10 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, rmdir_empty);
     ATF_TP_ADD_TC(tp, rmdir_enotempty);
     ATF_TP_ADD_TC(tp, rmdir_eperm);
+    ATF_TP_ADD_TC(tp, rmtree);
+    ATF_TP_ADD_TC(tp, rmtree_perms);
+    ATF_TP_ADD_TC(tp, rmtree_deep);
+    ATF_TP_ADD_TC(tp, rmtree_missing);
     ATF_TP_ADD_TC(tp, mkdtemp_ok);
     ATF_TP_ADD_TC(tp, mkdtemp_err);
     ATF_TP_ADD_TC(tp, mkdtemp_umask);
@@ -0,0 +1,244 @@
+/*
+ * Automated Testing Framework (atf)
+ *
+ * Copyright (c) 2014 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "atf-c/error.h"
+
+#include "line_reader.h"
+#include "sanity.h"
+
+/* The amount of data requested from the descriptor on every read. */
+static const size_t chunk_size = 4096;
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Copies the given range of the buffer into a new nul-terminated string.
+ */
+static
+atf_error_t
+extract(const atf_line_reader_t *lr, const size_t start, const size_t end,
+        char **line)
+{
+    atf_error_t err;
+
+    *line = malloc(end - start + 1);
+    if (*line == NULL)
+        err = atf_no_memory_error();
+    else {
+        memcpy(*line, lr->m_buf + start, end - start);
+        (*line)[end - start] = '\0';
+        err = atf_no_error();
+    }
+
+    return err;
+}
+
+/*
+ * Makes room for at least chunk_size more bytes at the end of the buffer,
+ * first by discarding the bytes already returned and then, if that is not
+ * enough, by doubling its size.
+ */
+static
+atf_error_t
+make_room(atf_line_reader_t *lr)
+{
+    atf_error_t err;
+
+    if (lr->m_start > 0) {
+        memmove(lr->m_buf, lr->m_buf + lr->m_start, lr->m_end - lr->m_start);
+        lr->m_scanned -= lr->m_start;
+        lr->m_end -= lr->m_start;
+        lr->m_start = 0;
+    }
+
+    if (lr->m_bufsize - lr->m_end < chunk_size) {
+        size_t newsize = lr->m_bufsize * 2;
+        char *newbuf;
+
+        while (newsize - lr->m_end < chunk_size)
+            newsize *= 2;
+        newbuf = realloc(lr->m_buf, newsize);
+        if (newbuf == NULL) {
+            err = atf_no_memory_error();
+            goto out;
+        }
+        lr->m_buf = newbuf;
+        lr->m_bufsize = newsize;
+    }
+
+    err = atf_no_error();
+out:
+    return err;
+}
+
+/*
+ * Appends as much data as is available from the descriptor, up to the free
+ * space in the buffer, and records whether the end of file was reached.
+ */
+static
+atf_error_t
+fill(atf_line_reader_t *lr)
+{
+    atf_error_t err;
+    ssize_t cnt;
+
+    err = make_room(lr);
+    if (atf_is_error(err))
+        goto out;
+
+    do {
+        cnt = read(lr->m_fd, lr->m_buf + lr->m_end,
+                   lr->m_bufsize - lr->m_end);
+    } while (cnt == -1 && errno == EINTR);
+
+    if (cnt == -1)
+        err = atf_libc_error(errno, "Failed to read from file descriptor %d",
+                             lr->m_fd);
+    else if (cnt == 0)
+        lr->m_eof = true;
+    else
+        lr->m_end += cnt;
+
+out:
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * The "atf_line_reader" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+/**
+ * Initializes a reader that returns the lines of the given descriptor.
+ *
+ * The reader reads the descriptor in large chunks, so it usually consumes
+ * more data than the lines it returns.  The descriptor must therefore not
+ * be read by other means while the reader holds pending data.
+ */
+atf_error_t
+atf_line_reader_init(atf_line_reader_t *lr, const int fd)
+{
+    atf_error_t err;
+
+    lr->m_buf = malloc(chunk_size);
+    if (lr->m_buf == NULL)
+        err = atf_no_memory_error();
+    else {
+        lr->m_fd = fd;
+        lr->m_bufsize = chunk_size;
+        lr->m_start = 0;
+        lr->m_scanned = 0;
+        lr->m_end = 0;
+        lr->m_eof = false;
+        err = atf_no_error();
+    }
+
+    return err;
+}
+
+void
+atf_line_reader_fini(atf_line_reader_t *lr)
+{
+    free(lr->m_buf);
+}
+
+/*
+ * Getters.
+ */
+
+/**
+ * Returns the number of bytes read from the descriptor but not returned
+ * as part of a line yet.
+ */
+size_t
+atf_line_reader_pending(const atf_line_reader_t *lr)
+{
+    return lr->m_end - lr->m_start;
+}
+
+/*
+ * Modifiers.
+ */
+
+/**
+ * Returns the next line, without its terminating newline, in a buffer that
+ * must be released with free().  Sets the line to NULL once there is
+ * nothing left to read.  The last line need not be terminated.
+ */
+atf_error_t
+atf_line_reader_next(atf_line_reader_t *lr, char **line)
+{
+    atf_error_t err;
+
+    for (;;) {
+        const char *nl = memchr(lr->m_buf + lr->m_scanned, '\n',
+                                lr->m_end - lr->m_scanned);
+        if (nl != NULL) {
+            const size_t end = nl - lr->m_buf;
+
+            err = extract(lr, lr->m_start, end, line);
+            if (!atf_is_error(err)) {
+                lr->m_start = end + 1;
+                lr->m_scanned = lr->m_start;
+            }
+            break;
+        }
+        lr->m_scanned = lr->m_end;
+
+        if (lr->m_eof) {
+            if (lr->m_start == lr->m_end) {
+                *line = NULL;
+                err = atf_no_error();
+            } else {
+                err = extract(lr, lr->m_start, lr->m_end, line);
+                if (!atf_is_error(err)) {
+                    lr->m_start = lr->m_end;
+                    lr->m_scanned = lr->m_end;
+                }
+            }
+            break;
+        }
+
+        err = fill(lr);
+        if (atf_is_error(err))
+            break;
+    }
+
+    return err;
+}
@@ -0,0 +1,63 @@
+/*
+ * Automated Testing Framework (atf)
+ *
+ * Copyright (c) 2014 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(ATF_C_LINE_READER_H)
+#define ATF_C_LINE_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <atf-c/error_fwd.h>
+
+/* ---------------------------------------------------------------------
+ * The "atf_line_reader" type.
+ * --------------------------------------------------------------------- */
+
+struct atf_line_reader {
+    int m_fd;
+    char *m_buf;
+    size_t m_bufsize;
+    size_t m_start;     /* First byte not yet returned. */
+    size_t m_scanned;   /* First byte not yet searched for a newline. */
+    size_t m_end;       /* One past the last byte read. */
+    bool m_eof;
+};
+typedef struct atf_line_reader atf_line_reader_t;
+
+/* Constructors/destructors. */
+atf_error_t atf_line_reader_init(atf_line_reader_t *, const int);
+void atf_line_reader_fini(atf_line_reader_t *);
+
+/* Getters. */
+size_t atf_line_reader_pending(const atf_line_reader_t *);
+
+/* Modifiers. */
+atf_error_t atf_line_reader_next(atf_line_reader_t *, char **);
+
+#endif /* ATF_C_LINE_READER_H */
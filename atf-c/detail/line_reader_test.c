@@ -0,0 +1,206 @@
+/*
+ * Automated Testing Framework (atf)
+ *
+ * Copyright (c) 2014 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atf-c.h>
+
+#include "line_reader.h"
+#include "test_helpers.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+void
+check_next(atf_line_reader_t *lr, const char *exp)
+{
+    char *line;
+
+    RE(atf_line_reader_next(lr, &line));
+    if (exp == NULL)
+        ATF_REQUIRE(line == NULL);
+    else {
+        ATF_REQUIRE(line != NULL);
+        ATF_REQUIRE_STREQ(exp, line);
+        free(line);
+    }
+}
+
+/* ---------------------------------------------------------------------
+ * Tests for the "atf_line_reader" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(empty);
+ATF_TC_HEAD(empty, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests reading an empty file");
+}
+ATF_TC_BODY(empty, tc)
+{
+    atf_line_reader_t lr;
+    int fd;
+
+    atf_utils_create_file("empty.txt", "%s", "");
+    ATF_REQUIRE((fd = open("empty.txt", O_RDONLY)) != -1);
+
+    RE(atf_line_reader_init(&lr, fd));
+    check_next(&lr, NULL);
+    check_next(&lr, NULL);
+    atf_line_reader_fini(&lr);
+
+    close(fd);
+}
+
+ATF_TC(lines);
+ATF_TC_HEAD(lines, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that the lines are returned "
+                      "without their terminators, including empty and "
+                      "unterminated ones");
+}
+ATF_TC_BODY(lines, tc)
+{
+    atf_line_reader_t lr;
+    int fd;
+
+    atf_utils_create_file("test.txt", "first\n\nthird\nlast");
+    ATF_REQUIRE((fd = open("test.txt", O_RDONLY)) != -1);
+
+    RE(atf_line_reader_init(&lr, fd));
+    check_next(&lr, "first");
+    ATF_REQUIRE_EQ(atf_line_reader_pending(&lr), strlen("\nthird\nlast"));
+    check_next(&lr, "");
+    check_next(&lr, "third");
+    check_next(&lr, "last");
+    ATF_REQUIRE_EQ(atf_line_reader_pending(&lr), 0);
+    check_next(&lr, NULL);
+    atf_line_reader_fini(&lr);
+
+    close(fd);
+}
+
+ATF_TC(long_lines);
+ATF_TC_HEAD(long_lines, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests reading lines that are longer "
+                      "than the internal buffer");
+}
+ATF_TC_BODY(long_lines, tc)
+{
+    const size_t length = 100000;
+    atf_line_reader_t lr;
+    char *buf;
+    int fd;
+
+    buf = malloc(length + 1);
+    ATF_REQUIRE(buf != NULL);
+    memset(buf, 'a', length);
+    buf[length] = '\0';
+
+    atf_utils_create_file("test.txt", "short\n%s\n%s", buf, buf);
+    ATF_REQUIRE((fd = open("test.txt", O_RDONLY)) != -1);
+
+    RE(atf_line_reader_init(&lr, fd));
+    check_next(&lr, "short");
+    check_next(&lr, buf);
+    check_next(&lr, buf);
+    check_next(&lr, NULL);
+    atf_line_reader_fini(&lr);
+
+    close(fd);
+    free(buf);
+}
+
+ATF_TC(pipe_writes);
+ATF_TC_HEAD(pipe_writes, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that lines split across several "
+                      "writes to a pipe are put back together and that "
+                      "complete lines are returned without waiting for "
+                      "more data");
+}
+ATF_TC_BODY(pipe_writes, tc)
+{
+    atf_line_reader_t lr;
+    int fds[2];
+
+    ATF_REQUIRE(pipe(fds) != -1);
+    RE(atf_line_reader_init(&lr, fds[0]));
+
+    ATF_REQUIRE(write(fds[1], "one\ntw", 6) == 6);
+    check_next(&lr, "one");
+    ATF_REQUIRE(write(fds[1], "o\nthr", 5) == 5);
+    check_next(&lr, "two");
+    ATF_REQUIRE(write(fds[1], "ee", 2) == 2);
+    close(fds[1]);
+    check_next(&lr, "three");
+    check_next(&lr, NULL);
+
+    atf_line_reader_fini(&lr);
+    close(fds[0]);
+}
+
+ATF_TC(read_error);
+ATF_TC_HEAD(read_error, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that read errors are reported");
+}
+ATF_TC_BODY(read_error, tc)
+{
+    atf_line_reader_t lr;
+    atf_error_t err;
+    char *line;
+
+    RE(atf_line_reader_init(&lr, -1));
+    err = atf_line_reader_next(&lr, &line);
+    ATF_REQUIRE(atf_is_error(err));
+    ATF_REQUIRE(atf_error_is(err, "libc"));
+    atf_error_free(err);
+    atf_line_reader_fini(&lr);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, empty);
+    ATF_TP_ADD_TC(tp, lines);
+    ATF_TP_ADD_TC(tp, long_lines);
+    ATF_TP_ADD_TC(tp, pipe_writes);
+    ATF_TP_ADD_TC(tp, read_error);
+
+    return atf_no_error();
+}
@@ -27,11 +27,20 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if defined(HAVE_CONFIG_H)
+#include "bconfig.h"
+#endif
+
 #include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -56,6 +65,9 @@ struct stream_prepare {
 
     bool m_pipefds_ok;
     int m_pipefds[2];
+
+    /* Valid if the stream is of type tee; -1 otherwise. */
+    int m_filefd;
 };
 typedef struct stream_prepare stream_prepare_t;
 
@@ -69,8 +81,10 @@ stream_prepare_init(stream_prepare_t *sp, const atf_process_stream_t *sb)
 
     sp->m_sb = sb;
     sp->m_pipefds_ok = false;
+    sp->m_filefd = -1;
 
-    if (type == atf_process_stream_type_capture) {
+    if (type == atf_process_stream_type_capture ||
+        type == atf_process_stream_type_tee) {
         if (pipe(sp->m_pipefds) == -1)
             err = atf_libc_error(errno, "Failed to create pipe");
         else {
@@ -80,6 +94,22 @@ stream_prepare_init(stream_prepare_t *sp, const atf_process_stream_t *sb)
     } else
         err = atf_no_error();
 
+    if (!atf_is_error(err) && type == atf_process_stream_type_tee &&
+        sb->m_path != NULL) {
+        /* The capture file is opened by the parent, which is the process
+         * in charge of filling it, so that errors are reported before
+         * forking the child. */
+        sp->m_filefd = open(atf_fs_path_cstring(sb->m_path),
+                            O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (sp->m_filefd == -1) {
+            err = atf_libc_error(errno, "Could not create %s",
+                                 atf_fs_path_cstring(sb->m_path));
+            close(sp->m_pipefds[0]);
+            close(sp->m_pipefds[1]);
+            sp->m_pipefds_ok = false;
+        }
+    }
+
     return err;
 }
 
@@ -91,6 +121,8 @@ stream_prepare_fini(stream_prepare_t *sp)
         close(sp->m_pipefds[0]);
         close(sp->m_pipefds[1]);
     }
+    if (sp->m_filefd != -1)
+        close(sp->m_filefd);
 }
 
 /* ---------------------------------------------------------------------
@@ -102,6 +134,7 @@ const int atf_process_stream_type_connect = 2;
 const int atf_process_stream_type_inherit = 3;
 const int atf_process_stream_type_redirect_fd = 4;
 const int atf_process_stream_type_redirect_path = 5;
+const int atf_process_stream_type_tee = 6;
 
 static
 bool
@@ -111,7 +144,8 @@ stream_is_valid(const atf_process_stream_t *sb)
            (sb->m_type == atf_process_stream_type_connect) ||
            (sb->m_type == atf_process_stream_type_inherit) ||
            (sb->m_type == atf_process_stream_type_redirect_fd) ||
-           (sb->m_type == atf_process_stream_type_redirect_path);
+           (sb->m_type == atf_process_stream_type_redirect_path) ||
+           (sb->m_type == atf_process_stream_type_tee);
 }
 
 atf_error_t
@@ -170,12 +204,54 @@ atf_process_stream_init_redirect_path(atf_process_stream_t *sb,
     return atf_no_error();
 }
 
+/** Initializes a stream that captures the output of the child into a file
+ * while forwarding it to a descriptor of the parent.
+ *
+ * The data flows through a pipe and is copied by the parent process while
+ * it waits for the child in atf_process_child_wait, so the output shows up
+ * in 'fd' as soon as the child writes it.  Either destination can be
+ * omitted by passing a NULL path or a -1 descriptor, which is useful when
+ * an observer set with atf_process_stream_set_observer is the one that
+ * consumes the data. */
+atf_error_t
+atf_process_stream_init_tee(atf_process_stream_t *sb,
+                            const atf_fs_path_t *path, const int fd)
+{
+    PRE(fd >= -1);
+
+    sb->m_type = atf_process_stream_type_tee;
+    sb->m_path = path;
+    sb->m_fd = fd;
+    sb->m_observer = NULL;
+    sb->m_observer_data = NULL;
+
+    POST(stream_is_valid(sb));
+    return atf_no_error();
+}
+
 void
 atf_process_stream_fini(atf_process_stream_t *sb)
 {
     PRE(stream_is_valid(sb));
 }
 
+/** Sets a function to be called with every chunk of data that goes through
+ * a tee stream, in addition to storing it in the file and forwarding it.
+ *
+ * The observer runs in the parent process from atf_process_child_wait and
+ * cannot fail, so it must not do anything that requires reporting errors
+ * back to the caller. */
+void
+atf_process_stream_set_observer(atf_process_stream_t *sb,
+                                void (*observer)(const char *, size_t, void *),
+                                void *data)
+{
+    PRE(atf_process_stream_type(sb) == atf_process_stream_type_tee);
+
+    sb->m_observer = observer;
+    sb->m_observer_data = data;
+}
+
 int
 atf_process_stream_type(const atf_process_stream_t *sb)
 {
@@ -184,6 +260,137 @@ atf_process_stream_type(const atf_process_stream_t *sb)
     return sb->m_type;
 }
 
+/* ---------------------------------------------------------------------
+ * The "atf_process_attrs" type.
+ * --------------------------------------------------------------------- */
+
+/** Initializes the attributes of a child process to their defaults.
+ *
+ * By default, the descriptors above stderr inherited from the parent are
+ * marked as close-on-exec in the child so that programs spawned from a
+ * test do not keep the test's pipes and sockets open. */
+atf_error_t
+atf_process_attrs_init(atf_process_attrs_t *attrs)
+{
+    attrs->m_close_fds = true;
+    attrs->m_nlimits = 0;
+    attrs->m_has_nice = false;
+    attrs->m_new_pgrp = false;
+
+    return atf_no_error();
+}
+
+void
+atf_process_attrs_fini(atf_process_attrs_t *attrs ATF_DEFS_ATTRIBUTE_UNUSED)
+{
+}
+
+bool
+atf_process_attrs_close_fds(const atf_process_attrs_t *attrs)
+{
+    return attrs->m_close_fds;
+}
+
+void
+atf_process_attrs_set_close_fds(atf_process_attrs_t *attrs, const bool value)
+{
+    attrs->m_close_fds = value;
+}
+
+/** Sets a resource limit for the child process.
+ *
+ * 'resource' is one of the RLIMIT_* constants accepted by setrlimit(2), such
+ * as RLIMIT_AS, RLIMIT_CORE, RLIMIT_CPU or RLIMIT_NOFILE.  The limit is set
+ * as both the soft and the hard limit so that the child cannot raise it
+ * again, and setting the same resource twice overrides the previous value. */
+void
+atf_process_attrs_set_limit(atf_process_attrs_t *attrs, const int resource,
+                            const rlim_t value)
+{
+    size_t i;
+
+    for (i = 0; i < attrs->m_nlimits; i++) {
+        if (attrs->m_limits[i].m_resource == resource) {
+            attrs->m_limits[i].m_value = value;
+            return;
+        }
+    }
+
+    PRE(attrs->m_nlimits < ATF_PROCESS_ATTRS_MAX_LIMITS);
+    attrs->m_limits[attrs->m_nlimits].m_resource = resource;
+    attrs->m_limits[attrs->m_nlimits].m_value = value;
+    attrs->m_nlimits++;
+}
+
+/** Sets the nice value of the child process.
+ *
+ * This is an absolute value, not an increment over the nice value of the
+ * parent.  Note that unprivileged processes can only lower their priority,
+ * so requesting a value below the current one makes the child fail. */
+void
+atf_process_attrs_set_nice(atf_process_attrs_t *attrs, const int value)
+{
+    attrs->m_has_nice = true;
+    attrs->m_nice = value;
+}
+
+/** Sets whether the child process is moved to a new process group.
+ *
+ * This allows the caller to signal the child and all of its descendants at
+ * once, for example to stop a command that runs for too long. */
+void
+atf_process_attrs_set_new_pgrp(atf_process_attrs_t *attrs, const bool value)
+{
+    attrs->m_new_pgrp = value;
+}
+
+static
+atf_error_t
+attrs_apply(const atf_process_attrs_t *attrs, const int *keep,
+            const size_t nkeep)
+{
+    atf_error_t err;
+    size_t i;
+
+    if (attrs->m_close_fds) {
+        err = atf_process_cloexec_fds(keep, nkeep);
+        if (atf_is_error(err))
+            goto out;
+    }
+
+    for (i = 0; i < attrs->m_nlimits; i++) {
+        const struct atf_process_limit *l = &attrs->m_limits[i];
+        struct rlimit rl;
+
+        rl.rlim_cur = l->m_value;
+        rl.rlim_max = l->m_value;
+        if (setrlimit(l->m_resource, &rl) == -1) {
+            err = atf_libc_error(errno, "Cannot set limit for resource %d",
+                                 l->m_resource);
+            goto out;
+        }
+    }
+
+    if (attrs->m_has_nice) {
+        if (setpriority(PRIO_PROCESS, 0, attrs->m_nice) == -1) {
+            err = atf_libc_error(errno, "Cannot set nice value to %d",
+                                 attrs->m_nice);
+            goto out;
+        }
+    }
+
+    if (attrs->m_new_pgrp) {
+        if (setpgid(0, 0) == -1) {
+            err = atf_libc_error(errno, "Cannot create a new process group");
+            goto out;
+        }
+    }
+
+    err = atf_no_error();
+out:
+    return err;
+}
+
 /* ---------------------------------------------------------------------
  * The "atf_process_status" type.
  * --------------------------------------------------------------------- */
@@ -247,6 +454,232 @@ atf_process_status_coredump(const atf_process_status_t *s)
  * The "atf_process_child" type.
  * --------------------------------------------------------------------- */
 
+static
+void
+tee_init(struct atf_process_tee *t)
+{
+    t->m_src_fd = -1;
+    t->m_file_fd = -1;
+    t->m_fwd_fd = -1;
+    t->m_splice = false;
+    t->m_forwarded = 0;
+    t->m_observer = NULL;
+    t->m_observer_data = NULL;
+}
+
+static
+void
+tee_fini(struct atf_process_tee *t)
+{
+    if (t->m_src_fd != -1) {
+        close(t->m_src_fd);
+        t->m_src_fd = -1;
+    }
+    if (t->m_file_fd != -1) {
+        close(t->m_file_fd);
+        t->m_file_fd = -1;
+    }
+}
+
+/** Writes a whole buffer to a descriptor.
+ *
+ * If 'interruptible' is true, an EINTR libc error is returned as soon as a
+ * write is interrupted, even if part of the buffer was written already. */
+static
+atf_error_t
+write_all(const int fd, const char *buf, size_t length,
+          const bool interruptible)
+{
+    while (length > 0) {
+        const ssize_t cnt = write(fd, buf, length);
+        if (cnt == -1) {
+            if (errno == EINTR && !interruptible)
+                continue;
+            return atf_libc_error(errno, "Failed to write to descriptor %d",
+                                  fd);
+        }
+        buf += cnt;
+        length -= cnt;
+    }
+    return atf_no_error();
+}
+
+#if defined(HAVE_SPLICE) && defined(HAVE_TEE)
+/** Copies a chunk of data using the zero-copy tee(2) and splice(2) calls.
+ *
+ * This requires the forwarding descriptor to be a pipe.  Returns an EINVAL
+ * libc error if the kernel refuses to deal with the descriptors, in which
+ * case the caller should fall back to a regular copy, or an EPIPE one if
+ * nobody reads the forwarded output any more.  The data that was
+ * forwarded but not moved to the file by then is accounted for in
+ * m_forwarded so that the regular copy does not forward it again. */
+static
+atf_error_t
+tee_copy_splice(struct atf_process_tee *t, bool *eof)
+{
+    ssize_t cnt;
+
+    PRE(t->m_forwarded == 0);
+
+    /* A consumer that does not read the forwarded output can block this
+     * call, so let the caller see EINTR; nothing was copied yet. */
+    cnt = tee(t->m_src_fd, t->m_fwd_fd, 64 * 1024, 0);
+    if (cnt == -1)
+        return atf_libc_error(errno, "tee(2) failed");
+    else if (cnt == 0) {
+        *eof = true;
+        return atf_no_error();
+    }
+
+    t->m_forwarded = cnt;
+    while (t->m_forwarded > 0) {
+        const ssize_t moved = splice(t->m_src_fd, NULL, t->m_file_fd, NULL,
+                                     t->m_forwarded, SPLICE_F_MOVE);
+        if (moved == -1) {
+            if (errno == EINTR)
+                continue;
+            return atf_libc_error(errno, "splice(2) failed");
+        }
+        INV(moved > 0);
+        t->m_forwarded -= moved;
+    }
+
+    *eof = false;
+    return atf_no_error();
+}
+#endif
+
+static
+atf_error_t
+tee_copy_buffered(struct atf_process_tee *t, bool *eof)
+{
+    atf_error_t err;
+    char buffer[64 * 1024];
+    ssize_t cnt;
+
+    do {
+        cnt = read(t->m_src_fd, buffer, sizeof(buffer));
+    } while (cnt == -1 && errno == EINTR);
+    if (cnt == -1)
+        return atf_libc_error(errno, "Failed to read from child");
+    else if (cnt == 0) {
+        *eof = true;
+        return atf_no_error();
+    }
+
+    if (t->m_observer != NULL)
+        t->m_observer(buffer, cnt, t->m_observer_data);
+
+    err = t->m_file_fd == -1 ? atf_no_error() :
+        write_all(t->m_file_fd, buffer, cnt, false);
+    if (!atf_is_error(err)) {
+        /* Skip whatever tee_copy_splice forwarded before giving up. */
+        const size_t skip = (size_t)cnt < t->m_forwarded ?
+            (size_t)cnt : t->m_forwarded;
+
+        t->m_forwarded -= skip;
+        if (t->m_fwd_fd != -1 && (size_t)cnt > skip) {
+            /* Forwarding is best-effort: the capture file is what callers
+             * rely on, so do not abort the copy if the consumer goes
+             * away.  A consumer that stops reading must not prevent the
+             * caller from handling signals either, so stop forwarding
+             * and report EINTR if blocked on it until interrupted. */
+            err = write_all(t->m_fwd_fd, buffer + skip, cnt - skip, true);
+            if (atf_is_error(err)) {
+                if (!atf_error_is(err, "libc") ||
+                    atf_libc_error_code(err) != EINTR) {
+                    atf_error_free(err);
+                    err = atf_no_error();
+                }
+                t->m_fwd_fd = -1;
+            }
+        }
+    }
+
+    *eof = false;
+    return err;
+}
+
+static
+atf_error_t
+tee_copy(struct atf_process_tee *t, bool *eof)
+{
+#if defined(HAVE_SPLICE) && defined(HAVE_TEE)
+    if (t->m_splice) {
+        atf_error_t err = tee_copy_splice(t, eof);
+        if (!atf_is_error(err) || !atf_error_is(err, "libc"))
+            return err;
+        else if (atf_libc_error_code(err) == EINTR) {
+            /* Nothing was copied; stop forwarding as tee_copy_buffered
+             * does so that the next call makes progress. */
+            t->m_fwd_fd = -1;
+            t->m_splice = false;
+            return err;
+        } else if (atf_libc_error_code(err) == EPIPE) {
+            /* Forwarding is best-effort, as in tee_copy_buffered. */
+            t->m_fwd_fd = -1;
+        } else if (atf_libc_error_code(err) != EINVAL)
+            return err;
+        atf_error_free(err);
+        t->m_splice = false;
+    }
+#endif
+    return tee_copy_buffered(t, eof);
+}
+
+/** Copies the output of the tee streams until the child closes them.
+ *
+ * Returns an EINTR libc error if interrupted, in which case the operation
+ * can be resumed later on.  Any other error stops the copying of the
+ * affected stream. */
+static
+atf_error_t
+drain_tees(atf_process_child_t *c)
+{
+    atf_error_t err = atf_no_error();
+    struct atf_process_tee *tees[2] = { &c->m_stdout_tee, &c->m_stderr_tee };
+
+    while (!atf_is_error(err) &&
+           (tees[0]->m_src_fd != -1 || tees[1]->m_src_fd != -1)) {
+        struct pollfd fds[2];
+        nfds_t nfds = 0;
+        size_t i;
+
+        for (i = 0; i < 2; i++) {
+            if (tees[i]->m_src_fd != -1) {
+                fds[nfds].fd = tees[i]->m_src_fd;
+                fds[nfds].events = POLLIN;
+                nfds++;
+            }
+        }
+
+        if (poll(fds, nfds, -1) == -1) {
+            err = atf_libc_error(errno, "Failed to poll child output");
+            break;
+        }
+
+        for (i = 0; !atf_is_error(err) && i < 2; i++) {
+            struct atf_process_tee *t = tees[i];
+            nfds_t j;
+            bool eof;
+
+            for (j = 0; j < nfds && fds[j].fd != t->m_src_fd; j++)
+                ;
+            if (j == nfds || fds[j].revents == 0)
+                continue;
+
+            err = tee_copy(t, &eof);
+            if (atf_is_error(err) && atf_error_is(err, "libc") &&
+                atf_libc_error_code(err) == EINTR)
+                break;
+            if (atf_is_error(err) || eof)
+                tee_fini(t);
+        }
+    }
+
+    return err;
+}
+
 static
 atf_error_t
 atf_process_child_init(atf_process_child_t *c)
@@ -254,6 +687,8 @@ atf_process_child_init(atf_process_child_t *c)
     c->m_pid = 0;
     c->m_stdout = -1;
     c->m_stderr = -1;
+    tee_init(&c->m_stdout_tee);
+    tee_init(&c->m_stderr_tee);
 
     return atf_no_error();
 }
@@ -266,20 +701,45 @@ atf_process_child_fini(atf_process_child_t *c)
         close(c->m_stdout);
     if (c->m_stderr != -1)
         close(c->m_stderr);
+    tee_fini(&c->m_stdout_tee);
+    tee_fini(&c->m_stderr_tee);
 }
 
 atf_error_t
 atf_process_child_wait(atf_process_child_t *c, atf_process_status_t *s)
+{
+    return atf_process_child_wait_rusage(c, s, NULL);
+}
+
+/** Waits for a child like atf_process_child_wait and also returns the
+ * resources used by it, and by the descendants it waited for, in 'usage'
+ * if not NULL. */
+atf_error_t
+atf_process_child_wait_rusage(atf_process_child_t *c,
+                              atf_process_status_t *s, struct rusage *usage)
 {
     atf_error_t err;
+    struct rusage dummy;
     int status;
 
-    if (waitpid(c->m_pid, &status, 0) == -1)
-        err = atf_libc_error(errno, "Failed waiting for process %d",
-                             c->m_pid);
-    else {
+    err = drain_tees(c);
+    if (atf_is_error(err)) {
+        if (atf_error_is(err, "libc") && atf_libc_error_code(err) == EINTR)
+            return err;
+
+        /* Do not let the child block on a stream nobody reads any more. */
+        tee_fini(&c->m_stdout_tee);
+        tee_fini(&c->m_stderr_tee);
+    }
+
+    if (wait4(c->m_pid, &status, 0, usage != NULL ? usage : &dummy) == -1) {
+        if (!atf_is_error(err))
+            err = atf_libc_error(errno, "Failed waiting for process %d",
+                                 c->m_pid);
+    } else {
         atf_process_child_fini(c);
-        err = atf_process_status_init(s, status);
+        if (!atf_is_error(err))
+            err = atf_process_status_init(s, status);
     }
 
     return err;
@@ -309,6 +769,123 @@ atf_process_child_stderr(atf_process_child_t *c)
  * Free functions.
  * --------------------------------------------------------------------- */
 
+static
+atf_error_t
+set_cloexec(const int fd)
+{
+    const int flags = fcntl(fd, F_GETFD);
+    if (flags == -1) {
+        if (errno == EBADF)
+            return atf_no_error();
+        else
+            return atf_libc_error(errno, "Cannot get flags of descriptor %d",
+                                  fd);
+    }
+
+    if (!(flags & FD_CLOEXEC) && fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1)
+        return atf_libc_error(errno, "Cannot set close-on-exec flag on "
+                              "descriptor %d", fd);
+
+    return atf_no_error();
+}
+
+/** Marks the open descriptors in the [lowfd, highfd] range as close-on-exec
+ * by walking the list of descriptors exposed by the kernel.
+ *
+ * \return True if the descriptors could be enumerated; false if the system
+ * does not provide such a list, in which case nothing has been done. */
+static
+bool
+cloexec_range_dir(const int lowfd, const int highfd, atf_error_t *err)
+{
+    DIR *dir;
+    struct dirent *de;
+
+    dir = opendir("/proc/self/fd");
+    if (dir == NULL)
+        dir = opendir("/dev/fd");
+    if (dir == NULL)
+        return false;
+
+    *err = atf_no_error();
+    while (!atf_is_error(*err) && (de = readdir(dir)) != NULL) {
+        char *endptr;
+        const long fd = strtol(de->d_name, &endptr, 10);
+        if (de->d_name[0] == '\0' || *endptr != '\0')
+            continue;
+        if (fd < lowfd || fd > highfd || fd == dirfd(dir))
+            continue;
+        *err = set_cloexec((int)fd);
+    }
+    closedir(dir);
+
+    return true;
+}
+
+static
+atf_error_t
+cloexec_range(const int lowfd, const int highfd)
+{
+    atf_error_t err;
+
+    PRE(lowfd <= highfd);
+
+#if defined(HAVE_CLOSE_RANGE) && defined(CLOSE_RANGE_CLOEXEC)
+    if (close_range(lowfd, highfd, CLOSE_RANGE_CLOEXEC) != -1)
+        return atf_no_error();
+    else if (errno != ENOSYS && errno != EINVAL)
+        return atf_libc_error(errno, "close_range(%d, %d) failed", lowfd,
+                              highfd);
+#endif
+
+    if (!cloexec_range_dir(lowfd, highfd, &err)) {
+        long max = sysconf(_SC_OPEN_MAX);
+        int fd;
+
+        if (max == -1 || max > INT_MAX)
+            max = INT_MAX;
+
+        err = atf_no_error();
+        for (fd = lowfd; !atf_is_error(err) && fd <= highfd && fd < max; fd++)
+            err = set_cloexec(fd);
+    }
+
+    return err;
+}
+
+/** Marks all the descriptors above stderr as close-on-exec except for those
+ * listed in 'keep'.
+ *
+ * This uses close_range(2) where available, which is a single system call
+ * regardless of the number of open descriptors; otherwise, the list of open
+ * descriptors is obtained from the file system or, as a last resort, every
+ * possible descriptor is probed. */
+atf_error_t
+atf_process_cloexec_fds(const int *keep, const size_t nkeep)
+{
+    atf_error_t err;
+    int lowfd;
+
+    err = atf_no_error();
+    lowfd = STDERR_FILENO + 1;
+    for (;;) {
+        size_t i;
+        int nextkeep = INT_MAX;
+
+        for (i = 0; i < nkeep; i++)
+            if (keep[i] >= lowfd && keep[i] < nextkeep)
+                nextkeep = keep[i];
+
+        if (nextkeep > lowfd)
+            err = cloexec_range(lowfd, nextkeep - 1);
+        if (atf_is_error(err) || nextkeep == INT_MAX)
+            break;
+        lowfd = nextkeep + 1;
+    }
+
+    return err;
+}
+
 static
 atf_error_t
 safe_dup(const int oldfd, const int newfd)
@@ -338,6 +915,11 @@ child_connect(const stream_prepare_t *sp, int procfd)
     if (type == atf_process_stream_type_capture) {
         close(sp->m_pipefds[0]);
         err = safe_dup(sp->m_pipefds[1], procfd);
+    } else if (type == atf_process_stream_type_tee) {
+        close(sp->m_pipefds[0]);
+        if (sp->m_filefd != -1)
+            close(sp->m_filefd);
+        err = safe_dup(sp->m_pipefds[1], procfd);
     } else if (type == atf_process_stream_type_connect) {
         if (dup2(sp->m_sb->m_tgt_fd, sp->m_sb->m_src_fd) == -1)
             err = atf_libc_error(errno, "Cannot connect descriptor %d to %d",
@@ -369,13 +951,28 @@ child_connect(const stream_prepare_t *sp, int procfd)
 
 static
 void
-parent_connect(const stream_prepare_t *sp, int *fd)
+parent_connect(const stream_prepare_t *sp, int *fd,
+               struct atf_process_tee *t)
 {
     const int type = atf_process_stream_type(sp->m_sb);
 
     if (type == atf_process_stream_type_capture) {
         close(sp->m_pipefds[1]);
         *fd = sp->m_pipefds[0];
+    } else if (type == atf_process_stream_type_tee) {
+        struct stat sb;
+
+        close(sp->m_pipefds[1]);
+        t->m_src_fd = sp->m_pipefds[0];
+        t->m_file_fd = sp->m_filefd;
+        t->m_fwd_fd = sp->m_sb->m_fd;
+        t->m_observer = sp->m_sb->m_observer;
+        t->m_observer_data = sp->m_sb->m_observer_data;
+        /* Splicing moves the data without ever reading it, so it is only
+         * possible when there is nobody else interested in it. */
+        t->m_splice = t->m_file_fd != -1 && t->m_fwd_fd != -1 &&
+            t->m_observer == NULL &&
+            fstat(t->m_fwd_fd, &sb) != -1 && S_ISFIFO(sb.st_mode);
     } else if (type == atf_process_stream_type_connect) {
         /* Do nothing. */
     } else if (type == atf_process_stream_type_inherit) {
@@ -404,26 +1001,38 @@ do_parent(atf_process_child_t *c,
 
     c->m_pid = pid;
 
-    parent_connect(outsp, &c->m_stdout);
-    parent_connect(errsp, &c->m_stderr);
+    parent_connect(outsp, &c->m_stdout, &c->m_stdout_tee);
+    parent_connect(errsp, &c->m_stderr, &c->m_stderr_tee);
 
 out:
     return err;
 }
 
+static
+int
+connected_fd(const stream_prepare_t *sp)
+{
+    if (atf_process_stream_type(sp->m_sb) == atf_process_stream_type_connect)
+        return sp->m_sb->m_src_fd;
+    else
+        return -1;
+}
+
 static
 void
 do_child(void (*)(void *),
          void *,
          const stream_prepare_t *,
-         const stream_prepare_t *) ATF_DEFS_ATTRIBUTE_NORETURN;
+         const stream_prepare_t *,
+         const atf_process_attrs_t *) ATF_DEFS_ATTRIBUTE_NORETURN;
 
 static
 void
 do_child(void (*start)(void *),
          void *v,
          const stream_prepare_t *outsp,
-         const stream_prepare_t *errsp)
+         const stream_prepare_t *errsp,
+         const atf_process_attrs_t *attrs)
 {
     atf_error_t err;
 
@@ -435,6 +1044,14 @@ do_child(void (*start)(void *),
     if (atf_is_error(err))
         goto out;
 
+    if (attrs != NULL) {
+        const int keep[2] = { connected_fd(outsp), connected_fd(errsp) };
+
+        err = attrs_apply(attrs, keep, 2);
+        if (atf_is_error(err))
+            goto out;
+    }
+
     start(v);
     UNREACHABLE;
 
@@ -457,6 +1074,7 @@ fork_with_streams(atf_process_child_t *c,
                   void (*start)(void *),
                   const atf_process_stream_t *outsb,
                   const atf_process_stream_t *errsb,
+                  const atf_process_attrs_t *attrs,
                   void *v)
 {
     atf_error_t err;
@@ -479,7 +1097,7 @@ fork_with_streams(atf_process_child_t *c,
     }
 
     if (pid == 0) {
-        do_child(start, v, &outsp, &errsp);
+        do_child(start, v, &outsp, &errsp, attrs);
         UNREACHABLE;
         abort();
         err = atf_no_error();
@@ -520,12 +1138,32 @@ init_stream_w_default(const atf_process_stream_t *usersb,
     return err;
 }
 
+/** Forks a child process that runs the 'start' routine.
+ *
+ * The child inherits all the descriptors of the parent.  Use
+ * atf_process_fork_attrs to customize this and other properties of the
+ * child. */
 atf_error_t
 atf_process_fork(atf_process_child_t *c,
                  void (*start)(void *),
                  const atf_process_stream_t *outsb,
                  const atf_process_stream_t *errsb,
                  void *v)
+{
+    return atf_process_fork_attrs(c, start, outsb, errsb, NULL, v);
+}
+
+/** Forks a child process that runs the 'start' routine.
+ *
+ * The 'attrs' are applied in the child once its streams have been set up and
+ * before 'start' is called.  If 'attrs' is NULL, the child is left as is. */
+atf_error_t
+atf_process_fork_attrs(atf_process_child_t *c,
+                       void (*start)(void *),
+                       const atf_process_stream_t *outsb,
+                       const atf_process_stream_t *errsb,
+                       const atf_process_attrs_t *attrs,
+                       void *v)
 {
     atf_error_t err;
     atf_process_stream_t inherit_outsb, inherit_errsb;
@@ -541,7 +1179,7 @@ atf_process_fork(atf_process_child_t *c,
     if (atf_is_error(err))
         goto out_out;
 
-    err = fork_with_streams(c, start, real_outsb, real_errsb, v);
+    err = fork_with_streams(c, start, real_outsb, real_errsb, attrs, v);
 
     if (errsb == NULL)
         atf_process_stream_fini(&inherit_errsb);
@@ -612,16 +1250,22 @@ do_exec(void *v)
     exit(EXIT_FAILURE);
 }
 
+/** Executes a program and waits for its termination.
+ *
+ * If 'attrs' is NULL, the defaults documented in atf_process_attrs_init are
+ * used for the child. */
 atf_error_t
 atf_process_exec_array(atf_process_status_t *s,
                        const atf_fs_path_t *prog,
                        const char *const *argv,
                        const atf_process_stream_t *outsb,
                        const atf_process_stream_t *errsb,
+                       const atf_process_attrs_t *attrs,
                        void (*prehook)(void))
 {
     atf_error_t err;
     atf_process_child_t c;
+    atf_process_attrs_t default_attrs;
     struct exec_args ea = { prog, argv, prehook };
 
     PRE(outsb == NULL ||
@@ -629,14 +1273,23 @@ atf_process_exec_array(atf_process_status_t *s,
     PRE(errsb == NULL ||
         atf_process_stream_type(errsb) != atf_process_stream_type_capture);
 
-    err = atf_process_fork(&c, do_exec, outsb, errsb, &ea);
+    if (attrs == NULL) {
+        err = atf_process_attrs_init(&default_attrs);
+        if (atf_is_error(err))
+            goto out;
+        attrs = &default_attrs;
+    }
+
+    err = atf_process_fork_attrs(&c, do_exec, outsb, errsb, attrs, &ea);
+    if (attrs == &default_attrs)
+        atf_process_attrs_fini(&default_attrs);
     if (atf_is_error(err))
         goto out;
 
 again:
     err = atf_process_child_wait(&c, s);
-    if (atf_is_error(err)) {
-        INV(atf_error_is(err, "libc") && atf_libc_error_code(err) == EINTR);
+    if (atf_is_error(err) && atf_error_is(err, "libc") &&
+        atf_libc_error_code(err) == EINTR) {
         atf_error_free(err);
         goto again;
     }
@@ -651,6 +1304,7 @@ atf_process_exec_list(atf_process_status_t *s,
                       const atf_list_t *argv,
                       const atf_process_stream_t *outsb,
                       const atf_process_stream_t *errsb,
+                      const atf_process_attrs_t *attrs,
                       void (*prehook)(void))
 {
     atf_error_t err;
@@ -666,7 +1320,8 @@ atf_process_exec_list(atf_process_status_t *s,
     if (atf_is_error(err))
         goto out;
 
-    err = atf_process_exec_array(s, prog, argv2, outsb, errsb, prehook);
+    err = atf_process_exec_array(s, prog, argv2, outsb, errsb, attrs,
+                                 prehook);
 
     free(argv2);
 out:
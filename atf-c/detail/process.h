@@ -31,6 +31,7 @@
 #define ATF_C_PROCESS_H
 
 #include <sys/types.h>
+#include <sys/resource.h>
 
 #include <stdbool.h>
 
@@ -50,11 +51,15 @@ struct atf_process_stream {
     int m_src_fd;
     int m_tgt_fd;
 
-    /* Valid if m_type == redirect_fd. */
+    /* Valid if m_type == redirect_fd or m_type == tee. */
     int m_fd;
 
-    /* Valid if m_type == redirect_path. */
+    /* Valid if m_type == redirect_path or m_type == tee. */
     const atf_fs_path_t *m_path;
+
+    /* Valid if m_type == tee; NULL if nobody observes the data. */
+    void (*m_observer)(const char *, size_t, void *);
+    void *m_observer_data;
 };
 typedef struct atf_process_stream atf_process_stream_t;
 
@@ -63,6 +68,7 @@ extern const int atf_process_stream_type_connect;
 extern const int atf_process_stream_type_inherit;
 extern const int atf_process_stream_type_redirect_fd;
 extern const int atf_process_stream_type_redirect_path;
+extern const int atf_process_stream_type_tee;
 
 atf_error_t atf_process_stream_init_capture(atf_process_stream_t *);
 atf_error_t atf_process_stream_init_connect(atf_process_stream_t *,
@@ -72,10 +78,55 @@ atf_error_t atf_process_stream_init_redirect_fd(atf_process_stream_t *,
                                                 const int fd);
 atf_error_t atf_process_stream_init_redirect_path(atf_process_stream_t *,
                                                   const atf_fs_path_t *);
+atf_error_t atf_process_stream_init_tee(atf_process_stream_t *,
+                                        const atf_fs_path_t *, const int);
 void atf_process_stream_fini(atf_process_stream_t *);
 
+void atf_process_stream_set_observer(atf_process_stream_t *,
+                                     void (*)(const char *, size_t, void *),
+                                     void *);
+
 int atf_process_stream_type(const atf_process_stream_t *);
 
+/* ---------------------------------------------------------------------
+ * The "atf_process_attrs" type.
+ * --------------------------------------------------------------------- */
+
+#define ATF_PROCESS_ATTRS_MAX_LIMITS 8
+
+struct atf_process_limit {
+    int m_resource;
+    rlim_t m_value;
+};
+
+struct atf_process_attrs {
+    /* Whether the descriptors above stderr are closed on exec. */
+    bool m_close_fds;
+
+    /* Resource limits to apply to the child, as both the soft and the
+     * hard limits. */
+    size_t m_nlimits;
+    struct atf_process_limit m_limits[ATF_PROCESS_ATTRS_MAX_LIMITS];
+
+    /* Valid if m_has_nice is true. */
+    bool m_has_nice;
+    int m_nice;
+
+    /* Whether the child becomes the leader of a new process group. */
+    bool m_new_pgrp;
+};
+typedef struct atf_process_attrs atf_process_attrs_t;
+
+atf_error_t atf_process_attrs_init(atf_process_attrs_t *);
+void atf_process_attrs_fini(atf_process_attrs_t *);
+
+bool atf_process_attrs_close_fds(const atf_process_attrs_t *);
+void atf_process_attrs_set_close_fds(atf_process_attrs_t *, const bool);
+void atf_process_attrs_set_limit(atf_process_attrs_t *, const int,
+                                 const rlim_t);
+void atf_process_attrs_set_nice(atf_process_attrs_t *, const int);
+void atf_process_attrs_set_new_pgrp(atf_process_attrs_t *, const bool);
+
 /* ---------------------------------------------------------------------
  * The "atf_process_status" type.
  * --------------------------------------------------------------------- */
@@ -97,16 +148,34 @@ bool atf_process_status_coredump(const atf_process_status_t *);
  * The "atf_process_child" type.
  * --------------------------------------------------------------------- */
 
+struct atf_process_tee {
+    int m_src_fd;
+    int m_file_fd;
+    int m_fwd_fd;
+    bool m_splice;
+    size_t m_forwarded;
+    void (*m_observer)(const char *, size_t, void *);
+    void *m_observer_data;
+};
+
 struct atf_process_child {
     pid_t m_pid;
 
     int m_stdout;
     int m_stderr;
+
+    /* Valid if the corresponding stream is of type tee.  The copying of
+     * the data happens in atf_process_child_wait. */
+    struct atf_process_tee m_stdout_tee;
+    struct atf_process_tee m_stderr_tee;
 };
 typedef struct atf_process_child atf_process_child_t;
 
 atf_error_t atf_process_child_wait(atf_process_child_t *,
                                    atf_process_status_t *);
+atf_error_t atf_process_child_wait_rusage(atf_process_child_t *,
+                                          atf_process_status_t *,
+                                          struct rusage *);
 pid_t atf_process_child_pid(const atf_process_child_t *);
 int atf_process_child_stdout(atf_process_child_t *);
 int atf_process_child_stderr(atf_process_child_t *);
@@ -120,17 +189,26 @@ atf_error_t atf_process_fork(atf_process_child_t *,
                              const atf_process_stream_t *,
                              const atf_process_stream_t *,
                              void *);
+atf_error_t atf_process_fork_attrs(atf_process_child_t *,
+                                   void (*)(void *),
+                                   const atf_process_stream_t *,
+                                   const atf_process_stream_t *,
+                                   const atf_process_attrs_t *,
+                                   void *);
 atf_error_t atf_process_exec_array(atf_process_status_t *,
                                    const atf_fs_path_t *,
                                    const char *const *,
                                    const atf_process_stream_t *,
                                    const atf_process_stream_t *,
+                                   const atf_process_attrs_t *,
                                    void (*)(void));
 atf_error_t atf_process_exec_list(atf_process_status_t *,
                                   const atf_fs_path_t *,
                                   const atf_list_t *,
                                   const atf_process_stream_t *,
                                   const atf_process_stream_t *,
+                                  const atf_process_attrs_t *,
                                   void (*)(void));
+atf_error_t atf_process_cloexec_fds(const int *, const size_t);
 
 #endif /* !defined(ATF_C_PROCESS_H) */
@@ -28,8 +28,10 @@
  */
 
 #include <sys/types.h>
+#include <sys/resource.h>
 
 #include <assert.h> /* NO_CHECK_STYLE */
+#include <fcntl.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -44,6 +46,21 @@ h_echo(const char *msg)
     return EXIT_SUCCESS;
 }
 
+static
+int
+h_fd_is_open(const char *fdstr)
+{
+    const int fd = atoi(fdstr);
+
+    if (fcntl(fd, F_GETFD) == -1) {
+        printf("Descriptor %d is closed\n", fd);
+        return EXIT_FAILURE;
+    } else {
+        printf("Descriptor %d is open\n", fd);
+        return EXIT_SUCCESS;
+    }
+}
+
 static
 int
 h_exit_failure(void)
@@ -67,6 +84,40 @@ h_exit_success(void)
     return EXIT_SUCCESS;
 }
 
+static
+int
+h_is_pgrp_leader(void)
+{
+    return getpgrp() == getpid() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static
+void
+print_limit(const char *name, const int resource)
+{
+    struct rlimit rl;
+
+    if (getrlimit(resource, &rl) == -1)
+        printf("%s error\n", name);
+    else if (rl.rlim_cur == RLIM_INFINITY)
+        printf("%s unlimited\n", name);
+    else
+        printf("%s %llu\n", name, (unsigned long long)rl.rlim_cur);
+}
+
+static
+int
+h_print_limits(void)
+{
+    print_limit("as", RLIMIT_AS);
+    print_limit("core", RLIMIT_CORE);
+    print_limit("cpu", RLIMIT_CPU);
+    print_limit("nofile", RLIMIT_NOFILE);
+    printf("nice %d\n", getpriority(PRIO_PROCESS, 0));
+
+    return EXIT_SUCCESS;
+}
+
 static
 int
 h_stdout_stderr(const char *id)
@@ -99,12 +150,19 @@ main(int argc, const char *const argv[])
     if (strcmp(argv[1], "echo") == 0) {
         check_args(argc, argv, 3);
         exitcode = h_echo(argv[2]);
+    } else if (strcmp(argv[1], "fd-is-open") == 0) {
+        check_args(argc, argv, 3);
+        exitcode = h_fd_is_open(argv[2]);
     } else if (strcmp(argv[1], "exit-failure") == 0)
         exitcode = h_exit_failure();
     else if (strcmp(argv[1], "exit-signal") == 0)
         exitcode = h_exit_signal();
     else if (strcmp(argv[1], "exit-success") == 0)
         exitcode = h_exit_success();
+    else if (strcmp(argv[1], "is-pgrp-leader") == 0)
+        exitcode = h_is_pgrp_leader();
+    else if (strcmp(argv[1], "print-limits") == 0)
+        exitcode = h_print_limits();
     else if (strcmp(argv[1], "stdout-stderr") == 0) {
         check_args(argc, argv, 3);
         exitcode = h_stdout_stderr(argv[2]);
@@ -392,6 +392,67 @@ redirect_path_stream_fini(void *v)
     check_file(s->m_base.m_type);
 }
 
+struct tee_stream {
+    struct base_stream m_base;
+
+    atf_fs_path_t m_path;
+    int m_fd;
+};
+#define TEE_STREAM(type) \
+    { .m_base = BASE_STREAM(tee_stream_init, \
+                            NULL, \
+                            tee_stream_fini, \
+                            type) }
+
+static
+void
+tee_stream_init(void *v)
+{
+    struct tee_stream *s = v;
+
+    switch (s->m_base.m_type) {
+    case stdout_type:
+        RE(atf_fs_path_init_fmt(&s->m_path, "stdout"));
+        s->m_fd = open("stdout.fwd", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        break;
+    case stderr_type:
+        RE(atf_fs_path_init_fmt(&s->m_path, "stderr"));
+        s->m_fd = open("stderr.fwd", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        break;
+    default:
+        UNREACHABLE;
+    }
+    ATF_REQUIRE(s->m_fd != -1);
+
+    s->m_base.m_sb_ptr = &s->m_base.m_sb;
+    RE(atf_process_stream_init_tee(&s->m_base.m_sb, &s->m_path, s->m_fd));
+}
+
+static
+void
+tee_stream_fini(void *v)
+{
+    struct tee_stream *s = v;
+
+    ATF_REQUIRE(close(s->m_fd) != -1);
+
+    atf_process_stream_fini(&s->m_base.m_sb);
+
+    atf_fs_path_fini(&s->m_path);
+
+    check_file(s->m_base.m_type);
+    switch (s->m_base.m_type) {
+    case stdout_type:
+        ATF_CHECK(atf_utils_grep_file("stdout: msg", "stdout.fwd"));
+        break;
+    case stderr_type:
+        ATF_CHECK(atf_utils_grep_file("stderr: msg", "stderr.fwd"));
+        break;
+    default:
+        UNREACHABLE;
+    }
+}
+
 static void child_print(void *) ATF_DEFS_ATTRIBUTE_NORETURN;
 
 struct child_print_data {
@@ -533,6 +594,45 @@ ATF_TC_BODY(stream_init_redirect_path, tc)
     atf_fs_path_fini(&path);
 }
 
+ATF_TC(stream_init_tee);
+ATF_TC_HEAD(stream_init_tee, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests the "
+                      "atf_process_stream_init_tee function");
+}
+ATF_TC_BODY(stream_init_tee, tc)
+{
+    atf_process_stream_t sb;
+    atf_fs_path_t path;
+
+    RE(atf_fs_path_init_fmt(&path, "foo"));
+    RE(atf_process_stream_init_tee(&sb, &path, 2));
+
+    ATF_CHECK_EQ(atf_process_stream_type(&sb),
+                 atf_process_stream_type_tee);
+
+    atf_process_stream_fini(&sb);
+    atf_fs_path_fini(&path);
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "attrs" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC_WITHOUT_HEAD(attrs_close_fds);
+ATF_TC_BODY(attrs_close_fds, tc)
+{
+    atf_process_attrs_t attrs;
+
+    RE(atf_process_attrs_init(&attrs));
+    ATF_CHECK(atf_process_attrs_close_fds(&attrs));
+    atf_process_attrs_set_close_fds(&attrs, false);
+    ATF_CHECK(!atf_process_attrs_close_fds(&attrs));
+    atf_process_attrs_set_close_fds(&attrs, true);
+    ATF_CHECK(atf_process_attrs_close_fds(&attrs));
+    atf_process_attrs_fini(&attrs);
+}
+
 /* ---------------------------------------------------------------------
  * Test cases for the "status" type.
  * --------------------------------------------------------------------- */
@@ -873,8 +973,39 @@ do_exec(const atf_tc_t *tc, const char *helper_name, atf_process_status_t *s,
     argv[2] = NULL;
     printf("Executing %s %s\n", argv[0], argv[1]);
 
-    RE(atf_process_exec_array(s, &process_helpers, argv, NULL, NULL, prehook));
+    RE(atf_process_exec_array(s, &process_helpers, argv, NULL, NULL, NULL,
+                              prehook));
+    atf_fs_path_fini(&process_helpers);
+}
+
+static
+bool
+exec_fd_is_open(const atf_tc_t *tc, const int fd,
+                const atf_process_stream_t *outsb,
+                const atf_process_attrs_t *attrs)
+{
+    atf_fs_path_t process_helpers;
+    atf_process_status_t status;
+    char fdstr[16];
+    const char *argv[4];
+    bool is_open;
+
+    get_process_helpers_path(tc, true, &process_helpers);
+
+    snprintf(fdstr, sizeof(fdstr), "%d", fd);
+    argv[0] = atf_fs_path_cstring(&process_helpers);
+    argv[1] = "fd-is-open";
+    argv[2] = fdstr;
+    argv[3] = NULL;
+
+    RE(atf_process_exec_array(&status, &process_helpers, argv, outsb, NULL,
+                              attrs, NULL));
+    ATF_REQUIRE(atf_process_status_exited(&status));
+    is_open = atf_process_status_exitstatus(&status) == EXIT_SUCCESS;
+    atf_process_status_fini(&status);
+
     atf_fs_path_fini(&process_helpers);
+    return is_open;
 }
 
 static
@@ -887,6 +1018,81 @@ check_line(int fd, const char *exp)
     free(line);
 }
 
+ATF_TC(cloexec_fds);
+ATF_TC_HEAD(cloexec_fds, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_process_cloexec_fds "
+                      "marks all descriptors above stderr except for the "
+                      "given ones");
+}
+ATF_TC_BODY(cloexec_fds, tc)
+{
+    int fds[4];
+    size_t i;
+
+    for (i = 0; i < 4; i++) {
+        fds[i] = open("/dev/null", O_RDONLY);
+        ATF_REQUIRE(fds[i] != -1);
+        ATF_REQUIRE(!(fcntl(fds[i], F_GETFD) & FD_CLOEXEC));
+    }
+
+    {
+        const int keep[2] = { fds[2], fds[0] };
+        RE(atf_process_cloexec_fds(keep, 2));
+    }
+
+    ATF_CHECK(!(fcntl(STDOUT_FILENO, F_GETFD) & FD_CLOEXEC));
+    ATF_CHECK(!(fcntl(STDERR_FILENO, F_GETFD) & FD_CLOEXEC));
+    ATF_CHECK(!(fcntl(fds[0], F_GETFD) & FD_CLOEXEC));
+    ATF_CHECK(fcntl(fds[1], F_GETFD) & FD_CLOEXEC);
+    ATF_CHECK(!(fcntl(fds[2], F_GETFD) & FD_CLOEXEC));
+    ATF_CHECK(fcntl(fds[3], F_GETFD) & FD_CLOEXEC);
+
+    for (i = 0; i < 4; i++)
+        close(fds[i]);
+}
+
+ATF_TC(exec_close_fds);
+ATF_TC_HEAD(exec_close_fds, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that execing a command does not "
+                      "leak descriptors unless requested");
+}
+ATF_TC_BODY(exec_close_fds, tc)
+{
+    atf_process_attrs_t attrs;
+    int fds[2];
+
+    ATF_REQUIRE(pipe(fds) != -1);
+
+    ATF_CHECK(!exec_fd_is_open(tc, fds[0], NULL, NULL));
+    ATF_CHECK(!exec_fd_is_open(tc, fds[1], NULL, NULL));
+
+    RE(atf_process_attrs_init(&attrs));
+    atf_process_attrs_set_close_fds(&attrs, false);
+    ATF_CHECK(exec_fd_is_open(tc, fds[0], NULL, &attrs));
+    ATF_CHECK(exec_fd_is_open(tc, fds[1], NULL, &attrs));
+    atf_process_attrs_fini(&attrs);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+ATF_TC(exec_close_fds_connect);
+ATF_TC_HEAD(exec_close_fds_connect, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that execing a command keeps the "
+                      "descriptors set up by connect streams open");
+}
+ATF_TC_BODY(exec_close_fds_connect, tc)
+{
+    atf_process_stream_t outsb;
+
+    RE(atf_process_stream_init_connect(&outsb, 9, STDOUT_FILENO));
+    ATF_CHECK(exec_fd_is_open(tc, 9, &outsb, NULL));
+    atf_process_stream_fini(&outsb);
+}
+
 ATF_TC(exec_failure);
 ATF_TC_HEAD(exec_failure, tc)
 {
@@ -926,7 +1132,7 @@ ATF_TC_BODY(exec_list, tc)
         RE(atf_fs_path_init_fmt(&outpath, "stdout"));
         RE(atf_process_stream_init_redirect_path(&outsb, &outpath));
         RE(atf_process_exec_list(&status, &process_helpers, &argv, &outsb,
-                                 NULL, NULL));
+                                 NULL, NULL, NULL));
         atf_process_stream_fini(&outsb);
         atf_fs_path_fini(&outpath);
     }
@@ -946,6 +1152,125 @@ ATF_TC_BODY(exec_list, tc)
     atf_fs_path_fini(&process_helpers);
 }
 
+/** Returns the given limit or the current hard limit for the resource,
+ * whichever is lower, so that setting it does not require privileges. */
+static
+rlim_t
+attainable_limit(const int resource, const rlim_t value)
+{
+    struct rlimit rl;
+
+    ATF_REQUIRE(getrlimit(resource, &rl) != -1);
+    if (rl.rlim_max != RLIM_INFINITY && rl.rlim_max < value)
+        return rl.rlim_max;
+    else
+        return value;
+}
+
+ATF_TC(exec_limits);
+ATF_TC_HEAD(exec_limits, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests execing a command with resource "
+                      "limits and a nice value");
+}
+ATF_TC_BODY(exec_limits, tc)
+{
+    atf_fs_path_t process_helpers, outpath;
+    atf_process_stream_t outsb;
+    atf_process_attrs_t attrs;
+    atf_process_status_t status;
+    const char *argv[3];
+    const rlim_t as = attainable_limit(RLIMIT_AS, 1024UL * 1024 * 1024);
+    const rlim_t cpu = attainable_limit(RLIMIT_CPU, 60);
+    const rlim_t nofile = attainable_limit(RLIMIT_NOFILE, 64);
+    int nice_value;
+
+    errno = 0;
+    nice_value = getpriority(PRIO_PROCESS, 0);
+    ATF_REQUIRE(errno == 0);
+    if (nice_value < 19)
+        nice_value++;
+
+    RE(atf_process_attrs_init(&attrs));
+    atf_process_attrs_set_limit(&attrs, RLIMIT_AS, as);
+    atf_process_attrs_set_limit(&attrs, RLIMIT_CORE, 1234);
+    atf_process_attrs_set_limit(&attrs, RLIMIT_CORE, 0);
+    atf_process_attrs_set_limit(&attrs, RLIMIT_CPU, cpu);
+    atf_process_attrs_set_limit(&attrs, RLIMIT_NOFILE, nofile);
+    atf_process_attrs_set_nice(&attrs, nice_value);
+
+    get_process_helpers_path(tc, true, &process_helpers);
+    argv[0] = atf_fs_path_cstring(&process_helpers);
+    argv[1] = "print-limits";
+    argv[2] = NULL;
+
+    RE(atf_fs_path_init_fmt(&outpath, "stdout"));
+    RE(atf_process_stream_init_redirect_path(&outsb, &outpath));
+    RE(atf_process_exec_array(&status, &process_helpers, argv, &outsb, NULL,
+                              &attrs, NULL));
+    atf_process_stream_fini(&outsb);
+    atf_fs_path_fini(&outpath);
+    atf_process_attrs_fini(&attrs);
+
+    ATF_CHECK(atf_process_status_exited(&status));
+    ATF_CHECK_EQ(atf_process_status_exitstatus(&status), EXIT_SUCCESS);
+    atf_process_status_fini(&status);
+
+    atf_utils_cat_file("stdout", "helper: ");
+    ATF_CHECK(atf_utils_grep_file("^as %llu$", "stdout",
+                                  (unsigned long long)as));
+    ATF_CHECK(atf_utils_grep_file("^core 0$", "stdout"));
+    ATF_CHECK(atf_utils_grep_file("^cpu %llu$", "stdout",
+                                  (unsigned long long)cpu));
+    ATF_CHECK(atf_utils_grep_file("^nofile %llu$", "stdout",
+                                  (unsigned long long)nofile));
+    ATF_CHECK(atf_utils_grep_file("^nice %d$", "stdout", nice_value));
+
+    atf_fs_path_fini(&process_helpers);
+}
+
+static
+bool
+exec_is_pgrp_leader(const atf_tc_t *tc, const bool new_pgrp)
+{
+    atf_fs_path_t process_helpers;
+    atf_process_attrs_t attrs;
+    atf_process_status_t status;
+    const char *argv[3];
+    bool leader;
+
+    RE(atf_process_attrs_init(&attrs));
+    atf_process_attrs_set_new_pgrp(&attrs, new_pgrp);
+
+    get_process_helpers_path(tc, true, &process_helpers);
+    argv[0] = atf_fs_path_cstring(&process_helpers);
+    argv[1] = "is-pgrp-leader";
+    argv[2] = NULL;
+
+    RE(atf_process_exec_array(&status, &process_helpers, argv, NULL, NULL,
+                              &attrs, NULL));
+    atf_process_attrs_fini(&attrs);
+    atf_fs_path_fini(&process_helpers);
+
+    ATF_REQUIRE(atf_process_status_exited(&status));
+    leader = atf_process_status_exitstatus(&status) == EXIT_SUCCESS;
+    atf_process_status_fini(&status);
+
+    return leader;
+}
+
+ATF_TC(exec_new_pgrp);
+ATF_TC_HEAD(exec_new_pgrp, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests execing a command in a new "
+                      "process group");
+}
+ATF_TC_BODY(exec_new_pgrp, tc)
+{
+    ATF_CHECK(exec_is_pgrp_leader(tc, true));
+    ATF_CHECK(!exec_is_pgrp_leader(tc, false));
+}
+
 static void
 exit_early(void)
 {
@@ -982,6 +1307,91 @@ ATF_TC_BODY(exec_success, tc)
     atf_process_status_fini(&status);
 }
 
+ATF_TC(exec_tee_pipe);
+ATF_TC_HEAD(exec_tee_pipe, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests execing a command with its "
+                      "output teed into a file and a pipe");
+}
+ATF_TC_BODY(exec_tee_pipe, tc)
+{
+    atf_fs_path_t process_helpers, outpath;
+    atf_process_stream_t outsb;
+    atf_process_status_t status;
+    const char *argv[4];
+    int fds[2];
+
+    get_process_helpers_path(tc, true, &process_helpers);
+    argv[0] = atf_fs_path_cstring(&process_helpers);
+    argv[1] = "echo";
+    argv[2] = "test-message";
+    argv[3] = NULL;
+
+    ATF_REQUIRE(pipe(fds) != -1);
+    RE(atf_fs_path_init_fmt(&outpath, "stdout"));
+    RE(atf_process_stream_init_tee(&outsb, &outpath, fds[1]));
+    RE(atf_process_exec_array(&status, &process_helpers, argv, &outsb, NULL,
+                              NULL, NULL));
+    atf_process_stream_fini(&outsb);
+    atf_fs_path_fini(&outpath);
+    ATF_REQUIRE(close(fds[1]) != -1);
+
+    ATF_CHECK(atf_process_status_exited(&status));
+    ATF_CHECK_EQ(atf_process_status_exitstatus(&status), EXIT_SUCCESS);
+    atf_process_status_fini(&status);
+
+    check_line(fds[0], "test-message");
+    ATF_REQUIRE(close(fds[0]) != -1);
+    ATF_CHECK(atf_utils_compare_file("stdout", "test-message\n"));
+
+    atf_fs_path_fini(&process_helpers);
+}
+
+static
+void
+count_observer(const char *data, size_t length, void *v)
+{
+    size_t *count = v;
+
+    ATF_REQUIRE(memchr(data, '\0', length) == NULL);
+    *count += length;
+}
+
+ATF_TC(exec_tee_observer);
+ATF_TC_HEAD(exec_tee_observer, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests execing a command with its "
+                      "output only passed to an observer");
+}
+ATF_TC_BODY(exec_tee_observer, tc)
+{
+    atf_fs_path_t process_helpers;
+    atf_process_stream_t outsb;
+    atf_process_status_t status;
+    const char *argv[4];
+    size_t count = 0;
+
+    get_process_helpers_path(tc, true, &process_helpers);
+    argv[0] = atf_fs_path_cstring(&process_helpers);
+    argv[1] = "echo";
+    argv[2] = "test-message";
+    argv[3] = NULL;
+
+    RE(atf_process_stream_init_tee(&outsb, NULL, -1));
+    atf_process_stream_set_observer(&outsb, count_observer, &count);
+    RE(atf_process_exec_array(&status, &process_helpers, argv, &outsb, NULL,
+                              NULL, NULL));
+    atf_process_stream_fini(&outsb);
+
+    ATF_CHECK(atf_process_status_exited(&status));
+    ATF_CHECK_EQ(atf_process_status_exitstatus(&status), EXIT_SUCCESS);
+    atf_process_status_fini(&status);
+
+    ATF_CHECK_EQ(strlen("test-message\n"), count);
+
+    atf_fs_path_fini(&process_helpers);
+}
+
 static const int exit_v_null = 1;
 static const int exit_v_notnull = 2;
 
@@ -1041,6 +1451,41 @@ ATF_TC_BODY(fork_cookie, tc)
     atf_process_stream_fini(&outsb);
 }
 
+static
+void
+child_spin(void *v ATF_DEFS_ATTRIBUTE_UNUSED)
+{
+    volatile unsigned long counter = 0;
+
+    for (;;)
+        counter++;
+}
+
+ATF_TC(fork_limits_cpu);
+ATF_TC_HEAD(fork_limits_cpu, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that a child exceeding its CPU "
+                      "time limit is stopped by the kernel");
+    atf_tc_set_md_var(tc, "timeout", "30");
+}
+ATF_TC_BODY(fork_limits_cpu, tc)
+{
+    atf_process_attrs_t attrs;
+    atf_process_child_t child;
+    atf_process_status_t status;
+
+    RE(atf_process_attrs_init(&attrs));
+    atf_process_attrs_set_limit(&attrs, RLIMIT_CPU, 1);
+    RE(atf_process_fork_attrs(&child, child_spin, NULL, NULL, &attrs, NULL));
+    atf_process_attrs_fini(&attrs);
+
+    RE(atf_process_child_wait(&child, &status));
+    ATF_REQUIRE(atf_process_status_signaled(&status));
+    ATF_CHECK(atf_process_status_termsig(&status) == SIGXCPU ||
+              atf_process_status_termsig(&status) == SIGKILL);
+    atf_process_status_fini(&status);
+}
+
 #define TC_FORK_STREAMS(outlc, outuc, errlc, erruc) \
     ATF_TC(fork_out_ ## outlc ## _err_ ## errlc); \
     ATF_TC_HEAD(fork_out_ ## outlc ## _err_ ## errlc, tc) \
@@ -1091,6 +1536,10 @@ TC_FORK_STREAMS(redirect_path, REDIRECT_PATH, default, DEFAULT);
 TC_FORK_STREAMS(redirect_path, REDIRECT_PATH, inherit, INHERIT);
 TC_FORK_STREAMS(redirect_path, REDIRECT_PATH, redirect_fd, REDIRECT_FD);
 TC_FORK_STREAMS(redirect_path, REDIRECT_PATH, redirect_path, REDIRECT_PATH);
+TC_FORK_STREAMS(capture, CAPTURE, tee, TEE);
+TC_FORK_STREAMS(inherit, INHERIT, tee, TEE);
+TC_FORK_STREAMS(tee, TEE, inherit, INHERIT);
+TC_FORK_STREAMS(tee, TEE, tee, TEE);
 
 #undef TC_FORK_STREAMS
 
@@ -1106,6 +1555,10 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, stream_init_inherit);
     ATF_TP_ADD_TC(tp, stream_init_redirect_fd);
     ATF_TP_ADD_TC(tp, stream_init_redirect_path);
+    ATF_TP_ADD_TC(tp, stream_init_tee);
+
+    /* Add the tests for the "attrs" type. */
+    ATF_TP_ADD_TC(tp, attrs_close_fds);
 
     /* Add the tests for the "status" type. */
     ATF_TP_ADD_TC(tp, status_exited);
@@ -1117,11 +1570,19 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, child_wait_eintr);
 
     /* Add the tests for the free functions. */
+    ATF_TP_ADD_TC(tp, cloexec_fds);
+    ATF_TP_ADD_TC(tp, exec_close_fds);
+    ATF_TP_ADD_TC(tp, exec_close_fds_connect);
     ATF_TP_ADD_TC(tp, exec_failure);
     ATF_TP_ADD_TC(tp, exec_list);
+    ATF_TP_ADD_TC(tp, exec_limits);
+    ATF_TP_ADD_TC(tp, exec_new_pgrp);
     ATF_TP_ADD_TC(tp, exec_prehook);
     ATF_TP_ADD_TC(tp, exec_success);
+    ATF_TP_ADD_TC(tp, exec_tee_observer);
+    ATF_TP_ADD_TC(tp, exec_tee_pipe);
     ATF_TP_ADD_TC(tp, fork_cookie);
+    ATF_TP_ADD_TC(tp, fork_limits_cpu);
     ATF_TP_ADD_TC(tp, fork_out_capture_err_capture);
     ATF_TP_ADD_TC(tp, fork_out_capture_err_connect);
     ATF_TP_ADD_TC(tp, fork_out_capture_err_default);
@@ -1158,6 +1619,10 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, fork_out_redirect_path_err_inherit);
     ATF_TP_ADD_TC(tp, fork_out_redirect_path_err_redirect_fd);
     ATF_TP_ADD_TC(tp, fork_out_redirect_path_err_redirect_path);
+    ATF_TP_ADD_TC(tp, fork_out_capture_err_tee);
+    ATF_TP_ADD_TC(tp, fork_out_inherit_err_tee);
+    ATF_TP_ADD_TC(tp, fork_out_tee_err_inherit);
+    ATF_TP_ADD_TC(tp, fork_out_tee_err_tee);
 
     return atf_no_error();
 }
@@ -0,0 +1,241 @@
+/*
+ * Automated Testing Framework (atf)
+ *
+ * Copyright (c) 2014 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#include "sanity.h"
+#include "sha256.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static const uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static
+void
+process_block(uint32_t state[8], const unsigned char *block)
+{
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h;
+    size_t i;
+
+    for (i = 0; i < 16; i++)
+        w[i] = ((uint32_t)block[i * 4] << 24) |
+               ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) |
+               ((uint32_t)block[i * 4 + 3]);
+    for (i = 16; i < 64; i++) {
+        const uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^
+                            (w[i - 15] >> 3);
+        const uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^
+                            (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    a = state[0]; b = state[1]; c = state[2]; d = state[3];
+    e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+    for (i = 0; i < 64; i++) {
+        const uint32_t s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+        const uint32_t ch = (e & f) ^ (~e & g);
+        const uint32_t t1 = h + s1 + ch + round_constants[i] + w[i];
+        const uint32_t s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+        const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        const uint32_t t2 = s0 + maj;
+
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+#undef ROTR
+
+/* ---------------------------------------------------------------------
+ * The "atf_sha256" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+/** Initializes a SHA-256 computation as described in FIPS 180-4.
+ *
+ * The object holds no resources, so it does not need to be finalized if
+ * the digest is not wanted after all. */
+void
+atf_sha256_init(atf_sha256_t *s)
+{
+    s->m_state[0] = 0x6a09e667;
+    s->m_state[1] = 0xbb67ae85;
+    s->m_state[2] = 0x3c6ef372;
+    s->m_state[3] = 0xa54ff53a;
+    s->m_state[4] = 0x510e527f;
+    s->m_state[5] = 0x9b05688c;
+    s->m_state[6] = 0x1f83d9ab;
+    s->m_state[7] = 0x5be0cd19;
+    s->m_length = 0;
+    s->m_block_length = 0;
+}
+
+/*
+ * Modifiers.
+ */
+
+/** Feeds data into the computation; the data can be split in chunks of
+ * any size across calls. */
+void
+atf_sha256_update(atf_sha256_t *s, const void *data, size_t length)
+{
+    const unsigned char *ptr = data;
+
+    s->m_length += length;
+
+    if (s->m_block_length > 0) {
+        size_t n = sizeof(s->m_block) - s->m_block_length;
+        if (n > length)
+            n = length;
+        memcpy(s->m_block + s->m_block_length, ptr, n);
+        s->m_block_length += n;
+        ptr += n;
+        length -= n;
+
+        if (s->m_block_length < sizeof(s->m_block))
+            return;
+        process_block(s->m_state, s->m_block);
+        s->m_block_length = 0;
+    }
+
+    while (length >= sizeof(s->m_block)) {
+        process_block(s->m_state, ptr);
+        ptr += sizeof(s->m_block);
+        length -= sizeof(s->m_block);
+    }
+
+    memcpy(s->m_block, ptr, length);
+    s->m_block_length = length;
+}
+
+/** Finishes the computation and stores the ATF_SHA256_DIGEST_LENGTH bytes
+ * of the digest in 'digest'.
+ *
+ * The object must not be updated again unless reinitialized. */
+void
+atf_sha256_final(atf_sha256_t *s, unsigned char *digest)
+{
+    const uint64_t bits = s->m_length * 8;
+    size_t i;
+
+    s->m_block[s->m_block_length++] = 0x80;
+    if (s->m_block_length > sizeof(s->m_block) - 8) {
+        memset(s->m_block + s->m_block_length, 0,
+               sizeof(s->m_block) - s->m_block_length);
+        process_block(s->m_state, s->m_block);
+        s->m_block_length = 0;
+    }
+    memset(s->m_block + s->m_block_length, 0,
+           sizeof(s->m_block) - 8 - s->m_block_length);
+    for (i = 0; i < 8; i++)
+        s->m_block[sizeof(s->m_block) - 1 - i] =
+            (unsigned char)(bits >> (i * 8));
+    process_block(s->m_state, s->m_block);
+
+    for (i = 0; i < 8; i++) {
+        digest[i * 4] = (unsigned char)(s->m_state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(s->m_state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(s->m_state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)(s->m_state[i]);
+    }
+}
+
+/** Finishes the computation like atf_sha256_final but stores the digest
+ * as a nul-terminated string of ATF_SHA256_HEX_LENGTH lowercase
+ * hexadecimal digits. */
+void
+atf_sha256_final_hex(atf_sha256_t *s, char *hex)
+{
+    static const char digits[] = "0123456789abcdef";
+    unsigned char digest[ATF_SHA256_DIGEST_LENGTH];
+    size_t i;
+
+    atf_sha256_final(s, digest);
+    for (i = 0; i < ATF_SHA256_DIGEST_LENGTH; i++) {
+        hex[i * 2] = digits[digest[i] >> 4];
+        hex[i * 2 + 1] = digits[digest[i] & 0x0f];
+    }
+    hex[ATF_SHA256_HEX_LENGTH] = '\0';
+}
+
+/** Validates a digest given as a string of hexadecimal digits.
+ *
+ * The 'length' characters starting at 'str' must be exactly
+ * ATF_SHA256_HEX_LENGTH hexadecimal digits in any case.  If so, they are
+ * stored in 'hex' as a nul-terminated lowercase string comparable with the
+ * output of atf_sha256_final_hex and true is returned; otherwise 'hex' is
+ * left untouched and false is returned. */
+bool
+atf_sha256_parse_hex(const char *str, const size_t length, char *hex)
+{
+    size_t i;
+
+    if (length != ATF_SHA256_HEX_LENGTH)
+        return false;
+    for (i = 0; i < length; i++) {
+        if (!isxdigit((unsigned char)str[i]))
+            return false;
+    }
+
+    for (i = 0; i < length; i++)
+        hex[i] = (char)tolower((unsigned char)str[i]);
+    hex[length] = '\0';
+    return true;
+}
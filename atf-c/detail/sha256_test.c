@@ -0,0 +1,177 @@
+/*
+ * Automated Testing Framework (atf)
+ *
+ * Copyright (c) 2014 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <atf-c.h>
+
+#include "sha256.h"
+#include "test_helpers.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+void
+check_digest(const char *data, const size_t length, const char *exp)
+{
+    atf_sha256_t s;
+    char hex[ATF_SHA256_HEX_LENGTH + 1];
+
+    atf_sha256_init(&s);
+    atf_sha256_update(&s, data, length);
+    atf_sha256_final_hex(&s, hex);
+    ATF_CHECK_STREQ_MSG(exp, hex, "digest of %zu bytes is %s, expected %s",
+                        length, hex, exp);
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_sha256" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(vectors);
+ATF_TC_HEAD(vectors, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the digests of the test "
+                      "vectors in FIPS 180-4");
+}
+ATF_TC_BODY(vectors, tc)
+{
+    const char *long_msg = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmn"
+                           "omnopnopq";
+
+    check_digest("", 0, "e3b0c44298fc1c149afbf4c8996fb924"
+                        "27ae41e4649b934ca495991b7852b855");
+    check_digest("abc", 3, "ba7816bf8f01cfea414140de5dae2223"
+                           "b00361a396177a9cb410ff61f20015ad");
+    check_digest(long_msg, strlen(long_msg),
+                 "248d6a61d20638b8e5c026930c3e6039"
+                 "a33ce45964ff2167f6ecedd419db06c1");
+}
+
+ATF_TC(padding);
+ATF_TC_HEAD(padding, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the digests of messages whose "
+                      "length is close to the block size");
+}
+ATF_TC_BODY(padding, tc)
+{
+    char buf[128];
+
+    memset(buf, 'a', sizeof(buf));
+    check_digest(buf, 55, "9f4390f8d30c2dd92ec9f095b65e2b9a"
+                          "e9b0a925a5258e241c9f1e910f734318");
+    check_digest(buf, 56, "b35439a4ac6f0948b6d6f9e3c6af0f5f"
+                          "590ce20f1bde7090ef7970686ec6738a");
+    check_digest(buf, 64, "ffe054fe7ae0cb6dc65c3af9b61d5209"
+                          "f439851db43d0ba5997337df154668eb");
+    check_digest(buf, 128, "6836cf13bac400e9105071cd6af47084"
+                           "dfacad4e5e302c94bfed24e013afb73e");
+}
+
+ATF_TC(chunks);
+ATF_TC_HEAD(chunks, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the digest does not depend "
+                      "on how the data is split across updates");
+}
+ATF_TC_BODY(chunks, tc)
+{
+    static const size_t sizes[] = { 1, 3, 63, 64, 65, 1000, 4096 };
+    char *data;
+    size_t i;
+
+    data = malloc(1000000);
+    ATF_REQUIRE(data != NULL);
+    memset(data, 'a', 1000000);
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        atf_sha256_t s;
+        char hex[ATF_SHA256_HEX_LENGTH + 1];
+        size_t done;
+
+        atf_sha256_init(&s);
+        for (done = 0; done < 1000000; done += sizes[i])
+            atf_sha256_update(&s, data + done,
+                              1000000 - done < sizes[i] ?
+                              1000000 - done : sizes[i]);
+        atf_sha256_final_hex(&s, hex);
+        ATF_CHECK_STREQ_MSG("cdc76e5c9914fb9281a1c7e284d73e67"
+                            "f1809a48a497200e046d39ccc7112cd0", hex,
+                            "wrong digest with chunks of %zu bytes",
+                            sizes[i]);
+    }
+
+    free(data);
+}
+
+ATF_TC(parse_hex);
+ATF_TC_HEAD(parse_hex, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the validation of digests given "
+                      "as hexadecimal strings");
+}
+ATF_TC_BODY(parse_hex, tc)
+{
+    const char *upper =
+        "E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855";
+    const char *lower =
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+    char hex[ATF_SHA256_HEX_LENGTH + 1];
+
+    ATF_REQUIRE(atf_sha256_parse_hex(lower, strlen(lower), hex));
+    ATF_CHECK_STREQ(lower, hex);
+    ATF_REQUIRE(atf_sha256_parse_hex(upper, strlen(upper), hex));
+    ATF_CHECK_STREQ(lower, hex);
+
+    strcpy(hex, "untouched");
+    ATF_CHECK(!atf_sha256_parse_hex(lower, strlen(lower) - 1, hex));
+    ATF_CHECK(!atf_sha256_parse_hex("", 0, hex));
+    ATF_CHECK(!atf_sha256_parse_hex(
+        "g3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+        ATF_SHA256_HEX_LENGTH, hex));
+    ATF_CHECK_STREQ("untouched", hex);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, vectors);
+    ATF_TP_ADD_TC(tp, padding);
+    ATF_TP_ADD_TC(tp, chunks);
+    ATF_TP_ADD_TC(tp, parse_hex);
+
+    return atf_no_error();
+}
@@ -131,6 +131,29 @@
             return atfu_err; \
     } while (0)
 
+#define ATF_TP_ADD_TC_PARAMS(tp, tc, params, field) \
+    do { \
+        atf_error_t atfu_err; \
+        char **atfu_config = atf_tp_get_config(tp); \
+        if (atfu_config == NULL) \
+            return atf_no_memory_error(); \
+        atfu_err = atf_tc_init_pack(&atfu_ ## tc ## _tc, \
+                                    &atfu_ ## tc ## _tc_pack, \
+                                    (const char *const *)atfu_config); \
+        atf_utils_free_charpp(atfu_config); \
+        if (atf_is_error(atfu_err)) \
+            return atfu_err; \
+        atfu_err = atf_tp_add_tc_params(tp, &atfu_ ## tc ## _tc, (params), \
+            sizeof(params) / sizeof((params)[0]), sizeof((params)[0]), \
+            (size_t)((const char *)&(params)[0].field - \
+                     (const char *)&(params)[0])); \
+        if (atf_is_error(atfu_err)) \
+            return atfu_err; \
+    } while (0)
+
+#define ATF_TC_PARAM(tcptr, type) \
+    ((const type *)atf_tc_get_param(tcptr))
+
 #define ATF_REQUIRE_MSG(x, fmt, ...) \
     do { \
         if (!(x)) \
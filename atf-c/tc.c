@@ -43,6 +43,7 @@
 #include "atf-c/defs.h"
 #include "atf-c/error.h"
 #include "atf-c/tc.h"
+#include "atf-c/utils.h"
 
 #include "detail/env.h"
 #include "detail/fs.h"
@@ -539,8 +540,113 @@ struct atf_tc_impl {
     atf_tc_head_t m_head;
     atf_tc_body_t m_body;
     atf_tc_cleanup_t m_cleanup;
+
+    void *m_data;
+
+    /* Only set for the instances of parameterized test cases. */
+    const atf_tc_t *m_base;
+    const void *m_param;
+    char *m_owned_ident;
 };
 
+/*
+ * Returns the map holding the configuration of the test case, which the
+ * instances of a parameterized test case share with their base.
+ */
+static
+const atf_map_t *
+config_map(const atf_tc_t *tc)
+{
+    if (tc->pimpl->m_base != NULL)
+        return &tc->pimpl->m_base->pimpl->m_config;
+    else
+        return &tc->pimpl->m_config;
+}
+
+/*
+ * Looks for a metadata variable in the test case and, if not found there,
+ * in the base test case it is an instance of.  Returns NULL if the variable
+ * is not defined.
+ */
+static
+const char *
+find_md_var(const atf_tc_t *tc, const char *name)
+{
+    atf_map_citer_t iter;
+
+    iter = atf_map_find_c(&tc->pimpl->m_vars, name);
+    if (!atf_equal_map_citer_map_citer(iter, atf_map_end_c(&tc->pimpl->m_vars)))
+        return atf_map_citer_data(iter);
+    else if (tc->pimpl->m_base != NULL)
+        return find_md_var(tc->pimpl->m_base, name);
+    else
+        return NULL;
+}
+
+/*
+ * Builds the array returned by atf_tc_get_md_vars for an instance of a
+ * parameterized test case.  The variables of the base come first, in their
+ * original order and overridden by those of the instance, followed by the
+ * variables only defined in the instance.
+ */
+static
+char **
+merged_md_vars(const atf_tc_t *tc)
+{
+    const atf_map_t *own = &tc->pimpl->m_vars;
+    const atf_map_t *base = &tc->pimpl->m_base->pimpl->m_vars;
+    atf_map_citer_t iter;
+    char **array;
+    size_t i;
+
+    array = malloc(sizeof(char *) *
+                   ((atf_map_size(own) + atf_map_size(base)) * 2 + 1));
+    if (array == NULL)
+        goto out;
+
+    i = 0;
+    array[i] = NULL;
+    atf_map_for_each_c(iter, base) {
+        const char *key = atf_map_citer_key(iter);
+
+        array[i] = strdup(key);
+        array[i + 1] = NULL;
+        if (array[i] == NULL)
+            goto err;
+
+        array[i + 1] = strdup(find_md_var(tc, key));
+        array[i + 2] = NULL;
+        if (array[i + 1] == NULL)
+            goto err;
+
+        i += 2;
+    }
+    atf_map_for_each_c(iter, own) {
+        const char *key = atf_map_citer_key(iter);
+        if (atf_tc_has_md_var(tc->pimpl->m_base, key))
+            continue;
+
+        array[i] = strdup(key);
+        array[i + 1] = NULL;
+        if (array[i] == NULL)
+            goto err;
+
+        array[i + 1] = strdup((const char *)atf_map_citer_data(iter));
+        array[i + 2] = NULL;
+        if (array[i + 1] == NULL)
+            goto err;
+
+        i += 2;
+    }
+    array[i] = NULL;
+
+out:
+    return array;
+err:
+    atf_utils_free_charpp(array);
+    return NULL;
+}
+
 /*
  * Constructors/destructors.
  */
@@ -549,6 +655,29 @@ atf_error_t
 atf_tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
             atf_tc_body_t body, atf_tc_cleanup_t cleanup,
             const char *const *config)
+{
+    return atf_tc_init_data(tc, ident, head, body, cleanup, config, NULL);
+}
+
+atf_error_t
+atf_tc_init_pack(atf_tc_t *tc, const atf_tc_pack_t *pack,
+                 const char *const *config)
+{
+    return atf_tc_init(tc, pack->m_ident, pack->m_head, pack->m_body,
+                       pack->m_cleanup, config);
+}
+
+/**
+ * Initializes a test case like atf_tc_init does, but also attaches an
+ * opaque pointer to it that can later be queried with atf_tc_get_data.
+ * The pointer is already available when the head runs, which lets
+ * wrappers in other languages find their own test case object without
+ * any lookups.
+ */
+atf_error_t
+atf_tc_init_data(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
+                 atf_tc_body_t body, atf_tc_cleanup_t cleanup,
+                 const char *const *config, void *data)
 {
     atf_error_t err;
 
@@ -562,6 +691,10 @@ atf_tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
     tc->pimpl->m_head = head;
     tc->pimpl->m_body = body;
     tc->pimpl->m_cleanup = cleanup;
+    tc->pimpl->m_data = data;
+    tc->pimpl->m_base = NULL;
+    tc->pimpl->m_param = NULL;
+    tc->pimpl->m_owned_ident = NULL;
 
     err = atf_map_init_charpp(&tc->pimpl->m_config, config);
     if (atf_is_error(err))
@@ -602,18 +735,81 @@ err:
     return err;
 }
 
+/**
+ * Initializes an instance of a parameterized test case.
+ *
+ * The instance is named after the base test case and the given name,
+ * separated by a slash, and runs the same body and cleanup routines with
+ * the given parameter, which atf_tc_get_param returns.  The instance
+ * shares the configuration and the metadata of the base, which must
+ * outlive it, so its head is not run again.
+ */
 atf_error_t
-atf_tc_init_pack(atf_tc_t *tc, const atf_tc_pack_t *pack,
-                 const char *const *config)
+atf_tc_init_instance(atf_tc_t *tc, const atf_tc_t *base, const char *name,
+                     const void *param, void *data)
 {
-    return atf_tc_init(tc, pack->m_ident, pack->m_head, pack->m_body,
-                       pack->m_cleanup, config);
+    atf_error_t err;
+
+    PRE(base->pimpl->m_base == NULL);
+
+    if (name[0] == '\0' || strchr(name, ':') != NULL) {
+        err = atf_libc_error(EINVAL, "Invalid parameter name '%s' for test "
+                             "case %s", name, atf_tc_get_ident(base));
+        goto err;
+    }
+
+    tc->pimpl = malloc(sizeof(struct atf_tc_impl));
+    if (tc->pimpl == NULL) {
+        err = atf_no_memory_error();
+        goto err;
+    }
+
+    err = atf_text_format(&tc->pimpl->m_owned_ident, "%s/%s",
+                          atf_tc_get_ident(base), name);
+    if (atf_is_error(err))
+        goto err_pimpl;
+
+    tc->pimpl->m_ident = tc->pimpl->m_owned_ident;
+    tc->pimpl->m_head = NULL;
+    tc->pimpl->m_body = base->pimpl->m_body;
+    tc->pimpl->m_cleanup = base->pimpl->m_cleanup;
+    tc->pimpl->m_data = data;
+    tc->pimpl->m_base = base;
+    tc->pimpl->m_param = param;
+
+    err = atf_map_init(&tc->pimpl->m_config);
+    if (atf_is_error(err))
+        goto err_ident;
+
+    err = atf_map_init(&tc->pimpl->m_vars);
+    if (atf_is_error(err))
+        goto err_config;
+
+    err = atf_tc_set_md_var(tc, "ident", "%s", tc->pimpl->m_ident);
+    if (atf_is_error(err))
+        goto err_vars;
+
+    INV(!atf_is_error(err));
+    return err;
+
+err_vars:
+    atf_map_fini(&tc->pimpl->m_vars);
+err_config:
+    atf_map_fini(&tc->pimpl->m_config);
+err_ident:
+    free(tc->pimpl->m_owned_ident);
+err_pimpl:
+    free(tc->pimpl);
+err:
+    return err;
 }
 
 void
 atf_tc_fini(atf_tc_t *tc)
 {
     atf_map_fini(&tc->pimpl->m_vars);
+    atf_map_fini(&tc->pimpl->m_config);
+    free(tc->pimpl->m_owned_ident);
     free(tc->pimpl);
 }
 
@@ -627,6 +823,18 @@ atf_tc_get_ident(const atf_tc_t *tc)
     return tc->pimpl->m_ident;
 }
 
+void *
+atf_tc_get_data(const atf_tc_t *tc)
+{
+    return tc->pimpl->m_data;
+}
+
+const void *
+atf_tc_get_param(const atf_tc_t *tc)
+{
+    return tc->pimpl->m_param;
+}
+
 const char *
 atf_tc_get_config_var(const atf_tc_t *tc, const char *name)
 {
@@ -634,7 +842,7 @@ atf_tc_get_config_var(const atf_tc_t *tc, const char *name)
     atf_map_citer_t iter;
 
     PRE(atf_tc_has_config_var(tc, name));
-    iter = atf_map_find_c(&tc->pimpl->m_config, name);
+    iter = atf_map_find_c(config_map(tc), name);
     val = atf_map_citer_data(iter);
     INV(val != NULL);
 
@@ -723,11 +931,9 @@ const char *
 atf_tc_get_md_var(const atf_tc_t *tc, const char *name)
 {
     const char *val;
-    atf_map_citer_t iter;
 
     PRE(atf_tc_has_md_var(tc, name));
-    iter = atf_map_find_c(&tc->pimpl->m_vars, name);
-    val = atf_map_citer_data(iter);
+    val = find_md_var(tc, name);
     INV(val != NULL);
 
     return val;
@@ -736,7 +942,10 @@ atf_tc_get_md_var(const atf_tc_t *tc, const char *name)
 char **
 atf_tc_get_md_vars(const atf_tc_t *tc)
 {
-    return atf_map_to_charpp(&tc->pimpl->m_vars);
+    if (tc->pimpl->m_base != NULL)
+        return merged_md_vars(tc);
+    else
+        return atf_map_to_charpp(&tc->pimpl->m_vars);
 }
 
 bool
@@ -744,19 +953,15 @@ atf_tc_has_config_var(const atf_tc_t *tc, const char *name)
 {
     atf_map_citer_t end, iter;
 
-    iter = atf_map_find_c(&tc->pimpl->m_config, name);
-    end = atf_map_end_c(&tc->pimpl->m_config);
+    iter = atf_map_find_c(config_map(tc), name);
+    end = atf_map_end_c(config_map(tc));
     return !atf_equal_map_citer_map_citer(iter, end);
 }
 
 bool
 atf_tc_has_md_var(const atf_tc_t *tc, const char *name)
 {
-    atf_map_citer_t end, iter;
-
-    iter = atf_map_find_c(&tc->pimpl->m_vars, name);
-    end = atf_map_end_c(&tc->pimpl->m_vars);
-    return !atf_equal_map_citer_map_citer(iter, end);
+    return find_md_var(tc, name) != NULL;
 }
 
 /*
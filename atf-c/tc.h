@@ -74,10 +74,17 @@ atf_error_t atf_tc_init(atf_tc_t *, const char *, atf_tc_head_t,
                         const char *const *);
 atf_error_t atf_tc_init_pack(atf_tc_t *, atf_tc_pack_t *,
                              const char *const *);
+atf_error_t atf_tc_init_data(atf_tc_t *, const char *, atf_tc_head_t,
+                             atf_tc_body_t, atf_tc_cleanup_t,
+                             const char *const *, void *);
+atf_error_t atf_tc_init_instance(atf_tc_t *, const atf_tc_t *, const char *,
+                                 const void *, void *);
 void atf_tc_fini(atf_tc_t *);
 
 /* Getters. */
 const char *atf_tc_get_ident(const atf_tc_t *);
+void *atf_tc_get_data(const atf_tc_t *);
+const void *atf_tc_get_param(const atf_tc_t *);
 const char *atf_tc_get_config_var(const atf_tc_t *, const char *);
 const char *atf_tc_get_config_var_wd(const atf_tc_t *, const char *,
                                      const char *);
@@ -51,6 +51,11 @@ ATF_TC_HEAD(test_var, tc)
     atf_tc_set_md_var(tc, "test-var", "Test text");
 }
 
+ATF_TC_HEAD(data_var, tc)
+{
+    atf_tc_set_md_var(tc, "test-var", "%s", (const char *)atf_tc_get_data(tc));
+}
+
 /* ---------------------------------------------------------------------
  * Test cases for the "atf_tc_t" type.
  * --------------------------------------------------------------------- */
@@ -109,6 +114,79 @@ ATF_TC_BODY(init_pack, tcin)
     atf_tc_fini(&tc);
 }
 
+ATF_TC(init_data);
+ATF_TC_HEAD(init_data, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests the atf_tc_init_data and "
+                      "atf_tc_get_data functions");
+}
+ATF_TC_BODY(init_data, tcin)
+{
+    atf_tc_t tc;
+    char data[] = "Data text";
+
+    RE(atf_tc_init(&tc, "test1", ATF_TC_HEAD_NAME(empty),
+                   ATF_TC_BODY_NAME(empty), NULL, NULL));
+    ATF_REQUIRE(atf_tc_get_data(&tc) == NULL);
+    atf_tc_fini(&tc);
+
+    RE(atf_tc_init_data(&tc, "test2", ATF_TC_HEAD_NAME(data_var),
+                        ATF_TC_BODY_NAME(empty), NULL, NULL, data));
+    ATF_REQUIRE(strcmp(atf_tc_get_ident(&tc), "test2") == 0);
+    ATF_REQUIRE(atf_tc_get_data(&tc) == data);
+    ATF_REQUIRE(strcmp(atf_tc_get_md_var(&tc, "test-var"), "Data text") == 0);
+    atf_tc_fini(&tc);
+}
+
+ATF_TC(init_instance);
+ATF_TC_HEAD(init_instance, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests the atf_tc_init_instance and "
+                      "atf_tc_get_param functions");
+}
+ATF_TC_BODY(init_instance, tcin)
+{
+    atf_tc_t base, tc;
+    atf_error_t err;
+    const char *const config[] = { "test-var", "test-value", NULL };
+    const int param = 5;
+    char data[] = "Data text";
+    char **vars;
+
+    RE(atf_tc_init_data(&base, "base", ATF_TC_HEAD_NAME(data_var),
+                        ATF_TC_BODY_NAME(empty), NULL, config, data));
+    ATF_REQUIRE(atf_tc_get_param(&base) == NULL);
+
+    RE(atf_tc_init_instance(&tc, &base, "five", &param, NULL));
+    ATF_REQUIRE(strcmp(atf_tc_get_ident(&tc), "base/five") == 0);
+    ATF_REQUIRE(atf_tc_get_param(&tc) == &param);
+    ATF_REQUIRE(strcmp(atf_tc_get_md_var(&tc, "test-var"), "Data text") == 0);
+    ATF_REQUIRE(strcmp(atf_tc_get_config_var(&tc, "test-var"),
+                       "test-value") == 0);
+
+    RE(atf_tc_set_md_var(&tc, "test-var", "Own text"));
+    ATF_REQUIRE(strcmp(atf_tc_get_md_var(&tc, "test-var"), "Own text") == 0);
+    ATF_REQUIRE(strcmp(atf_tc_get_md_var(&base, "test-var"),
+                       "Data text") == 0);
+
+    vars = atf_tc_get_md_vars(&tc);
+    ATF_REQUIRE(vars != NULL);
+    ATF_REQUIRE(strcmp(vars[0], "ident") == 0);
+    ATF_REQUIRE(strcmp(vars[1], "base/five") == 0);
+    ATF_REQUIRE(strcmp(vars[2], "test-var") == 0);
+    ATF_REQUIRE(strcmp(vars[3], "Own text") == 0);
+    ATF_REQUIRE(vars[4] == NULL);
+    atf_utils_free_charpp(vars);
+    atf_tc_fini(&tc);
+
+    err = atf_tc_init_instance(&tc, &base, "a:b", &param, NULL);
+    ATF_REQUIRE(atf_is_error(err));
+    ATF_REQUIRE(atf_error_is(err, "libc"));
+    atf_error_free(err);
+
+    atf_tc_fini(&base);
+}
+
 ATF_TC(vars);
 ATF_TC_HEAD(vars, tc)
 {
@@ -181,6 +259,8 @@ ATF_TP_ADD_TCS(tp)
     /* Add the test cases for the "atf_tcr_t" type. */
     ATF_TP_ADD_TC(tp, init);
     ATF_TP_ADD_TC(tp, init_pack);
+    ATF_TP_ADD_TC(tp, init_data);
+    ATF_TP_ADD_TC(tp, init_instance);
     ATF_TP_ADD_TC(tp, vars);
     ATF_TP_ADD_TC(tp, config);
 
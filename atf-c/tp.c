@@ -43,6 +43,9 @@
 struct atf_tp_impl {
     atf_list_t m_tcs;
     atf_map_t m_config;
+
+    /* Test cases that only provide the metadata of parameterized ones. */
+    atf_list_t m_bases;
 };
 
 /* ---------------------------------------------------------------------
@@ -97,6 +100,13 @@ atf_tp_init(atf_tp_t *tp, const char *const *config)
         goto out;
     }
 
+    err = atf_list_init(&tp->pimpl->m_bases);
+    if (atf_is_error(err)) {
+        atf_map_fini(&tp->pimpl->m_config);
+        atf_list_fini(&tp->pimpl->m_tcs);
+        goto out;
+    }
+
     INV(!atf_is_error(err));
 out:
     return err;
@@ -115,6 +125,12 @@ atf_tp_fini(atf_tp_t *tp)
     }
     atf_list_fini(&tp->pimpl->m_tcs);
 
+    atf_list_for_each(iter, &tp->pimpl->m_bases) {
+        atf_tc_t *tc = atf_list_iter_data(iter);
+        atf_tc_fini(tc);
+    }
+    atf_list_fini(&tp->pimpl->m_bases);
+
     free(tp->pimpl);
 }
 
@@ -190,6 +206,56 @@ atf_tp_add_tc(atf_tp_t *tp, atf_tc_t *tc)
     return err;
 }
 
+/**
+ * Adds an instance of the given initialized test case for every entry in
+ * the params array, which holds count entries of the given size.  Each
+ * entry names its instance through a string pointed to by the member at
+ * name_offset.  The test program takes ownership of the base test case,
+ * which is not run on its own.
+ */
+atf_error_t
+atf_tp_add_tc_params(atf_tp_t *tp, atf_tc_t *base, const void *params,
+                     const size_t count, const size_t size,
+                     const size_t name_offset)
+{
+    atf_error_t err;
+    size_t i;
+
+    err = atf_list_append(&tp->pimpl->m_bases, base, false);
+    if (atf_is_error(err)) {
+        atf_tc_fini(base);
+        goto out;
+    }
+
+    for (i = 0; i < count; i++) {
+        const char *param = (const char *)params + i * size;
+        const char *name = *(const char *const *)(param + name_offset);
+        atf_tc_t *tc;
+
+        tc = malloc(sizeof(atf_tc_t));
+        if (tc == NULL) {
+            err = atf_no_memory_error();
+            break;
+        }
+
+        err = atf_tc_init_instance(tc, base, name, param, NULL);
+        if (atf_is_error(err)) {
+            free(tc);
+            break;
+        }
+
+        err = atf_list_append(&tp->pimpl->m_tcs, tc, true);
+        if (atf_is_error(err)) {
+            atf_tc_fini(tc);
+            free(tc);
+            break;
+        }
+    }
+
+out:
+    return err;
+}
+
 /* ---------------------------------------------------------------------
  * Free functions.
  * --------------------------------------------------------------------- */
@@ -31,6 +31,7 @@
 #define ATF_C_TP_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include <atf-c/error_fwd.h>
 
@@ -58,6 +59,8 @@ const struct atf_tc *const *atf_tp_get_tcs(const atf_tp_t *);
 
 /* Modifiers. */
 atf_error_t atf_tp_add_tc(atf_tp_t *, struct atf_tc *);
+atf_error_t atf_tp_add_tc_params(atf_tp_t *, struct atf_tc *, const void *,
+                                 const size_t, const size_t, const size_t);
 
 /* ---------------------------------------------------------------------
  * Free functions.
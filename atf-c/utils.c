@@ -27,15 +27,29 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if defined(HAVE_CONFIG_H)
+#include "bconfig.h"
+#endif
+
 #include "atf-c/utils.h"
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 
+#if defined(HAVE_LINUX_FS_H)
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+#include <dirent.h>
 #include <err.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <regex.h>
+#include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,6 +58,232 @@
 #include <atf-c.h>
 
 #include "detail/dynstr.h"
+#include "detail/fs.h"
+#include "detail/line_reader.h"
+#include "detail/process.h"
+#include "detail/sha256.h"
+
+/** Size of the blocks in which files are read when they cannot be mapped. */
+static const size_t block_size = 64 * 1024;
+
+/** A line reader that read ahead of the lines returned so far by
+ * atf_utils_readline from a regular file. */
+struct pending_reader {
+    atf_line_reader_t m_reader;
+    dev_t m_dev;
+    ino_t m_ino;
+    off_t m_offset;  /* Position of the descriptor after the last line. */
+};
+
+/** Readers with unreturned data left by atf_utils_readline, indexed by the
+ * file descriptor they read from. */
+static struct pending_reader **pending_readers = NULL;
+static int pending_readers_size = 0;
+
+struct atf_utils_reader_impl {
+    atf_line_reader_t m_reader;
+};
+
+/** Callback to process the contents of a file block by block.
+ *
+ * \param data The next block of the file.
+ * \param length The length of the block.
+ * \param arg The argument given to visit_file().
+ *
+ * \return False to stop processing the file; true otherwise. */
+typedef bool (*block_visitor_t)(const char *, size_t, void *);
+
+/** Reads up to a given number of bytes, retrying on short reads.
+ *
+ * \param fd The descriptor to read from.
+ * \param buf The buffer in which to store the data.
+ * \param length The number of bytes to read.
+ * \param name The name of the file, for error reporting.
+ *
+ * \return The number of bytes read, which is only less than length at the
+ * end of the file. */
+static
+size_t
+read_block(const int fd, char *buf, const size_t length, const char *name)
+{
+    size_t done = 0;
+    while (done < length) {
+        const ssize_t n = read(fd, buf + done, length - done);
+        if (n == -1) {
+            ATF_REQUIRE_MSG(errno == EINTR, "Failed to read from %s", name);
+            continue;
+        } else if (n == 0)
+            break;
+        done += n;
+    }
+    return done;
+}
+
+/** Hands the contents of a file to a visitor.
+ *
+ * Regular files are mapped into memory and passed as a single block, so
+ * their contents are not copied at all.  Other files, and those that cannot
+ * be mapped, are read in large blocks.
+ *
+ * \param fd The descriptor of the file, positioned at its beginning.
+ * \param name The name of the file, for error reporting.
+ * \param visitor The function to call for every block.
+ * \param arg An argument to pass to the visitor.
+ *
+ * \return False if the visitor stopped the processing; true otherwise. */
+static
+bool
+visit_file(const int fd, const char *name, block_visitor_t visitor, void *arg)
+{
+    struct stat sb;
+    ATF_REQUIRE_MSG(fstat(fd, &sb) != -1, "Failed to stat %s", name);
+
+    if (S_ISREG(sb.st_mode) && sb.st_size > 0 &&
+        (uintmax_t)sb.st_size <= SIZE_MAX) {
+        const size_t size = (size_t)sb.st_size;
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+#if defined(POSIX_MADV_SEQUENTIAL)
+            (void)posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+#endif
+            const bool completed = visitor(map, size, arg);
+            munmap(map, size);
+            return completed;
+        }
+    }
+
+    char *buffer = malloc(block_size);
+    ATF_REQUIRE(buffer != NULL);
+    bool completed = true;
+    size_t length;
+    do {
+        length = read_block(fd, buffer, block_size, name);
+        if (length > 0)
+            completed = visitor(buffer, length, arg);
+    } while (completed && length == block_size);
+    free(buffer);
+    return completed;
+}
+
+/** PIDs of the subprocesses spawned by atf_utils_fork that have not been
+ * waited for yet. */
+static pid_t *forked_pids = NULL;
+static size_t forked_pids_count = 0;
+static size_t forked_pids_size = 0;
+
+/** Records a subprocess spawned by atf_utils_fork.
+ *
+ * \param pid The PID of the subprocess. */
+static
+void
+add_forked_pid(const pid_t pid)
+{
+    if (forked_pids_count == forked_pids_size) {
+        const size_t newsize = forked_pids_size == 0 ? 16 :
+            forked_pids_size * 2;
+        pid_t *newpids = realloc(forked_pids, sizeof(pid_t) * newsize);
+        ATF_REQUIRE(newpids != NULL);
+        forked_pids = newpids;
+        forked_pids_size = newsize;
+    }
+    forked_pids[forked_pids_count++] = pid;
+}
+
+/** Looks for a subprocess spawned by atf_utils_fork.
+ *
+ * \param pid The PID of the subprocess.
+ *
+ * \return The position of the subprocess in forked_pids, or
+ * forked_pids_count if it is not there. */
+static
+size_t
+find_forked_pid(const pid_t pid)
+{
+    size_t i;
+
+    for (i = 0; i < forked_pids_count; i++)
+        if (forked_pids[i] == pid)
+            break;
+    return i;
+}
+
+/** Forgets about a subprocess spawned by atf_utils_fork once waited for.
+ *
+ * \param pid The PID of the subprocess. */
+static
+void
+remove_forked_pid(const pid_t pid)
+{
+    const size_t i = find_forked_pid(pid);
+    if (i < forked_pids_count)
+        forked_pids[i] = forked_pids[--forked_pids_count];
+}
+
+/** Collects any terminated subprocess spawned by atf_utils_fork.
+ *
+ * \param [out] status The exit status of the collected subprocess.
+ *
+ * \return The PID of the collected subprocess, or 0 if all of them are
+ * still running. */
+static
+pid_t
+poll_forked_pids(int *status)
+{
+    size_t i;
+
+    for (i = 0; i < forked_pids_count; i++) {
+        const pid_t pid = forked_pids[i];
+
+        const pid_t ret = waitpid(pid, status, WNOHANG);
+        ATF_REQUIRE(ret != -1);
+        if (ret == pid)
+            return pid;
+    }
+    return 0;
+}
+
+/** Handler for SIGCHLD while atf_utils_wait_any() sleeps.
+ *
+ * It only exists so that the signal interrupts sigsuspend(). */
+static
+void
+sigchld_handler(const int signo ATF_DEFS_ATTRIBUTE_UNUSED)
+{
+}
+
+/** Builds the name of a file capturing the output of a subprocess.
+ *
+ * The names include the PID of the subprocess so that several subprocesses
+ * can run at once.
+ *
+ * \param [out] buf The buffer in which to store the name.
+ * \param size The size of buf.
+ * \param pid The PID of the subprocess.
+ * \param stream Either "out" or "err". */
+static
+void
+fork_out_name(char *buf, const size_t size, const pid_t pid,
+              const char *stream)
+{
+    const int len = snprintf(buf, size, "atf_utils_fork_%d_%s.txt", (int)pid,
+                             stream);
+    ATF_REQUIRE(len > 0 && (size_t)len < size);
+}
+
+/** Matches a string against an already-compiled regular expression.
+ *
+ * \param preg The compiled expression.
+ * \param str The string in which to look for the expression.
+ *
+ * \return True if there is a match; false otherwise. */
+static
+bool
+grep_compiled(const regex_t *preg, const char *str)
+{
+    const int res = regexec(preg, str, 0, NULL, 0);
+    ATF_REQUIRE(res == 0 || res == REG_NOMATCH);
+    return res == 0;
+}
 
 /** Searches for a regexp in a string.
  *
@@ -55,18 +295,46 @@ static
 bool
 grep_string(const char *regex, const char *str)
 {
-    int res;
-    regex_t preg;
+    const char *strs[2];
 
-    printf("Looking for '%s' in '%s'\n", regex, str);
-    ATF_REQUIRE(regcomp(&preg, regex, REG_EXTENDED) == 0);
+    strs[0] = str;
+    strs[1] = NULL;
+    return atf_utils_grep_strings(regex, strs);
+}
 
-    res = regexec(&preg, str, 0, NULL, 0);
-    ATF_REQUIRE(res == 0 || res == REG_NOMATCH);
+/** State of atf_utils_cat_file() between blocks. */
+struct cat_state {
+    const char *prefix;
+    size_t prefix_length;
+    bool continued;
+};
 
-    regfree(&preg);
+/** Prints a block of a file, prepending a prefix to every line.
+ *
+ * \param data The block to print.
+ * \param length The length of the block.
+ * \param arg The cat_state of the file being printed.
+ *
+ * \return Always true. */
+static
+bool
+cat_block(const char *data, size_t length, void *arg)
+{
+    struct cat_state *state = arg;
 
-    return res == 0;
+    while (length > 0) {
+        const char *end = memchr(data, '\n', length);
+        const size_t n = end == NULL ? length : (size_t)(end - data) + 1;
+
+        if (!state->continued)
+            fwrite(state->prefix, 1, state->prefix_length, stdout);
+        fwrite(data, 1, n, stdout);
+        state->continued = end == NULL;
+
+        data += n;
+        length -= n;
+    }
+    return true;
 }
 
 /** Prints the contents of a file to stdout.
@@ -80,33 +348,38 @@ atf_utils_cat_file(const char *name, const char *prefix)
     const int fd = open(name, O_RDONLY);
     ATF_REQUIRE_MSG(fd != -1, "Cannot open %s", name);
 
-    char buffer[1024];
-    ssize_t count;
-    bool continued = false;
-    while ((count = read(fd, buffer, sizeof(buffer) - 1)) > 0) {
-        buffer[count] = '\0';
-
-        if (!continued)
-            printf("%s", prefix);
-
-        char *iter = buffer;
-        char *end;
-        while ((end = strchr(iter, '\n')) != NULL) {
-            *end = '\0';
-            printf("%s\n", iter);
-
-            iter = end + 1;
-            if (iter != buffer + count)
-                printf("%s", prefix);
-            else
-                continued = false;
-        }
-        if (iter < buffer + count) {
-            printf("%s", iter);
-            continued = true;
-        }
-    }
-    ATF_REQUIRE(count == 0);
+    struct cat_state state;
+    state.prefix = prefix;
+    state.prefix_length = strlen(prefix);
+    state.continued = false;
+    (void)visit_file(fd, name, cat_block, &state);
+    close(fd);
+}
+
+/** State of atf_utils_compare_file() between blocks. */
+struct compare_state {
+    const char *pos;
+    size_t remaining;
+};
+
+/** Compares a block of a file against the golden contents.
+ *
+ * \param data The block to compare.
+ * \param length The length of the block.
+ * \param arg The compare_state with the contents not compared yet.
+ *
+ * \return True if the block matches; false otherwise. */
+static
+bool
+compare_block(const char *data, size_t length, void *arg)
+{
+    struct compare_state *state = arg;
+
+    if (length > state->remaining || memcmp(state->pos, data, length) != 0)
+        return false;
+    state->pos += length;
+    state->remaining -= length;
+    return true;
 }
 
 /** Compares a file against the given golden contents.
@@ -121,22 +394,249 @@ atf_utils_compare_file(const char *name, const char *contents)
     const int fd = open(name, O_RDONLY);
     ATF_REQUIRE_MSG(fd != -1, "Cannot open %s", name);
 
-    const char *pos = contents;
-    ssize_t remaining = strlen(contents);
+    struct compare_state state;
+    state.pos = contents;
+    state.remaining = strlen(contents);
 
-    char buffer[1024];
-    ssize_t count;
-    while ((count = read(fd, buffer, sizeof(buffer))) > 0 &&
-           count <= remaining) {
-        if (memcmp(pos, buffer, count) != 0) {
-            close(fd);
-            return false;
-        }
-        remaining -= count;
-        pos += count;
+    /* Files of a different size cannot match, so do not even read them. */
+    struct stat sb;
+    ATF_REQUIRE_MSG(fstat(fd, &sb) != -1, "Failed to stat %s", name);
+    if (S_ISREG(sb.st_mode) && (uintmax_t)sb.st_size != state.remaining) {
+        close(fd);
+        return false;
     }
+
+    const bool matches = visit_file(fd, name, compare_block, &state);
+    close(fd);
+    return matches && state.remaining == 0;
+}
+
+/** Adds a block of a file to its digest.
+ *
+ * \param data The block to add.
+ * \param length The length of the block.
+ * \param arg The atf_sha256_t of the file.
+ *
+ * \return Always true. */
+static
+bool
+digest_block(const char *data, size_t length, void *arg)
+{
+    atf_sha256_update(arg, data, length);
+    return true;
+}
+
+/** Compares the SHA-256 digest of a file against an expected digest.
+ *
+ * The file is hashed as it is read, so no golden copy of its contents is
+ * needed and its size does not affect the memory used.
+ *
+ * \param name Name of the file to be compared.
+ * \param digest Expected digest of the file, given as 'sha256:' followed
+ *     by its hexadecimal representation.
+ *
+ * \return True if the digest of the file matches; false otherwise. */
+bool
+atf_utils_compare_file_digest(const char *name, const char *digest)
+{
+    const char *prefix = "sha256:";
+    const size_t prefix_length = strlen(prefix);
+    char expected[ATF_SHA256_HEX_LENGTH + 1];
+    char actual[ATF_SHA256_HEX_LENGTH + 1];
+
+    ATF_REQUIRE_MSG(strncmp(digest, prefix, prefix_length) == 0 &&
+                    atf_sha256_parse_hex(digest + prefix_length,
+                                         strlen(digest + prefix_length),
+                                         expected),
+                    "Invalid digest '%s'", digest);
+
+    const int fd = open(name, O_RDONLY);
+    ATF_REQUIRE_MSG(fd != -1, "Cannot open %s", name);
+
+    atf_sha256_t sha256;
+    atf_sha256_init(&sha256);
+    (void)visit_file(fd, name, digest_block, &sha256);
     close(fd);
-    return count == 0 && remaining == 0;
+
+    atf_sha256_final_hex(&sha256, actual);
+    return strcmp(expected, actual) == 0;
+}
+
+/** Attempts to clone a regular file by sharing its data blocks.
+ *
+ * \param source Path to the source file.
+ * \param destination Path to the destination file, which must not exist.
+ * \param mode Permissions of the destination file.
+ *
+ * \return True if the file system supports cloning the file and the clone
+ * was created; false otherwise, in which case the destination does not
+ * exist. */
+static
+bool
+reflink_file(const char *source, const char *destination, const mode_t mode)
+{
+#if defined(FICLONE)
+    const int input = open(source, O_RDONLY);
+    ATF_REQUIRE_MSG(input != -1, "Failed to open %s", source);
+
+    const int output = open(destination, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    ATF_REQUIRE_MSG(output != -1, "Failed to create %s", destination);
+
+    const bool cloned = ioctl(output, FICLONE, input) != -1;
+    if (cloned)
+        ATF_REQUIRE_MSG(fchmod(output, mode) != -1, "Failed to chmod %s",
+                        destination);
+
+    close(output);
+    close(input);
+    if (!cloned)
+        ATF_REQUIRE(unlink(destination) != -1);
+    return cloned;
+#else
+    (void)source;
+    (void)destination;
+    (void)mode;
+    return false;
+#endif
+}
+
+/** Reads the target of a symbolic link.
+ *
+ * \param path Path to the symbolic link.
+ * \param size_hint Length of the target as reported by lstat(2).
+ *
+ * \return The target of the link, which the caller must free. */
+static
+char *
+read_link(const char *path, const off_t size_hint)
+{
+    size_t size = size_hint > 0 ? (size_t)size_hint + 1 : 256;
+
+    for (;;) {
+        char *target = malloc(size);
+        ATF_REQUIRE(target != NULL);
+
+        const ssize_t length = readlink(path, target, size);
+        ATF_REQUIRE_MSG(length != -1, "Failed to read link %s", path);
+        if ((size_t)length < size) {
+            target[length] = '\0';
+            return target;
+        }
+
+        /* A full buffer may hold a truncated target; retry with more room. */
+        free(target);
+        size *= 2;
+    }
+}
+
+/** Removes the file that a clone of a fixture entry is about to replace.
+ *
+ * The file is never written to in place because it may be a hard link to
+ * the fixture itself.
+ *
+ * \param path Path to the file to remove, which need not exist. */
+static
+void
+replace_entry(const char *path)
+{
+    ATF_REQUIRE_MSG(unlink(path) != -1 || errno == ENOENT,
+                    "Failed to replace %s", path);
+}
+
+/** Clones a single entry of a fixture tree.
+ *
+ * \param source Path to the entry to clone.
+ * \param destination Path to the copy.  If it exists, it is replaced
+ *     unless it is a directory, which is populated in place.
+ * \param link_read_only Whether read-only files can be hard-linked. */
+static
+void
+clone_entry(const char *source, const char *destination,
+            const bool link_read_only)
+{
+    struct stat sb;
+    ATF_REQUIRE_MSG(lstat(source, &sb) != -1, "Failed to stat %s", source);
+
+    if (S_ISDIR(sb.st_mode)) {
+        const bool created = mkdir(destination, 0700) != -1;
+        ATF_REQUIRE_MSG(created || errno == EEXIST, "Failed to create %s",
+                        destination);
+
+        DIR *dir = opendir(source);
+        ATF_REQUIRE_MSG(dir != NULL, "Failed to open %s", source);
+        struct dirent *de;
+        while ((de = readdir(dir)) != NULL) {
+            if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+                continue;
+
+            atf_dynstr_t subsource, subdestination;
+            atf_error_t error;
+            error = atf_dynstr_init_fmt(&subsource, "%s/%s", source,
+                                        de->d_name);
+            ATF_REQUIRE(!atf_is_error(error));
+            error = atf_dynstr_init_fmt(&subdestination, "%s/%s", destination,
+                                        de->d_name);
+            ATF_REQUIRE(!atf_is_error(error));
+
+            clone_entry(atf_dynstr_cstring(&subsource),
+                        atf_dynstr_cstring(&subdestination), link_read_only);
+
+            atf_dynstr_fini(&subdestination);
+            atf_dynstr_fini(&subsource);
+        }
+        closedir(dir);
+
+        /* Directories that already existed keep their permissions. */
+        if (created)
+            ATF_REQUIRE_MSG(chmod(destination, sb.st_mode & 07777) != -1,
+                            "Failed to chmod %s", destination);
+    } else if (S_ISLNK(sb.st_mode)) {
+        char *target = read_link(source, sb.st_size);
+        replace_entry(destination);
+        ATF_REQUIRE_MSG(symlink(target, destination) != -1,
+                        "Failed to create link %s", destination);
+        free(target);
+    } else if (S_ISREG(sb.st_mode)) {
+        replace_entry(destination);
+
+        /* Both trees share a hard-linked file, so a test that changes its
+         * permissions or, as root, its contents also changes the fixture;
+         * only do this when the caller asked for it. */
+        if (link_read_only &&
+            (sb.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)) == 0 &&
+            link(source, destination) != -1)
+            return;
+
+        if (reflink_file(source, destination, sb.st_mode & 07777))
+            return;
+
+        atf_utils_copy_file(source, destination);
+    } else
+        atf_tc_fail("Cannot clone %s: unsupported file type", source);
+}
+
+/** Populates a directory with a copy of a fixture tree.
+ *
+ * Regular files are cloned with reflinks if the file system supports them,
+ * so their data is only copied once modified, and copied otherwise.
+ * Read-only files are hard-linked instead if the caller allows it.
+ * Directories, symbolic links and permissions are replicated, and files
+ * already in the destination are replaced.
+ *
+ * \param source Path to the root of the fixture tree.
+ * \param destination Path to the directory to populate, which is created if
+ *     it does not exist.
+ * \param link_read_only Whether read-only files can be shared with the
+ *     fixture through hard links. */
+void
+atf_utils_clone_tree(const char *source, const char *destination,
+                     const bool link_read_only)
+{
+    struct stat sb;
+    ATF_REQUIRE_MSG(stat(source, &sb) != -1, "Failed to stat %s", source);
+    ATF_REQUIRE_MSG(S_ISDIR(sb.st_mode), "%s is not a directory", source);
+
+    clone_entry(source, destination, link_read_only);
 }
 
 /** Copies a file.
@@ -154,12 +654,46 @@ atf_utils_copy_file(const char *source, const char *destination)
     ATF_REQUIRE_MSG(output != -1, "Failed to open destination file during "
                     "copy (%s)", destination);
 
-    char buffer[1024];
-    ssize_t length;
-    while ((length = read(input, buffer, sizeof(buffer))) > 0)
-        ATF_REQUIRE_MSG(write(output, buffer, length) == length,
-                        "Failed to write to %s during copy", destination);
-    ATF_REQUIRE_MSG(length != -1, "Failed to read from %s during copy", source);
+    bool done = false;
+
+#if defined(HAVE_COPY_FILE_RANGE)
+    /* Let the kernel copy the data, or share it if the file system can. */
+    while (!done) {
+        const ssize_t n = copy_file_range(input, NULL, output, NULL,
+                                          SSIZE_MAX, 0);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            ATF_REQUIRE_MSG(errno == ENOSYS || errno == EXDEV ||
+                            errno == EINVAL || errno == EOPNOTSUPP,
+                            "Failed to copy %s to %s", source, destination);
+            break;
+        } else if (n == 0)
+            done = true;
+    }
+#endif
+
+    /* Fall back to a regular copy starting at the current offsets, which
+     * copy_file_range(2) advances for whatever it managed to copy. */
+    if (!done) {
+        char *buffer = malloc(block_size);
+        ATF_REQUIRE(buffer != NULL);
+        size_t length;
+        do {
+            length = read_block(input, buffer, block_size, source);
+            size_t written = 0;
+            while (written < length) {
+                const ssize_t n = write(output, buffer + written,
+                                        length - written);
+                if (n == -1 && errno == EINTR)
+                    continue;
+                ATF_REQUIRE_MSG(n != -1, "Failed to write to %s during copy",
+                                destination);
+                written += n;
+            }
+        } while (length == block_size);
+        free(buffer);
+    }
 
     struct stat sb;
     ATF_REQUIRE_MSG(fstat(input, &sb) != -1,
@@ -220,7 +754,13 @@ atf_utils_file_exists(const char *path)
 /** Spawns a subprocess and redirects its output to files.
  *
  * Use the atf_utils_wait() function to wait for the completion of the spawned
- * subprocess and validate its exit conditions.
+ * subprocess and validate its exit conditions.  Several subprocesses can run
+ * at once because each one writes to its own files, and they can be waited
+ * for in any order or with atf_utils_wait_any() and atf_utils_wait_all().
+ *
+ * The descriptors above stderr inherited by the child are marked as
+ * close-on-exec so that any program it executes does not keep the pipes or
+ * sockets of the test case open.  The child itself can still use them.
  *
  * \return 0 in the new child; the PID of the new child in the parent.  Does
  * not return in error conditions. */
@@ -232,9 +772,28 @@ atf_utils_fork(void)
         atf_tc_fail("fork failed");
 
     if (pid == 0) {
-        atf_utils_redirect(STDOUT_FILENO, "atf_utils_fork_out.txt");
-        atf_utils_redirect(STDERR_FILENO, "atf_utils_fork_err.txt");
-    }
+        atf_error_t err;
+        char name[64];
+
+        /* The subprocesses of the parent are not ours to wait for. */
+        forked_pids_count = 0;
+
+        fork_out_name(name, sizeof(name), getpid(), "out");
+        atf_utils_redirect(STDOUT_FILENO, name);
+        fork_out_name(name, sizeof(name), getpid(), "err");
+        atf_utils_redirect(STDERR_FILENO, name);
+
+        err = atf_process_cloexec_fds(NULL, 0);
+        if (atf_is_error(err)) {
+            char buf[1024];
+
+            atf_error_format(err, buf, sizeof(buf));
+            atf_error_free(err);
+            atf_tc_fail("Failed to set up the descriptors of the child: %s",
+                        buf);
+        }
+    } else
+        add_forked_pid(pid);
     return pid;
 }
 
@@ -267,21 +826,36 @@ atf_utils_grep_file(const char *regex, const char *file, ...)
     va_list ap;
     atf_dynstr_t formatted;
     atf_error_t error;
+    regex_t preg;
 
     va_start(ap, file);
     error = atf_dynstr_init_ap(&formatted, regex, ap);
     va_end(ap);
     ATF_REQUIRE(!atf_is_error(error));
 
+    printf("Looking for '%s' in '%s'\n", atf_dynstr_cstring(&formatted),
+           file);
+    ATF_REQUIRE(regcomp(&preg, atf_dynstr_cstring(&formatted),
+                        REG_EXTENDED) == 0);
+
     ATF_REQUIRE((fd = open(file, O_RDONLY)) != -1);
+    atf_line_reader_t reader;
+    error = atf_line_reader_init(&reader, fd);
+    ATF_REQUIRE(!atf_is_error(error));
     bool found = false;
     char *line = NULL;
-    while (!found && (line = atf_utils_readline(fd)) != NULL) {
-        found = grep_string(atf_dynstr_cstring(&formatted), line);
+    while (!found) {
+        error = atf_line_reader_next(&reader, &line);
+        ATF_REQUIRE(!atf_is_error(error));
+        if (line == NULL)
+            break;
+        found = grep_compiled(&preg, line);
         free(line);
     }
+    atf_line_reader_fini(&reader);
     close(fd);
 
+    regfree(&preg);
     atf_dynstr_fini(&formatted);
 
     return found;
@@ -314,30 +888,76 @@ atf_utils_grep_string(const char *regex, const char *str, ...)
     return res;
 }
 
-/** Reads a line of arbitrary length.
+/** Searches for a regexp in a set of strings.
+ *
+ * The expression is compiled only once, so this is cheaper than calling
+ * atf_utils_grep_string for every string.
+ *
+ * \param regex The regexp to look for.
+ * \param strs The NULL-terminated array of strings in which to look for the
+ *     expression.
+ *
+ * \return True if there is a match in any string; false otherwise. */
+bool
+atf_utils_grep_strings(const char *regex, const char *const *strs)
+{
+    regex_t preg;
+    bool found = false;
+
+    ATF_REQUIRE(regcomp(&preg, regex, REG_EXTENDED) == 0);
+    for (; !found && *strs != NULL; strs++) {
+        printf("Looking for '%s' in '%s'\n", regex, *strs);
+        found = grep_compiled(&preg, *strs);
+    }
+    regfree(&preg);
+
+    return found;
+}
+
+/** Reads a line from a descriptor that cannot be repositioned.
+ *
+ * The descriptor is read one byte at a time so that nothing past the line
+ * is consumed.
  *
  * \param fd The descriptor from which to read the line.
  *
  * \return A pointer to the read line, which must be released with free(), or
  * NULL if there was nothing to read from the file. */
+static
 char *
-atf_utils_readline(const int fd)
+readline_unbuffered(const int fd)
 {
-    char ch;
+    char buffer[256];
+    size_t length = 0;
     ssize_t cnt;
+    char ch;
     atf_dynstr_t temp;
     atf_error_t error;
 
     error = atf_dynstr_init(&temp);
     ATF_REQUIRE(!atf_is_error(error));
 
-    while ((cnt = read(fd, &ch, sizeof(ch))) == sizeof(ch) &&
-           ch != '\n') {
-        error = atf_dynstr_append_fmt(&temp, "%c", ch);
-        ATF_REQUIRE(!atf_is_error(error));
+    while ((cnt = read(fd, &ch, sizeof(ch))) == sizeof(ch) ||
+           (cnt == -1 && errno == EINTR)) {
+        if (cnt == -1)
+            continue;
+        if (ch == '\n')
+            break;
+
+        buffer[length++] = ch;
+        if (length == sizeof(buffer)) {
+            error = atf_dynstr_append_fmt(&temp, "%.*s", (int)length, buffer);
+            ATF_REQUIRE(!atf_is_error(error));
+            length = 0;
+        }
     }
     ATF_REQUIRE(cnt != -1);
 
+    if (length > 0) {
+        error = atf_dynstr_append_fmt(&temp, "%.*s", (int)length, buffer);
+        ATF_REQUIRE(!atf_is_error(error));
+    }
+
     if (cnt == 0 && atf_dynstr_length(&temp) == 0) {
         atf_dynstr_fini(&temp);
         return NULL;
@@ -345,6 +965,173 @@ atf_utils_readline(const int fd)
         return atf_dynstr_fini_disown(&temp);
 }
 
+/** Takes the reader holding the data read ahead from a regular file.
+ *
+ * The data is discarded if the descriptor no longer refers to the same
+ * file, or to the same position in it, as when the previous line was
+ * returned; e.g. because the descriptor was closed and reused or was read
+ * by other means.
+ *
+ * \param fd The descriptor being read.
+ * \param sb The status of the file open in the descriptor.
+ * \param offset The current position of the descriptor.
+ *
+ * \return The reader, which the caller owns, or NULL if there is none. */
+static
+struct pending_reader *
+take_pending_reader(const int fd, const struct stat *sb, const off_t offset)
+{
+    struct pending_reader *pr;
+
+    if (fd >= pending_readers_size || pending_readers[fd] == NULL)
+        return NULL;
+
+    pr = pending_readers[fd];
+    pending_readers[fd] = NULL;
+
+    if (pr->m_dev != sb->st_dev || pr->m_ino != sb->st_ino ||
+        pr->m_offset != offset) {
+        atf_line_reader_fini(&pr->m_reader);
+        free(pr);
+        pr = NULL;
+    }
+
+    return pr;
+}
+
+/** Keeps a reader for the next call on the same descriptor if it holds
+ * data not returned yet, or releases it otherwise.
+ *
+ * \param fd The descriptor being read.
+ * \param pr The reader, whose ownership is transferred. */
+static
+void
+keep_pending_reader(const int fd, struct pending_reader *pr)
+{
+    if (atf_line_reader_pending(&pr->m_reader) == 0) {
+        atf_line_reader_fini(&pr->m_reader);
+        free(pr);
+        return;
+    }
+
+    if (fd >= pending_readers_size) {
+        int newsize = pending_readers_size == 0 ? 16 : pending_readers_size;
+        struct pending_reader **newreaders;
+        int i;
+
+        while (fd >= newsize)
+            newsize *= 2;
+        newreaders = realloc(pending_readers, sizeof(*newreaders) * newsize);
+        ATF_REQUIRE(newreaders != NULL);
+        for (i = pending_readers_size; i < newsize; i++)
+            newreaders[i] = NULL;
+        pending_readers = newreaders;
+        pending_readers_size = newsize;
+    }
+
+    pending_readers[fd] = pr;
+}
+
+/** Reads a line of arbitrary length.
+ *
+ * Regular files are read in large chunks.  The data read past the returned
+ * line is kept for the next call on the same descriptor, but the
+ * descriptor is moved back to the end of the line, so it can be read by
+ * other means afterwards; the kept data is discarded if that happens.
+ * Other descriptors cannot be moved back and are read one byte at a time
+ * so that nothing past the line is consumed; atf_utils_reader_readline
+ * reads them in large chunks instead.
+ *
+ * \param fd The descriptor from which to read the line.
+ *
+ * \return A pointer to the read line, which must be released with free(), or
+ * NULL if there was nothing to read from the file. */
+char *
+atf_utils_readline(const int fd)
+{
+    struct stat sb;
+    struct pending_reader *pr;
+    atf_error_t error;
+    off_t offset;
+    char *line;
+
+    if (fstat(fd, &sb) == -1 || !S_ISREG(sb.st_mode) ||
+        (offset = lseek(fd, 0, SEEK_CUR)) == -1)
+        return readline_unbuffered(fd);
+
+    pr = take_pending_reader(fd, &sb, offset);
+    if (pr == NULL) {
+        pr = malloc(sizeof(*pr));
+        ATF_REQUIRE(pr != NULL);
+        error = atf_line_reader_init(&pr->m_reader, fd);
+        ATF_REQUIRE(!atf_is_error(error));
+        pr->m_dev = sb.st_dev;
+        pr->m_ino = sb.st_ino;
+    } else {
+        /* Let the reader continue after the data it already holds. */
+        offset += atf_line_reader_pending(&pr->m_reader);
+        ATF_REQUIRE(lseek(fd, offset, SEEK_SET) != -1);
+    }
+
+    error = atf_line_reader_next(&pr->m_reader, &line);
+    ATF_REQUIRE(!atf_is_error(error));
+
+    /* Give back the data read past the line. */
+    pr->m_offset = lseek(fd, -(off_t)atf_line_reader_pending(&pr->m_reader),
+                         SEEK_CUR);
+    ATF_REQUIRE(pr->m_offset != -1);
+
+    keep_pending_reader(fd, pr);
+    return line;
+}
+
+/** Initializes a reader that returns the lines of a descriptor.
+ *
+ * Unlike atf_utils_readline, the reader reads any kind of descriptor in
+ * large chunks and keeps the data read past the returned lines to itself,
+ * so the descriptor must not be read by other means while in use.
+ *
+ * \param reader The reader to initialize.
+ * \param fd The descriptor from which to read the lines. */
+void
+atf_utils_reader_init(atf_utils_reader_t *reader, const int fd)
+{
+    atf_error_t error;
+
+    reader->pimpl = malloc(sizeof(struct atf_utils_reader_impl));
+    ATF_REQUIRE(reader->pimpl != NULL);
+
+    error = atf_line_reader_init(&reader->pimpl->m_reader, fd);
+    ATF_REQUIRE(!atf_is_error(error));
+}
+
+/** Releases a reader, along with any data it read but did not return.
+ *
+ * \param reader The reader to release.  Its descriptor is not closed. */
+void
+atf_utils_reader_fini(atf_utils_reader_t *reader)
+{
+    atf_line_reader_fini(&reader->pimpl->m_reader);
+    free(reader->pimpl);
+}
+
+/** Reads the next line from a reader.
+ *
+ * \param reader The reader from which to get the line.
+ *
+ * \return A pointer to the read line, which must be released with free(), or
+ * NULL if there was nothing left to read. */
+char *
+atf_utils_reader_readline(atf_utils_reader_t *reader)
+{
+    atf_error_t error;
+    char *line;
+
+    error = atf_line_reader_next(&reader->pimpl->m_reader, &line);
+    ATF_REQUIRE(!atf_is_error(error));
+    return line;
+}
+
 /** Redirects a file descriptor to a file.
  *
  * \param target_fd The file descriptor to be replaced.
@@ -371,6 +1158,87 @@ atf_utils_redirect(const int target_fd, const char *name)
     close(new_fd);
 }
 
+/** Removes a file or a directory and everything below it.
+ *
+ * The tree is walked without spawning any process, and directories whose
+ * permissions prevent removing their contents are made accessible first.
+ * Fails the test case if anything cannot be removed.
+ *
+ * \param path Path to the tree to remove. */
+void
+atf_utils_remove_tree(const char *path)
+{
+    atf_fs_path_t p;
+    atf_error_t err;
+
+    err = atf_fs_path_init_fmt(&p, "%s", path);
+    if (!atf_is_error(err)) {
+        err = atf_fs_rmtree(&p);
+        atf_fs_path_fini(&p);
+    }
+
+    if (atf_is_error(err)) {
+        char buf[1024];
+
+        atf_error_format(err, buf, sizeof(buf));
+        atf_error_free(err);
+        atf_tc_fail("Failed to remove %s: %s", path, buf);
+    }
+}
+
+/** Validates one of the output streams of a subprocess.
+ *
+ * \param name The file capturing the stream, which is deleted afterwards.
+ * \param expected Expected contents of the stream. */
+static
+void
+check_fork_out(const char *name, const char *expected)
+{
+    const char *save_prefix = "save:";
+    const size_t save_prefix_length = strlen(save_prefix);
+    const char *digest_prefix = "digest:";
+    const size_t digest_prefix_length = strlen(digest_prefix);
+
+    if (strlen(expected) > save_prefix_length &&
+        strncmp(expected, save_prefix, save_prefix_length) == 0) {
+        atf_utils_copy_file(name, expected + save_prefix_length);
+    } else if (strncmp(expected, digest_prefix, digest_prefix_length) == 0) {
+        ATF_REQUIRE(atf_utils_compare_file_digest(
+            name, expected + digest_prefix_length));
+    } else {
+        ATF_REQUIRE(atf_utils_compare_file(name, expected));
+    }
+
+    ATF_REQUIRE(unlink(name) != -1);
+}
+
+/** Validates the exit condition of a subprocess that has been waited for.
+ *
+ * \param pid The process that terminated.
+ * \param status The status of the process as returned by waitpid().
+ * \param exitstatus Expected exit status.
+ * \param expout Expected contents of stdout.
+ * \param experr Expected contents of stderr. */
+static
+void
+check_fork_status(const pid_t pid, const int status, const int exitstatus,
+                  const char *expout, const char *experr)
+{
+    char outname[64], errname[64];
+
+    fork_out_name(outname, sizeof(outname), pid, "out");
+    fork_out_name(errname, sizeof(errname), pid, "err");
+
+    atf_utils_cat_file(outname, "subprocess stdout: ");
+    atf_utils_cat_file(errname, "subprocess stderr: ");
+
+    ATF_REQUIRE(WIFEXITED(status));
+    ATF_REQUIRE_EQ(exitstatus, WEXITSTATUS(status));
+
+    check_fork_out(outname, expout);
+    check_fork_out(errname, experr);
+}
+
 /** Waits for a subprocess and validates its exit condition.
  *
  * \param pid The process to be waited for.  Must have been started by
@@ -384,32 +1252,70 @@ atf_utils_wait(const pid_t pid, const int exitstatus, const char *expout,
 {
     int status;
     ATF_REQUIRE(waitpid(pid, &status, 0) != -1);
+    remove_forked_pid(pid);
 
-    atf_utils_cat_file("atf_utils_fork_out.txt", "subprocess stdout: ");
-    atf_utils_cat_file("atf_utils_fork_err.txt", "subprocess stderr: ");
+    check_fork_status(pid, status, exitstatus, expout, experr);
+}
 
-    ATF_REQUIRE(WIFEXITED(status));
-    ATF_REQUIRE_EQ(exitstatus, WEXITSTATUS(status));
+/** Waits for any of the subprocesses spawned by atf_utils_fork() and
+ * validates its exit condition.
+ *
+ * Other subprocesses of the caller are never waited for.  The caller
+ * sleeps until a SIGCHLD arrives and then only polls the subprocesses it
+ * tracks; its own SIGCHLD disposition and signal mask are restored before
+ * returning.
+ *
+ * \param exitstatus Expected exit status.
+ * \param expout Expected contents of stdout.
+ * \param experr Expected contents of stderr.
+ *
+ * \return The PID of the subprocess that terminated. */
+pid_t
+atf_utils_wait_any(const int exitstatus, const char *expout,
+                   const char *experr)
+{
+    ATF_REQUIRE_MSG(forked_pids_count > 0, "No subprocesses to wait for");
 
-    const char *save_prefix = "save:";
-    const size_t save_prefix_length = strlen(save_prefix);
+    /* Keep SIGCHLD blocked between polling and sleeping so that a
+     * subprocess terminating in between wakes sigsuspend() up right away
+     * instead of being missed. */
+    sigset_t mask, oldmask, waitmask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    ATF_REQUIRE(sigprocmask(SIG_BLOCK, &mask, &oldmask) != -1);
 
-    if (strlen(expout) > save_prefix_length &&
-        strncmp(expout, save_prefix, save_prefix_length) == 0) {
-        atf_utils_copy_file("atf_utils_fork_out.txt",
-                            expout + save_prefix_length);
-    } else {
-        ATF_REQUIRE(atf_utils_compare_file("atf_utils_fork_out.txt", expout));
-    }
+    struct sigaction sa, oldsa;
+    sa.sa_handler = sigchld_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    ATF_REQUIRE(sigaction(SIGCHLD, &sa, &oldsa) != -1);
 
-    if (strlen(experr) > save_prefix_length &&
-        strncmp(experr, save_prefix, save_prefix_length) == 0) {
-        atf_utils_copy_file("atf_utils_fork_err.txt",
-                            experr + save_prefix_length);
-    } else {
-        ATF_REQUIRE(atf_utils_compare_file("atf_utils_fork_err.txt", experr));
-    }
+    waitmask = oldmask;
+    sigdelset(&waitmask, SIGCHLD);
 
-    ATF_REQUIRE(unlink("atf_utils_fork_out.txt") != -1);
-    ATF_REQUIRE(unlink("atf_utils_fork_err.txt") != -1);
+    pid_t pid;
+    int status;
+    while ((pid = poll_forked_pids(&status)) == 0)
+        (void)sigsuspend(&waitmask);
+
+    ATF_REQUIRE(sigaction(SIGCHLD, &oldsa, NULL) != -1);
+    ATF_REQUIRE(sigprocmask(SIG_SETMASK, &oldmask, NULL) != -1);
+
+    remove_forked_pid(pid);
+    check_fork_status(pid, status, exitstatus, expout, experr);
+    return pid;
+}
+
+/** Waits for all the subprocesses spawned by atf_utils_fork() and validates
+ * their exit conditions, in the order in which they terminate.
+ *
+ * \param exitstatus Expected exit status.
+ * \param expout Expected contents of stdout.
+ * \param experr Expected contents of stderr. */
+void
+atf_utils_wait_all(const int exitstatus, const char *expout,
+                   const char *experr)
+{
+    while (forked_pids_count > 0)
+        (void)atf_utils_wait_any(exitstatus, expout, experr);
 }
@@ -35,8 +35,16 @@
 
 #include <atf-c/defs.h>
 
+struct atf_utils_reader_impl;
+struct atf_utils_reader {
+    struct atf_utils_reader_impl *pimpl;
+};
+typedef struct atf_utils_reader atf_utils_reader_t;
+
 void atf_utils_cat_file(const char *, const char *);
+void atf_utils_clone_tree(const char *, const char *, const bool);
 bool atf_utils_compare_file(const char *, const char *);
+bool atf_utils_compare_file_digest(const char *, const char *);
 void atf_utils_copy_file(const char *, const char *);
 void atf_utils_create_file(const char *, const char *, ...)
     ATF_DEFS_ATTRIBUTE_FORMAT_PRINTF(2, 3);
@@ -47,8 +55,15 @@ bool atf_utils_grep_file(const char *, const char *, ...)
     ATF_DEFS_ATTRIBUTE_FORMAT_PRINTF(1, 3);
 bool atf_utils_grep_string(const char *, const char *, ...)
     ATF_DEFS_ATTRIBUTE_FORMAT_PRINTF(1, 3);
+bool atf_utils_grep_strings(const char *, const char *const *);
 char *atf_utils_readline(int);
+void atf_utils_reader_init(atf_utils_reader_t *, const int);
+void atf_utils_reader_fini(atf_utils_reader_t *);
+char *atf_utils_reader_readline(atf_utils_reader_t *);
 void atf_utils_redirect(const int, const char *);
+void atf_utils_remove_tree(const char *);
 void atf_utils_wait(const pid_t, const int, const char *, const char *);
+pid_t atf_utils_wait_any(const int, const char *, const char *);
+void atf_utils_wait_all(const int, const char *, const char *);
 
 #endif /* ATF_C_UTILS_H */
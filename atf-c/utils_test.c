@@ -30,7 +30,10 @@
 #include <sys/stat.h>
 #include <sys/wait.h>
 
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -123,6 +126,108 @@ ATF_TC_BODY(cat_file__no_newline_eof, tc)
     ATF_REQUIRE_STREQ("PREFIXFoo\nPREFIX bar baz", buffer);
 }
 
+ATF_TC_WITHOUT_HEAD(clone_tree);
+ATF_TC_BODY(clone_tree, tc)
+{
+    ATF_REQUIRE(mkdir("fixture", 0755) != -1);
+    ATF_REQUIRE(mkdir("fixture/sub", 0750) != -1);
+    atf_utils_create_file("fixture/rw.txt", "Writable\n");
+    atf_utils_create_file("fixture/ro.txt", "Read-only\n");
+    ATF_REQUIRE(chmod("fixture/ro.txt", 0444) != -1);
+    atf_utils_create_file("fixture/sub/file.txt", "Nested\n");
+    ATF_REQUIRE(symlink("../rw.txt", "fixture/sub/link") != -1);
+
+    atf_utils_clone_tree("fixture", "work", false);
+
+    ATF_REQUIRE(atf_utils_compare_file("work/rw.txt", "Writable\n"));
+    ATF_REQUIRE(atf_utils_compare_file("work/ro.txt", "Read-only\n"));
+    ATF_REQUIRE(atf_utils_compare_file("work/sub/file.txt", "Nested\n"));
+    ATF_REQUIRE(atf_utils_compare_file("work/sub/link", "Writable\n"));
+
+    struct stat sb;
+    ATF_REQUIRE(stat("work/sub", &sb) != -1);
+    ATF_REQUIRE_EQ(0750, sb.st_mode & 0777);
+    ATF_REQUIRE(stat("work/ro.txt", &sb) != -1);
+    ATF_REQUIRE_EQ(0444, sb.st_mode & 0777);
+    ATF_REQUIRE(lstat("work/sub/link", &sb) != -1);
+    ATF_REQUIRE(S_ISLNK(sb.st_mode));
+
+    /* Changes to the copy must not leak into the fixture. */
+    atf_utils_create_file("work/rw.txt", "Modified\n");
+    ATF_REQUIRE(atf_utils_compare_file("fixture/rw.txt", "Writable\n"));
+    ATF_REQUIRE(chmod("work/ro.txt", 0644) != -1);
+    ATF_REQUIRE(stat("fixture/ro.txt", &sb) != -1);
+    ATF_REQUIRE_EQ(0444, sb.st_mode & 0777);
+}
+
+ATF_TC_WITHOUT_HEAD(clone_tree__link_read_only);
+ATF_TC_BODY(clone_tree__link_read_only, tc)
+{
+    ATF_REQUIRE(mkdir("fixture", 0755) != -1);
+    atf_utils_create_file("fixture/rw.txt", "Writable\n");
+    atf_utils_create_file("fixture/ro.txt", "Read-only\n");
+    ATF_REQUIRE(chmod("fixture/ro.txt", 0444) != -1);
+
+    atf_utils_clone_tree("fixture", "work", true);
+
+    ATF_REQUIRE(atf_utils_compare_file("work/rw.txt", "Writable\n"));
+    ATF_REQUIRE(atf_utils_compare_file("work/ro.txt", "Read-only\n"));
+
+    struct stat sb1, sb2;
+    ATF_REQUIRE(stat("fixture/rw.txt", &sb1) != -1);
+    ATF_REQUIRE(stat("work/rw.txt", &sb2) != -1);
+    ATF_REQUIRE(sb1.st_ino != sb2.st_ino);
+    ATF_REQUIRE(stat("fixture/ro.txt", &sb1) != -1);
+    ATF_REQUIRE(stat("work/ro.txt", &sb2) != -1);
+    ATF_REQUIRE_EQ(sb1.st_ino, sb2.st_ino);
+}
+
+ATF_TC_WITHOUT_HEAD(clone_tree__long_link);
+ATF_TC_BODY(clone_tree__long_link, tc)
+{
+    char target[PATH_MAX];
+    memset(target, 'x', sizeof(target) - 1);
+    target[sizeof(target) - 1] = '\0';
+
+    ATF_REQUIRE(mkdir("fixture", 0755) != -1);
+    if (symlink(target, "fixture/link") == -1) {
+        ATF_REQUIRE_EQ(ENAMETOOLONG, errno);
+        target[sizeof(target) - 2] = '\0';
+        ATF_REQUIRE(symlink(target, "fixture/link") != -1);
+    }
+
+    atf_utils_clone_tree("fixture", "work", false);
+
+    char copy[PATH_MAX + 1];
+    const ssize_t length = readlink("work/link", copy, sizeof(copy));
+    ATF_REQUIRE(length != -1);
+    ATF_REQUIRE_EQ(strlen(target), (size_t)length);
+    ATF_REQUIRE(memcmp(target, copy, length) == 0);
+}
+
+ATF_TC_WITHOUT_HEAD(clone_tree__existing);
+ATF_TC_BODY(clone_tree__existing, tc)
+{
+    ATF_REQUIRE(mkdir("fixture", 0700) != -1);
+    atf_utils_create_file("fixture/file.txt", "Contents\n");
+    ATF_REQUIRE(symlink("file.txt", "fixture/link") != -1);
+
+    ATF_REQUIRE(mkdir("work", 0755) != -1);
+    atf_utils_create_file("work/other.txt", "Other\n");
+    atf_utils_create_file("work/file.txt", "Stale contents\n");
+    ATF_REQUIRE(symlink("other.txt", "work/link") != -1);
+
+    atf_utils_clone_tree("fixture", "work", false);
+
+    ATF_REQUIRE(atf_utils_compare_file("work/file.txt", "Contents\n"));
+    ATF_REQUIRE(atf_utils_compare_file("work/link", "Contents\n"));
+    ATF_REQUIRE(atf_utils_compare_file("work/other.txt", "Other\n"));
+
+    struct stat sb;
+    ATF_REQUIRE(stat("work", &sb) != -1);
+    ATF_REQUIRE_EQ(0755, sb.st_mode & 0777);
+}
+
 ATF_TC_WITHOUT_HEAD(compare_file__empty__match);
 ATF_TC_BODY(compare_file__empty__match, tc)
 {
@@ -187,6 +292,43 @@ ATF_TC_BODY(compare_file__long__not_match, tc)
     ATF_REQUIRE(!atf_utils_compare_file("test.txt", long_contents));
 }
 
+ATF_TC_WITHOUT_HEAD(compare_file__not_regular);
+ATF_TC_BODY(compare_file__not_regular, tc)
+{
+    ATF_REQUIRE( atf_utils_compare_file("/dev/null", ""));
+    ATF_REQUIRE(!atf_utils_compare_file("/dev/null", "foo"));
+}
+
+ATF_TC_WITHOUT_HEAD(compare_file_digest__match);
+ATF_TC_BODY(compare_file_digest__match, tc)
+{
+    char long_contents[3456];
+    size_t i = 0;
+    for (; i < sizeof(long_contents) - 1; i++)
+        long_contents[i] = '0' + (i % 10);
+    long_contents[i] = '\0';
+
+    atf_utils_create_file("test.txt", "%s", "");
+    ATF_REQUIRE(atf_utils_compare_file_digest("test.txt", "sha256:"
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+    atf_utils_create_file("test.txt", "this is a short file");
+    ATF_REQUIRE(atf_utils_compare_file_digest("test.txt", "sha256:"
+        "F77C69EAB04E986D3BB0C35DB8D4ACEFD2CB94F95784660795C72AAF2BDCDECD"));
+    atf_utils_create_file("test.txt", "%s", long_contents);
+    ATF_REQUIRE(atf_utils_compare_file_digest("test.txt", "sha256:"
+        "869ca5613cc5a59034dfd4ce6e309f95de1b340cbdac755e673e30005c75a3b0"));
+}
+
+ATF_TC_WITHOUT_HEAD(compare_file_digest__not_match);
+ATF_TC_BODY(compare_file_digest__not_match, tc)
+{
+    atf_utils_create_file("test.txt", "this is a short file ");
+    ATF_REQUIRE(!atf_utils_compare_file_digest("test.txt", "sha256:"
+        "f77c69eab04e986d3bb0c35db8d4acefd2cb94f95784660795c72aaf2bdcdecd"));
+    ATF_REQUIRE(!atf_utils_compare_file_digest("test.txt", "sha256:"
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+}
+
 ATF_TC_WITHOUT_HEAD(copy_file__empty);
 ATF_TC_BODY(copy_file__empty, tc)
 {
@@ -208,6 +350,29 @@ ATF_TC_BODY(copy_file__some_contents, tc)
     ATF_REQUIRE(atf_utils_compare_file("dest.txt", "This is a\ntest file\n"));
 }
 
+ATF_TC_WITHOUT_HEAD(copy_file__large);
+ATF_TC_BODY(copy_file__large, tc)
+{
+    const size_t length = 300000;
+    char *contents = malloc(length + 1);
+    ATF_REQUIRE(contents != NULL);
+    size_t i = 0;
+    for (; i < length; i++)
+        contents[i] = (i % 80) == 79 ? '\n' : 'a' + (i % 26);
+    contents[i] = '\0';
+
+    atf_utils_create_file("src.txt", "%s", contents);
+    ATF_REQUIRE(chmod("src.txt", 0640) != -1);
+    atf_utils_copy_file("src.txt", "dest.txt");
+    ATF_REQUIRE(atf_utils_compare_file("dest.txt", contents));
+
+    struct stat sb;
+    ATF_REQUIRE(stat("dest.txt", &sb) != -1);
+    ATF_REQUIRE_EQ(0640, sb.st_mode & 0777);
+
+    free(contents);
+}
+
 ATF_TC_WITHOUT_HEAD(create_file);
 ATF_TC_BODY(create_file, tc)
 {
@@ -246,13 +411,59 @@ ATF_TC_BODY(fork, tc)
     ATF_REQUIRE(WIFEXITED(status));
     ATF_REQUIRE_EQ(EXIT_SUCCESS, WEXITSTATUS(status));
 
+    char name[64];
     char buffer[1024];
-    read_file("atf_utils_fork_out.txt", buffer, sizeof(buffer));
+    snprintf(name, sizeof(name), "atf_utils_fork_%d_out.txt", (int)pid);
+    read_file(name, buffer, sizeof(buffer));
     ATF_REQUIRE_STREQ("Child stdout\n", buffer);
-    read_file("atf_utils_fork_err.txt", buffer, sizeof(buffer));
+    snprintf(name, sizeof(name), "atf_utils_fork_%d_err.txt", (int)pid);
+    read_file(name, buffer, sizeof(buffer));
     ATF_REQUIRE_STREQ("Child stderr\n", buffer);
 }
 
+ATF_TC_WITHOUT_HEAD(fork__concurrent);
+ATF_TC_BODY(fork__concurrent, tc)
+{
+    pid_t pids[8];
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        pids[i] = atf_utils_fork();
+        if (pids[i] == 0) {
+            fprintf(stdout, "Child %d stdout\n", i);
+            fprintf(stderr, "Child %d stderr\n", i);
+            exit(i);
+        }
+    }
+
+    for (i = 7; i >= 0; i--) {
+        char expout[64], experr[64];
+
+        snprintf(expout, sizeof(expout), "Child %d stdout\n", i);
+        snprintf(experr, sizeof(experr), "Child %d stderr\n", i);
+        atf_utils_wait(pids[i], i, expout, experr);
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(fork__cloexec);
+ATF_TC_BODY(fork__cloexec, tc)
+{
+    const int fd = open("/dev/null", O_RDONLY);
+    ATF_REQUIRE(fd != -1);
+    ATF_REQUIRE(!(fcntl(fd, F_GETFD) & FD_CLOEXEC));
+
+    pid_t pid = atf_utils_fork();
+    if (pid == 0) {
+        const int flags = fcntl(fd, F_GETFD);
+        exit(flags != -1 && (flags & FD_CLOEXEC) ? EXIT_SUCCESS :
+             EXIT_FAILURE);
+    }
+    atf_utils_wait(pid, EXIT_SUCCESS, "", "");
+
+    ATF_REQUIRE(!(fcntl(fd, F_GETFD) & FD_CLOEXEC));
+    close(fd);
+}
+
 ATF_TC_WITHOUT_HEAD(free_charpp__empty);
 ATF_TC_BODY(free_charpp__empty, tc)
 {
@@ -299,6 +510,26 @@ ATF_TC_BODY(grep_string, tc)
     ATF_CHECK(!atf_utils_grep_string("foo", str));
     ATF_CHECK(!atf_utils_grep_string("bar", str));
     ATF_CHECK(!atf_utils_grep_string("aaaaa", str));
+
+    /* Repeated and interleaved expressions must not reuse stale results. */
+    ATF_CHECK(atf_utils_grep_string("string", str));
+    ATF_CHECK(atf_utils_grep_string("string", "another string"));
+    ATF_CHECK(!atf_utils_grep_string("string", "foo"));
+    ATF_CHECK(atf_utils_grep_string("fo+", "foo"));
+    ATF_CHECK(!atf_utils_grep_string("string", "foo"));
+}
+
+ATF_TC_WITHOUT_HEAD(grep_strings);
+ATF_TC_BODY(grep_strings, tc)
+{
+    const char *none[] = { NULL };
+    const char *strs[] = { "first line", "second line", NULL };
+
+    ATF_CHECK(!atf_utils_grep_strings("line", none));
+    ATF_CHECK(atf_utils_grep_strings("^first", strs));
+    ATF_CHECK(atf_utils_grep_strings("^sec.*line$", strs));
+    ATF_CHECK(atf_utils_grep_strings("t l", strs));
+    ATF_CHECK(!atf_utils_grep_strings("third", strs));
 }
 
 ATF_TC_WITHOUT_HEAD(readline__none);
@@ -341,6 +572,206 @@ ATF_TC_BODY(readline__some, tc)
     close(fd);
 }
 
+ATF_TC_WITHOUT_HEAD(readline__interleaved);
+ATF_TC_BODY(readline__interleaved, tc)
+{
+    atf_utils_create_file("a.txt", "a1\na2\na3\n");
+    atf_utils_create_file("b.txt", "b1\nb2\n");
+
+    const int fda = open("a.txt", O_RDONLY);
+    ATF_REQUIRE(fda != -1);
+    const int fdb = open("b.txt", O_RDONLY);
+    ATF_REQUIRE(fdb != -1);
+
+    char *line;
+
+    line = atf_utils_readline(fda);
+    ATF_REQUIRE_STREQ("a1", line);
+    free(line);
+
+    line = atf_utils_readline(fdb);
+    ATF_REQUIRE_STREQ("b1", line);
+    free(line);
+
+    line = atf_utils_readline(fda);
+    ATF_REQUIRE_STREQ("a2", line);
+    free(line);
+
+    line = atf_utils_readline(fdb);
+    ATF_REQUIRE_STREQ("b2", line);
+    free(line);
+    ATF_REQUIRE(atf_utils_readline(fdb) == NULL);
+
+    line = atf_utils_readline(fda);
+    ATF_REQUIRE_STREQ("a3", line);
+    free(line);
+    ATF_REQUIRE(atf_utils_readline(fda) == NULL);
+
+    close(fdb);
+    close(fda);
+}
+
+ATF_TC_WITHOUT_HEAD(readline__reused_fd);
+ATF_TC_BODY(readline__reused_fd, tc)
+{
+    atf_utils_create_file("a.txt", "a1\na2\n");
+    atf_utils_create_file("b.txt", "b1\nb2\n");
+
+    char *line;
+
+    int fd = open("a.txt", O_RDONLY);
+    ATF_REQUIRE(fd != -1);
+    line = atf_utils_readline(fd);
+    ATF_REQUIRE_STREQ("a1", line);
+    free(line);
+    close(fd);
+
+    /* The data read ahead from a.txt must not leak into the new file. */
+    ATF_REQUIRE_EQ(open("b.txt", O_RDONLY), fd);
+    line = atf_utils_readline(fd);
+    ATF_REQUIRE_STREQ("b1", line);
+    free(line);
+
+    /* Nor must it be returned after repositioning the descriptor. */
+    ATF_REQUIRE(lseek(fd, 0, SEEK_SET) == 0);
+    line = atf_utils_readline(fd);
+    ATF_REQUIRE_STREQ("b1", line);
+    free(line);
+    close(fd);
+
+    /* Reopening the same file starts over too. */
+    ATF_REQUIRE_EQ(open("b.txt", O_RDONLY), fd);
+    line = atf_utils_readline(fd);
+    ATF_REQUIRE_STREQ("b1", line);
+    free(line);
+    line = atf_utils_readline(fd);
+    ATF_REQUIRE_STREQ("b2", line);
+    free(line);
+    close(fd);
+}
+
+ATF_TC_WITHOUT_HEAD(readline__mixed_file);
+ATF_TC_BODY(readline__mixed_file, tc)
+{
+    atf_utils_create_file("test.txt", "Header\nRest of\nthe file\n");
+
+    const int fd = open("test.txt", O_RDONLY);
+    ATF_REQUIRE(fd != -1);
+
+    char *line = atf_utils_readline(fd);
+    ATF_REQUIRE_STREQ("Header", line);
+    free(line);
+
+    char buffer[1024];
+    const ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+    ATF_REQUIRE(length != -1);
+    buffer[length] = '\0';
+    ATF_REQUIRE_STREQ("Rest of\nthe file\n", buffer);
+
+    close(fd);
+}
+
+ATF_TC_WITHOUT_HEAD(readline__mixed_file_many);
+ATF_TC_BODY(readline__mixed_file_many, tc)
+{
+    const int fd = open("test.txt", O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ATF_REQUIRE(fd != -1);
+    FILE *f = fdopen(dup(fd), "w");
+    ATF_REQUIRE(f != NULL);
+    for (int i = 0; i < 10000; i++)
+        fprintf(f, "Line %d\n", i);
+    fclose(f);
+    ATF_REQUIRE(lseek(fd, 0, SEEK_SET) == 0);
+
+    /* Direct reads and repositioning in between lines must see the data
+     * that follows the last returned line. */
+    for (int i = 0; i < 10000; i++) {
+        char exp[32], *line;
+
+        snprintf(exp, sizeof(exp), "Line %d", i);
+        line = atf_utils_readline(fd);
+        ATF_REQUIRE_STREQ(exp, line);
+        free(line);
+
+        if (i % 1000 == 999 && i < 9999) {
+            char buffer[32];
+            const off_t pos = lseek(fd, 0, SEEK_CUR);
+
+            snprintf(exp, sizeof(exp), "Line %d\n", i + 1);
+            ATF_REQUIRE_EQ(read(fd, buffer, strlen(exp)),
+                           (ssize_t)strlen(exp));
+            ATF_REQUIRE(memcmp(buffer, exp, strlen(exp)) == 0);
+            ATF_REQUIRE(lseek(fd, pos, SEEK_SET) == pos);
+        }
+    }
+    ATF_REQUIRE(atf_utils_readline(fd) == NULL);
+
+    close(fd);
+}
+
+ATF_TC_WITHOUT_HEAD(readline__mixed_pipe);
+ATF_TC_BODY(readline__mixed_pipe, tc)
+{
+    int fds[2];
+    ATF_REQUIRE(pipe(fds) != -1);
+
+    const char *data = "Header\nRest of\nthe input\n";
+    ATF_REQUIRE(write(fds[1], data, strlen(data)) == (ssize_t)strlen(data));
+    close(fds[1]);
+
+    char *line = atf_utils_readline(fds[0]);
+    ATF_REQUIRE_STREQ("Header", line);
+    free(line);
+
+    char buffer[1024];
+    const ssize_t length = read(fds[0], buffer, sizeof(buffer) - 1);
+    ATF_REQUIRE(length != -1);
+    buffer[length] = '\0';
+    ATF_REQUIRE_STREQ("Rest of\nthe input\n", buffer);
+
+    close(fds[0]);
+}
+
+ATF_TC_WITHOUT_HEAD(reader__pipe);
+ATF_TC_BODY(reader__pipe, tc)
+{
+    int fds[2];
+    ATF_REQUIRE(pipe(fds) != -1);
+
+    const pid_t pid = atf_utils_fork();
+    if (pid == 0) {
+        close(fds[0]);
+        FILE *f = fdopen(fds[1], "w");
+        if (f == NULL)
+            exit(EXIT_FAILURE);
+        for (int i = 0; i < 10000; i++)
+            fprintf(f, "Line %d\n", i);
+        fprintf(f, "Unterminated");
+        fclose(f);
+        exit(EXIT_SUCCESS);
+    }
+    close(fds[1]);
+
+    atf_utils_reader_t reader;
+    atf_utils_reader_init(&reader, fds[0]);
+    for (int i = 0; i < 10000; i++) {
+        char exp[32];
+        snprintf(exp, sizeof(exp), "Line %d", i);
+
+        char *line = atf_utils_reader_readline(&reader);
+        ATF_REQUIRE_STREQ(exp, line);
+        free(line);
+    }
+    char *line = atf_utils_reader_readline(&reader);
+    ATF_REQUIRE_STREQ("Unterminated", line);
+    free(line);
+    ATF_REQUIRE(atf_utils_reader_readline(&reader) == NULL);
+    atf_utils_reader_fini(&reader);
+    close(fds[0]);
+
+    atf_utils_wait(pid, EXIT_SUCCESS, "", "");
+}
+
 ATF_TC_WITHOUT_HEAD(redirect__stdout);
 ATF_TC_BODY(redirect__stdout, tc)
 {
@@ -380,6 +811,35 @@ ATF_TC_BODY(redirect__other, tc)
     ATF_REQUIRE_STREQ(message, buffer);
 }
 
+ATF_TC_WITHOUT_HEAD(remove_tree);
+ATF_TC_BODY(remove_tree, tc)
+{
+    ATF_REQUIRE(mkdir("work", 0755) != -1);
+    ATF_REQUIRE(mkdir("work/sub", 0755) != -1);
+    atf_utils_create_file("work/file.txt", "Contents\n");
+    atf_utils_create_file("work/sub/file.txt", "Nested\n");
+    ATF_REQUIRE(chmod("work/sub", 0500) != -1);
+
+    atf_utils_remove_tree("work");
+    ATF_REQUIRE(!atf_utils_file_exists("work"));
+}
+
+ATF_TC_WITHOUT_HEAD(remove_tree__missing);
+ATF_TC_BODY(remove_tree__missing, tc)
+{
+    const pid_t pid = fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        atf_utils_remove_tree("missing");
+        exit(EXIT_SUCCESS);
+    }
+
+    int status;
+    ATF_REQUIRE(waitpid(pid, &status, 0) != -1);
+    ATF_REQUIRE(WIFEXITED(status));
+    ATF_REQUIRE_EQ(EXIT_FAILURE, WEXITSTATUS(status));
+}
+
 static void
 fork_and_wait(const int exitstatus, const char* expout, const char* experr)
 {
@@ -393,6 +853,131 @@ fork_and_wait(const int exitstatus, const char* expout, const char* experr)
     exit(EXIT_SUCCESS);
 }
 
+ATF_TC_WITHOUT_HEAD(wait_any);
+ATF_TC_BODY(wait_any, tc)
+{
+    pid_t pids[4];
+    int i, j;
+
+    /* A subprocess not spawned by atf_utils_fork must be left alone. */
+    const pid_t other = fork();
+    ATF_REQUIRE(other != -1);
+    if (other == 0)
+        exit(EXIT_FAILURE);
+
+    for (i = 0; i < 4; i++) {
+        pids[i] = atf_utils_fork();
+        if (pids[i] == 0) {
+            usleep(50000 * (4 - i));
+            fprintf(stdout, "Some output\n");
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    for (i = 0; i < 4; i++) {
+        const pid_t pid = atf_utils_wait_any(EXIT_SUCCESS, "Some output\n",
+                                             "");
+        for (j = 0; j < 4; j++) {
+            if (pids[j] == pid)
+                break;
+        }
+        ATF_REQUIRE(j < 4);
+        pids[j] = -1;
+    }
+
+    int status;
+    ATF_REQUIRE(waitpid(other, &status, 0) == other);
+    ATF_REQUIRE(WIFEXITED(status));
+    ATF_REQUIRE_EQ(EXIT_FAILURE, WEXITSTATUS(status));
+}
+
+static void
+wait_any_sigchld_handler(const int signo ATF_DEFS_ATTRIBUTE_UNUSED)
+{
+}
+
+ATF_TC_WITHOUT_HEAD(wait_any__signals);
+ATF_TC_BODY(wait_any__signals, tc)
+{
+    struct sigaction sa, oldsa;
+    sa.sa_handler = wait_any_sigchld_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    ATF_REQUIRE(sigaction(SIGCHLD, &sa, NULL) != -1);
+
+    sigset_t mask, oldmask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+    ATF_REQUIRE(sigprocmask(SIG_BLOCK, &mask, NULL) != -1);
+
+    /* A zombie not spawned by atf_utils_fork must not keep the caller
+     * from sleeping until its own subprocess terminates. */
+    const pid_t other = fork();
+    ATF_REQUIRE(other != -1);
+    if (other == 0)
+        exit(EXIT_FAILURE);
+
+    const pid_t pid = atf_utils_fork();
+    if (pid == 0) {
+        usleep(200000);
+        exit(EXIT_SUCCESS);
+    }
+    ATF_REQUIRE_EQ(pid, atf_utils_wait_any(EXIT_SUCCESS, "", ""));
+
+    ATF_REQUIRE(sigaction(SIGCHLD, NULL, &oldsa) != -1);
+    ATF_REQUIRE(oldsa.sa_handler == wait_any_sigchld_handler);
+    ATF_REQUIRE(sigprocmask(SIG_BLOCK, NULL, &oldmask) != -1);
+    ATF_REQUIRE(sigismember(&oldmask, SIGUSR1));
+    ATF_REQUIRE(!sigismember(&oldmask, SIGCHLD));
+
+    int status;
+    ATF_REQUIRE(waitpid(other, &status, 0) == other);
+}
+
+ATF_TC_WITHOUT_HEAD(wait_all);
+ATF_TC_BODY(wait_all, tc)
+{
+    int i;
+
+    for (i = 0; i < 32; i++) {
+        const pid_t pid = atf_utils_fork();
+        if (pid == 0) {
+            fprintf(stdout, "Some output\n");
+            fprintf(stderr, "Some error\n");
+            exit(123);
+        }
+    }
+
+    atf_utils_wait_all(123, "Some output\n", "Some error\n");
+    ATF_REQUIRE(waitpid(-1, NULL, WNOHANG) == -1);
+    ATF_REQUIRE_EQ(ECHILD, errno);
+}
+
+ATF_TC_WITHOUT_HEAD(wait_all__invalid_stdout);
+ATF_TC_BODY(wait_all__invalid_stdout, tc)
+{
+    const pid_t control = fork();
+    ATF_REQUIRE(control != -1);
+    if (control == 0) {
+        int i;
+
+        for (i = 0; i < 4; i++) {
+            const pid_t pid = atf_utils_fork();
+            if (pid == 0) {
+                fprintf(stdout, "%s\n", i == 2 ? "Bad output" : "Output");
+                exit(EXIT_SUCCESS);
+            }
+        }
+        atf_utils_wait_all(EXIT_SUCCESS, "Output\n", "");
+        exit(EXIT_SUCCESS);
+    } else {
+        int status;
+        ATF_REQUIRE(waitpid(control, &status, 0) != -1);
+        ATF_REQUIRE(WIFEXITED(status));
+        ATF_REQUIRE_EQ(EXIT_FAILURE, WEXITSTATUS(status));
+    }
+}
+
 ATF_TC_WITHOUT_HEAD(wait__ok);
 ATF_TC_BODY(wait__ok, tc)
 {
@@ -487,6 +1072,41 @@ ATF_TC_BODY(wait__save_stderr, tc)
     }
 }
 
+ATF_TC_WITHOUT_HEAD(wait__digest);
+ATF_TC_BODY(wait__digest, tc)
+{
+    const pid_t control = fork();
+    ATF_REQUIRE(control != -1);
+    if (control == 0)
+        fork_and_wait(123, "digest:sha256:"
+                      "cf49e86df5074a7b1ffd4b822a1a7184f93863d34d541fea384eff26ae04bc59",
+                      "digest:sha256:"
+                      "413c15f11cf5e72827dc4b5515c6a7b9793a9a96c93e3b2271b79b20ec9a92e9");
+    else {
+        int status;
+        ATF_REQUIRE(waitpid(control, &status, 0) != -1);
+        ATF_REQUIRE(WIFEXITED(status));
+        ATF_REQUIRE_EQ(EXIT_SUCCESS, WEXITSTATUS(status));
+    }
+}
+
+ATF_TC_WITHOUT_HEAD(wait__invalid_digest);
+ATF_TC_BODY(wait__invalid_digest, tc)
+{
+    const pid_t control = fork();
+    ATF_REQUIRE(control != -1);
+    if (control == 0)
+        fork_and_wait(123, "digest:sha256:"
+                      "413c15f11cf5e72827dc4b5515c6a7b9793a9a96c93e3b2271b79b20ec9a92e9",
+                      "Some error\n");
+    else {
+        int status;
+        ATF_REQUIRE(waitpid(control, &status, 0) != -1);
+        ATF_REQUIRE(WIFEXITED(status));
+        ATF_REQUIRE_EQ(EXIT_FAILURE, WEXITSTATUS(status));
+    }
+}
+
 HEADER_TC(include, "atf-c/utils.h");
 
 ATF_TP_ADD_TCS(tp)
@@ -496,41 +1116,70 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, cat_file__several_lines);
     ATF_TP_ADD_TC(tp, cat_file__no_newline_eof);
 
+    ATF_TP_ADD_TC(tp, clone_tree);
+    ATF_TP_ADD_TC(tp, clone_tree__existing);
+    ATF_TP_ADD_TC(tp, clone_tree__link_read_only);
+    ATF_TP_ADD_TC(tp, clone_tree__long_link);
+
     ATF_TP_ADD_TC(tp, compare_file__empty__match);
     ATF_TP_ADD_TC(tp, compare_file__empty__not_match);
     ATF_TP_ADD_TC(tp, compare_file__short__match);
     ATF_TP_ADD_TC(tp, compare_file__short__not_match);
     ATF_TP_ADD_TC(tp, compare_file__long__match);
     ATF_TP_ADD_TC(tp, compare_file__long__not_match);
+    ATF_TP_ADD_TC(tp, compare_file__not_regular);
+
+    ATF_TP_ADD_TC(tp, compare_file_digest__match);
+    ATF_TP_ADD_TC(tp, compare_file_digest__not_match);
 
     ATF_TP_ADD_TC(tp, copy_file__empty);
     ATF_TP_ADD_TC(tp, copy_file__some_contents);
+    ATF_TP_ADD_TC(tp, copy_file__large);
 
     ATF_TP_ADD_TC(tp, create_file);
 
     ATF_TP_ADD_TC(tp, file_exists);
 
     ATF_TP_ADD_TC(tp, fork);
+    ATF_TP_ADD_TC(tp, fork__cloexec);
+    ATF_TP_ADD_TC(tp, fork__concurrent);
 
     ATF_TP_ADD_TC(tp, free_charpp__empty);
     ATF_TP_ADD_TC(tp, free_charpp__some);
 
     ATF_TP_ADD_TC(tp, grep_file);
     ATF_TP_ADD_TC(tp, grep_string);
+    ATF_TP_ADD_TC(tp, grep_strings);
 
     ATF_TP_ADD_TC(tp, readline__none);
     ATF_TP_ADD_TC(tp, readline__some);
+    ATF_TP_ADD_TC(tp, readline__interleaved);
+    ATF_TP_ADD_TC(tp, readline__reused_fd);
+    ATF_TP_ADD_TC(tp, readline__mixed_file);
+    ATF_TP_ADD_TC(tp, readline__mixed_file_many);
+    ATF_TP_ADD_TC(tp, readline__mixed_pipe);
+
+    ATF_TP_ADD_TC(tp, reader__pipe);
 
     ATF_TP_ADD_TC(tp, redirect__stdout);
     ATF_TP_ADD_TC(tp, redirect__stderr);
     ATF_TP_ADD_TC(tp, redirect__other);
 
+    ATF_TP_ADD_TC(tp, remove_tree);
+    ATF_TP_ADD_TC(tp, remove_tree__missing);
+
     ATF_TP_ADD_TC(tp, wait__ok);
     ATF_TP_ADD_TC(tp, wait__save_stdout);
     ATF_TP_ADD_TC(tp, wait__save_stderr);
+    ATF_TP_ADD_TC(tp, wait__digest);
     ATF_TP_ADD_TC(tp, wait__invalid_exitstatus);
     ATF_TP_ADD_TC(tp, wait__invalid_stdout);
     ATF_TP_ADD_TC(tp, wait__invalid_stderr);
+    ATF_TP_ADD_TC(tp, wait__invalid_digest);
+    ATF_TP_ADD_TC(tp, wait_any);
+    ATF_TP_ADD_TC(tp, wait_any__signals);
+    ATF_TP_ADD_TC(tp, wait_all);
+    ATF_TP_ADD_TC(tp, wait_all__invalid_stdout);
 
     ATF_TP_ADD_TC(tp, include);
 
@@ -27,37 +27,59 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+#if defined(HAVE_CONFIG_H)
+#include "bconfig.h"
+#endif
+
 extern "C" {
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 
+#include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
 #include <signal.h>
+#include <stdint.h>
 #include <unistd.h>
 }
 
+#include <algorithm>
+#include <cctype>
 #include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <ios>
 #include <iostream>
-#include <iterator>
 #include <list>
 #include <memory>
+#include <sstream>
+#include <streambuf>
 #include <utility>
+#include <vector>
+
+extern "C" {
+#include "atf-c/detail/sha256.h"
+}
 
 #include "atf-c++/check.hpp"
 #include "atf-c++/config.hpp"
 
 #include "atf-c++/detail/application.hpp"
 #include "atf-c++/detail/auto_array.hpp"
+#include "atf-c++/detail/diff.hpp"
 #include "atf-c++/detail/exceptions.hpp"
 #include "atf-c++/detail/fs.hpp"
 #include "atf-c++/detail/process.hpp"
 #include "atf-c++/detail/sanity.hpp"
 #include "atf-c++/detail/text.hpp"
 
+extern "C" char** environ;
+
 // ------------------------------------------------------------------------
 // Auxiliary functions.
 // ------------------------------------------------------------------------
@@ -90,7 +112,9 @@ enum output_check_t {
     oc_file,
     oc_empty,
     oc_match,
-    oc_save
+    oc_save,
+    oc_digest,
+    oc_digestfile
 };
 
 struct output_check {
@@ -107,58 +131,217 @@ struct output_check {
     }
 };
 
-class temp_file : public std::ostream {
-    std::auto_ptr< atf::fs::path > m_path;
-    int m_fd;
+// A check run by a child process in batch mode.  The descriptors refer to
+// unlinked files that capture the output of the child, which is dumped once
+// the check is done so that the output of parallel checks is not mixed up.
+struct batch_check {
+    size_t index;
+    pid_t pid;
+    int stdout_fd;
+    int stderr_fd;
+
+    batch_check(const size_t p_index, const pid_t p_pid,
+                const int p_stdout_fd, const int p_stderr_fd) :
+        index(p_index),
+        pid(p_pid),
+        stdout_fd(p_stdout_fd),
+        stderr_fd(p_stderr_fd)
+    {
+    }
+};
 
-public:
-    temp_file(const atf::fs::path& p) :
-        std::ostream(NULL),
-        m_fd(-1)
+// The state of the shell that sends a check to atf-check in server mode,
+// which the check inherits instead of the state of atf-check itself.
+struct check_context {
+    std::string directory;
+    mode_t umask;
+    std::vector< std::string > environment;
+};
+
+// A stream buffer that reads the requests sent to atf-check in server mode.
+//
+// The requests come from a FIFO that the server keeps open for writing as
+// well, so that clients can open and close it for every request without
+// the server seeing the end of the input.  Instead, the input ends when the
+// process that started the server goes away, which is checked while waiting
+// for data in case the client could not shut the server down.
+class request_streambuf : public std::streambuf {
+    const int m_fd;
+    const pid_t m_parent;
+    char m_buf[4096];
+
+    request_streambuf(const request_streambuf&);
+    request_streambuf& operator=(const request_streambuf&);
+
+protected:
+    int_type
+    underflow(void)
     {
-        atf::auto_array< char > buf(new char[p.str().length() + 1]);
-        std::strcpy(buf.get(), p.c_str());
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        for (;;) {
+            const int ret = ::poll(&pfd, 1, 1000);
+            if (ret == -1 && errno != EINTR)
+                throw atf::system_error("request_streambuf::underflow",
+                                        "poll(2) failed", errno);
+            if (ret > 0)
+                break;
+            if (::getppid() != m_parent)
+                return traits_type::eof();
+        }
 
-        m_fd = ::mkstemp(buf.get());
-        if (m_fd == -1)
-            throw atf::system_error("atf_check::temp_file::temp_file(" +
-                                    p.str() + ")", "mkstemp(3) failed",
-                                    errno);
+        ssize_t n;
+        while ((n = ::read(m_fd, m_buf, sizeof(m_buf))) == -1 &&
+               errno == EINTR)
+            ;
+        if (n == -1)
+            throw atf::system_error("request_streambuf::underflow",
+                                    "read(2) failed", errno);
+        if (n == 0)
+            return traits_type::eof();
+
+        setg(m_buf, m_buf, m_buf + n);
+        return traits_type::to_int_type(m_buf[0]);
+    }
 
-        m_path.reset(new atf::fs::path(buf.get()));
+public:
+    explicit request_streambuf(const int fd) :
+        m_fd(fd),
+        m_parent(::getppid())
+    {
     }
+};
+
+// Size of the blocks used to process files that cannot be mapped.
+const size_t block_size = 64 * 1024;
+
+// Maximum number of hunks printed when an output does not match.
+const size_t max_diff_hunks = 10;
+
+class regex_set {
+    std::vector< atf::text::regex* > m_regexps;
+
+    regex_set(const regex_set&);
+    regex_set& operator=(const regex_set&);
 
-    ~temp_file(void)
+public:
+    regex_set(void)
     {
-        close();
-        try {
-            remove(*m_path);
-        } catch (const atf::system_error&) {
-            // Ignore deletion errors.
-        }
     }
 
-    const atf::fs::path&
-    get_path(void) const
+    ~regex_set(void)
     {
-        return *m_path;
+        for (std::vector< atf::text::regex* >::iterator iter =
+             m_regexps.begin(); iter != m_regexps.end(); iter++)
+            delete *iter;
     }
 
     void
-    write(const std::string& text)
+    add(const std::string& regexp)
     {
-        if (::write(m_fd, text.c_str(), text.size()) == -1)
-            throw atf::system_error("atf_check", "write(2) failed", errno);
+        std::auto_ptr< atf::text::regex > re(new atf::text::regex(regexp));
+        m_regexps.push_back(re.get());
+        re.release();
     }
 
-    void
-    close(void)
+    bool
+    matches(const std::size_t i, const std::string& str) const
+    {
+        return m_regexps[i]->matches(str);
+    }
+};
+
+class input_file {
+    const atf::fs::path m_path;
+    int m_fd;
+    off_t m_size;
+    void* m_map;
+
+    input_file(const input_file&);
+    input_file& operator=(const input_file&);
+
+public:
+    input_file(const atf::fs::path& p) :
+        m_path(p),
+        m_fd(-1),
+        m_size(-1),
+        m_map(MAP_FAILED)
     {
-        if (m_fd != -1) {
-            flush();
+        m_fd = ::open(p.c_str(), O_RDONLY);
+        if (m_fd == -1)
+            throw std::runtime_error("Failed to open " + p.str());
+
+        struct stat sb;
+        if (::fstat(m_fd, &sb) == -1) {
+            const int original_errno = errno;
             ::close(m_fd);
-            m_fd = -1;
+            throw atf::system_error("atf_check::input_file::input_file(" +
+                                    p.str() + ")", "fstat(2) failed",
+                                    original_errno);
+        }
+        if (S_ISREG(sb.st_mode))
+            m_size = sb.st_size;
+    }
+
+    ~input_file(void)
+    {
+        if (m_map != MAP_FAILED)
+            ::munmap(m_map, static_cast< size_t >(m_size));
+        ::close(m_fd);
+    }
+
+    int
+    fd(void) const
+    {
+        return m_fd;
+    }
+
+    // Returns the size of the file, or -1 if it is not a regular file and
+    // thus its size cannot be known in advance.
+    off_t
+    size(void) const
+    {
+        return m_size;
+    }
+
+    // Maps the whole file into memory.  Returns NULL if the file is empty
+    // or cannot be mapped, in which case the caller must use read().
+    const char*
+    map(void)
+    {
+        if (m_map == MAP_FAILED && m_size > 0 &&
+            static_cast< uintmax_t >(m_size) <= SIZE_MAX) {
+            m_map = ::mmap(NULL, static_cast< size_t >(m_size), PROT_READ,
+                           MAP_PRIVATE, m_fd, 0);
+#if defined(POSIX_MADV_SEQUENTIAL)
+            if (m_map != MAP_FAILED)
+                (void)::posix_madvise(m_map, static_cast< size_t >(m_size),
+                                      POSIX_MADV_SEQUENTIAL);
+#endif
+        }
+        return m_map == MAP_FAILED ? NULL : static_cast< const char* >(m_map);
+    }
+
+    // Reads up to 'length' bytes, retrying on short reads.  Returns fewer
+    // bytes than requested only at the end of the file.
+    size_t
+    read(char* buf, const size_t length)
+    {
+        size_t done = 0;
+        while (done < length) {
+            const ssize_t n = ::read(m_fd, buf + done, length - done);
+            if (n == -1) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Failed to read from " +
+                                         m_path.str());
+            } else if (n == 0)
+                break;
+            done += static_cast< size_t >(n);
         }
+        return done;
     }
 };
 
@@ -276,6 +459,29 @@ parse_status_check_arg(const std::string& arg)
     return status_check(type, negated, value);
 }
 
+// Parses the argument of a digest check, which has the form
+// algorithm:hexdigest, and returns the digest in lowercase.
+static
+std::string
+parse_digest(const std::string& str)
+{
+    const std::string::size_type delimiter = str.find(':');
+    if (delimiter == std::string::npos)
+        throw atf::application::usage_error("Invalid digest '%s'",
+                                            str.c_str());
+    if (str.substr(0, delimiter) != "sha256")
+        throw atf::application::usage_error(
+            "Unsupported digest algorithm '%s'",
+            str.substr(0, delimiter).c_str());
+
+    char hex[ATF_SHA256_HEX_LENGTH + 1];
+    if (!atf_sha256_parse_hex(str.c_str() + delimiter + 1,
+                              str.length() - delimiter - 1, hex))
+        throw atf::application::usage_error("Invalid digest '%s'",
+                                            str.c_str());
+    return hex;
+}
+
 static
 output_check
 parse_output_check_arg(const std::string& arg)
@@ -286,7 +492,13 @@ parse_output_check_arg(const std::string& arg)
     const std::string action = negated ? action_str.substr(4) : action_str;
 
     output_check_t type;
-    if (action == "empty")
+    std::string value = arg.substr(delimiter + 1);
+    if (action == "digest") {
+        type = oc_digest;
+        value = parse_digest(value);
+    } else if (action == "digestfile")
+        type = oc_digestfile;
+    else if (action == "empty")
         type = oc_empty;
     else if (action == "file")
         type = oc_file;
@@ -305,7 +517,98 @@ parse_output_check_arg(const std::string& arg)
     } else
         throw atf::application::usage_error("Invalid output checker");
 
-    return output_check(type, negated, arg.substr(delimiter + 1));
+    return output_check(type, negated, value);
+}
+
+// Parses a positive duration given as a number of seconds, which may have
+// a fractional part, optionally followed by an 's' or 'ms' unit.
+static
+::timeval
+parse_duration(const std::string& str)
+{
+    std::string::size_type end = str.length();
+    bool millis = false;
+    if (end > 2 && str.compare(end - 2, 2, "ms") == 0) {
+        end -= 2;
+        millis = true;
+    } else if (end > 1 && str[end - 1] == 's')
+        end--;
+
+    const std::string::size_type dot = std::min(str.find('.'), end);
+    const std::string intpart = str.substr(0, dot);
+    const std::string fracpart = dot < end ?
+        str.substr(dot + 1, end - dot - 1) : "";
+    if (intpart.empty() || intpart.length() > 9 ||
+        intpart.find_first_not_of("0123456789") != std::string::npos ||
+        fracpart.find_first_not_of("0123456789") != std::string::npos)
+        throw atf::application::usage_error("Invalid duration '%s'",
+                                            str.c_str());
+
+    // Microseconds represented by the fractional part; digits beyond the
+    // resolution of a timeval are ignored.
+    long frac = 0;
+    long scale = millis ? 100 : 100000;
+    for (std::string::size_type i = 0; i < fracpart.length() && scale > 0;
+         i++) {
+        frac += (fracpart[i] - '0') * scale;
+        scale /= 10;
+    }
+
+    const long value = std::atol(intpart.c_str());
+    ::timeval tv;
+    if (millis) {
+        tv.tv_sec = value / 1000;
+        tv.tv_usec = (value % 1000) * 1000 + frac;
+    } else {
+        tv.tv_sec = value;
+        tv.tv_usec = frac;
+    }
+    if (!timerisset(&tv))
+        throw atf::application::usage_error("Invalid duration '%s'",
+                                            str.c_str());
+    return tv;
+}
+
+// Parses a positive size in bytes, optionally followed by a 'k' or 'm'
+// multiplier.
+static
+std::size_t
+parse_size(const std::string& str)
+{
+    std::string digits = str;
+    std::size_t multiplier = 1;
+    if (!digits.empty()) {
+        const char unit = digits[digits.length() - 1];
+        if (unit == 'k' || unit == 'K')
+            multiplier = 1024;
+        else if (unit == 'm' || unit == 'M')
+            multiplier = 1024 * 1024;
+        if (multiplier != 1)
+            digits.erase(digits.length() - 1);
+    }
+
+    std::size_t value;
+    try {
+        value = atf::text::to_type< std::size_t >(digits);
+    } catch (const std::runtime_error&) {
+        value = 0;
+    }
+    if (value == 0 || digits.find_first_not_of("0123456789") !=
+        std::string::npos || value > SIZE_MAX / multiplier)
+        throw atf::application::usage_error("Invalid size '%s'",
+                                            str.c_str());
+    return value * multiplier;
+}
+
+static
+std::string
+format_duration(const ::timeval& tv)
+{
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%ld.%03lds",
+                  static_cast< long >(tv.tv_sec),
+                  static_cast< long >(tv.tv_usec / 1000));
+    return buf;
 }
 
 static
@@ -327,9 +630,15 @@ flatten_argv(char* const* argv)
     return cmdline;
 }
 
+// A NULL 'timeout' lets the command run for as long as it needs.  A
+// non-zero 'limit' only keeps a summary of the streams not listed in
+// 'keep', as described in atf_check_exec_array_bounded.  The command only
+// inherits the descriptors of atf-check above stderr if 'keep' includes
+// ATF_CHECK_INHERIT_FDS.
 static
 std::auto_ptr< atf::check::check_result >
-execute(const char* const* argv)
+execute(const char* const* argv, const bool forward, const ::timeval* timeout,
+        const std::size_t limit, const int keep)
 {
     // TODO: This should go to stderr... but fixing it now may be hard as test
     // cases out there might be relying on stderr being silent.
@@ -340,12 +649,17 @@ execute(const char* const* argv)
     std::cout.flush();
 
     atf::process::argv_array argva(argv);
-    return atf::check::exec(argva);
+    return atf::check::exec_bounded(argva, forward ? STDERR_FILENO : -1,
+                                    timeout, limit,
+                                    limit > 0 ? keep :
+                                    keep & ATF_CHECK_INHERIT_FDS);
 }
 
 static
 std::auto_ptr< atf::check::check_result >
-execute_with_shell(char* const* argv)
+execute_with_shell(char* const* argv, const bool forward,
+                   const ::timeval* timeout, const std::size_t limit,
+                   const int keep)
 {
     const std::string cmd = flatten_argv(argv);
 
@@ -354,39 +668,128 @@ execute_with_shell(char* const* argv)
     sh_argv[1] = "-c";
     sh_argv[2] = cmd.c_str();
     sh_argv[3] = NULL;
-    return execute(sh_argv);
+    return execute(sh_argv, forward, timeout, limit, keep);
 }
 
 static
 void
 cat_file(const atf::fs::path& path)
 {
-    std::ifstream stream(path.c_str());
-    if (!stream)
-        throw std::runtime_error("Failed to open " + path.str());
+    input_file f(path);
+
+    atf::auto_array< char > buf(new char[block_size]);
+    size_t n;
+    do {
+        n = f.read(buf.get(), block_size);
+        std::cerr.write(buf.get(), n);
+    } while (n == block_size);
+}
 
-    stream >> std::noskipws;
-    std::istream_iterator< char > begin(stream), end;
-    std::ostream_iterator< char > out(std::cerr);
-    std::copy(begin, end, out);
+// Prints the summary of a stream captured with bounded capture: its first
+// and last bytes, separated by a note about the bytes left out if any.
+static
+void
+print_capture(const std::string& name, const atf::check::capture& c)
+{
+    std::cerr << name << ": " << c.bytes() << " bytes, " << c.lines()
+              << " lines, sha256 " << c.digest() << "\n";
+
+    std::cerr << c.head();
+    const uint64_t omitted = c.bytes() - c.head().length() - c.tail().length();
+    if (omitted > 0) {
+        if (c.head()[c.head().length() - 1] != '\n')
+            std::cerr << "\n";
+        std::cerr << "[... " << omitted << " bytes omitted ...]\n";
+    }
+    std::cerr << c.tail();
+}
 
-    stream.close();
+// Computes the size and the SHA-256 digest of a file.
+static
+void
+file_summary(const atf::fs::path& p, uint64_t& bytes, std::string& digest)
+{
+    input_file f(p);
+
+    atf_sha256_t sha256;
+    atf_sha256_init(&sha256);
+    bytes = 0;
+
+    atf::auto_array< char > buf(new char[block_size]);
+    size_t n;
+    do {
+        n = f.read(buf.get(), block_size);
+        atf_sha256_update(&sha256, buf.get(), n);
+        bytes += n;
+    } while (n == block_size);
+
+    char hex[ATF_SHA256_HEX_LENGTH + 1];
+    atf_sha256_final_hex(&sha256, hex);
+    digest = hex;
 }
 
+// Reads the digest stored in a file, which can be given on its own, with
+// a "sha256:" prefix or in the format of the output of sha256sum.
 static
-bool
-grep_file(const atf::fs::path& path, const std::string& regexp)
+std::string
+read_digest_file(const atf::fs::path& p)
+{
+    std::ifstream is(p.c_str());
+    if (!is)
+        throw std::runtime_error("Failed to open " + p.str());
+
+    std::string word;
+    is >> word;
+    const std::string prefix = "sha256:";
+    if (word.compare(0, prefix.length(), prefix) == 0)
+        word.erase(0, prefix.length());
+
+    char hex[ATF_SHA256_HEX_LENGTH + 1];
+    if (!atf_sha256_parse_hex(word.c_str(), word.length(), hex))
+        throw std::runtime_error("Invalid digest in " + p.str());
+    return hex;
+}
+
+static
+std::string
+string_digest(const std::string& s)
+{
+    atf_sha256_t sha256;
+    atf_sha256_init(&sha256);
+    atf_sha256_update(&sha256, s.data(), s.length());
+
+    char hex[ATF_SHA256_HEX_LENGTH + 1];
+    atf_sha256_final_hex(&sha256, hex);
+    return hex;
+}
+
+// Looks for several regular expressions in a file in a single pass.
+//
+// Returns, for every expression, whether any line of the file matches it.
+static
+std::vector< bool >
+grep_file(const atf::fs::path& path, const std::vector< std::string >& regexps)
 {
+    regex_set res;
+    for (std::vector< std::string >::const_iterator iter = regexps.begin();
+         iter != regexps.end(); iter++)
+        res.add(*iter);
+
     std::ifstream stream(path.c_str());
     if (!stream)
         throw std::runtime_error("Failed to open " + path.str());
 
-    bool found = false;
+    std::vector< bool > found(regexps.size(), false);
+    std::size_t pending = regexps.size();
 
     std::string line;
-    while (!found && !std::getline(stream, line).fail()) {
-        if (atf::text::match(line, regexp))
-            found = true;
+    while (pending > 0 && !std::getline(stream, line).fail()) {
+        for (std::size_t i = 0; i < found.size(); i++) {
+            if (!found[i] && res.matches(i, line)) {
+                found[i] = true;
+                pending--;
+            }
+        }
     }
 
     stream.close();
@@ -403,61 +806,145 @@ file_empty(const atf::fs::path& p)
     return (f.get_size() == 0);
 }
 
-static bool
+static
+bool
 compare_files(const atf::fs::path& p1, const atf::fs::path& p2)
 {
-    bool equal = false;
+    input_file f1(p1);
+    input_file f2(p2);
+
+    if (f1.size() != -1 && f2.size() != -1) {
+        if (f1.size() != f2.size())
+            return false;
+        else if (f1.size() == 0)
+            return true;
+
+        const char* m1 = f1.map();
+        const char* m2 = f2.map();
+        if (m1 != NULL && m2 != NULL)
+            return std::memcmp(m1, m2, static_cast< size_t >(f1.size())) == 0;
+    }
+
+    atf::auto_array< char > buf1(new char[block_size]);
+    atf::auto_array< char > buf2(new char[block_size]);
+    for (;;) {
+        const size_t n1 = f1.read(buf1.get(), block_size);
+        const size_t n2 = f2.read(buf2.get(), block_size);
+
+        if (n1 != n2 || std::memcmp(buf1.get(), buf2.get(), n1) != 0)
+            return false;
+        else if (n1 < block_size)
+            return true;
+    }
+}
+
+static
+bool
+compare_file_contents(const atf::fs::path& p, const std::string& contents)
+{
+    input_file f(p);
 
-    std::ifstream f1(p1.c_str());
-    if (!f1)
-        throw std::runtime_error("Failed to open " + p1.str());
+    if (f.size() != -1) {
+        if (f.size() != static_cast< off_t >(contents.length()))
+            return false;
+        else if (f.size() == 0)
+            return true;
 
-    std::ifstream f2(p2.c_str());
-    if (!f2)
-        throw std::runtime_error("Failed to open " + p1.str());
+        const char* m = f.map();
+        if (m != NULL)
+            return std::memcmp(m, contents.data(), contents.length()) == 0;
+    }
 
+    atf::auto_array< char > buf(new char[block_size]);
+    size_t offset = 0;
     for (;;) {
-        char buf1[512], buf2[512];
+        const size_t n = f.read(buf.get(), block_size);
+
+        if (n > contents.length() - offset ||
+            std::memcmp(buf.get(), contents.data() + offset, n) != 0)
+            return false;
+        offset += n;
+        if (n < block_size)
+            return offset == contents.length();
+    }
+}
 
-        f1.read(buf1, sizeof(buf1));
-        if (f1.bad())
-            throw std::runtime_error("Failed to read from " + p1.str());
+static
+void
+copy_file(const atf::fs::path& src, const atf::fs::path& dst)
+{
+    input_file in(src);
 
-        f2.read(buf2, sizeof(buf2));
-        if (f2.bad())
-            throw std::runtime_error("Failed to read from " + p1.str());
+    const int outfd = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (outfd == -1)
+        throw std::runtime_error("Failed to create " + dst.str());
 
-        if ((f1.gcount() == 0) && (f2.gcount() == 0)) {
-            equal = true;
-            break;
+    try {
+        bool done = false;
+
+#if defined(HAVE_COPY_FILE_RANGE)
+        while (!done) {
+            const ssize_t n = ::copy_file_range(in.fd(), NULL, outfd, NULL,
+                                                SSIZE_MAX, 0);
+            if (n == -1) {
+                if (errno == EINTR)
+                    continue;
+                else if (errno == ENOSYS || errno == EXDEV ||
+                         errno == EINVAL || errno == EOPNOTSUPP)
+                    break;
+                throw atf::system_error("atf_check::copy_file",
+                                        "copy_file_range(2) failed", errno);
+            } else if (n == 0)
+                done = true;
         }
-
-        if ((f1.gcount() != f2.gcount()) ||
-            (std::memcmp(buf1, buf2, f1.gcount()) != 0)) {
-            break;
+#endif
+
+        // Fall back to a regular copy starting at the current offsets, which
+        // copy_file_range(2) advances for whatever it managed to copy.
+        atf::auto_array< char > buf(new char[block_size]);
+        while (!done) {
+            const size_t n = in.read(buf.get(), block_size);
+            size_t written = 0;
+            while (written < n) {
+                const ssize_t w = ::write(outfd, buf.get() + written,
+                                          n - written);
+                if (w == -1) {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::runtime_error("Failed to write to " +
+                                             dst.str());
+                }
+                written += static_cast< size_t >(w);
+            }
+            done = n < block_size;
         }
+    } catch (...) {
+        ::close(outfd);
+        throw;
     }
 
-    return equal;
+    if (::close(outfd) == -1)
+        throw std::runtime_error("Failed to write to " + dst.str());
 }
 
 static
-void
-print_diff(const atf::fs::path& p1, const atf::fs::path& p2)
+std::vector< std::string >
+read_file_lines(const atf::fs::path& p)
 {
-    const atf::process::status s =
-        atf::process::exec(atf::fs::path("diff"),
-                           atf::process::argv_array("diff", "-u", p1.c_str(),
-                                                    p2.c_str(), NULL),
-                           atf::process::stream_connect(STDOUT_FILENO,
-                                                        STDERR_FILENO),
-                           atf::process::stream_inherit());
+    std::ifstream is(p.c_str(), std::ios::binary);
+    if (!is)
+        throw std::runtime_error("Failed to open " + p.str());
 
-    if (!s.exited())
-        std::cerr << "Failed to run diff(3)\n";
+    return atf::diff::read_lines(is);
+}
 
-    if (s.exitstatus() != 1)
-        std::cerr << "Error while running diff(3)\n";
+static
+void
+print_diff(const std::string& label1, const std::vector< std::string >& lines1,
+           const std::string& label2, const std::vector< std::string >& lines2)
+{
+    atf::diff::unified(std::cerr, label1, lines1, label2, lines2, 3,
+                       max_diff_hunks);
 }
 
 static
@@ -505,9 +992,31 @@ decode(const std::string& s)
     return res;
 }
 
+static
+void
+print_outputs(const atf::check::check_result& cr)
+{
+    if (cr.bounded()) {
+        print_capture("stdout", cr.stdout_capture());
+        std::cerr << "\n";
+        print_capture("stderr", cr.stderr_capture());
+        std::cerr << "\n";
+        return;
+    }
+
+    std::cerr << "stdout:\n";
+    cat_file(atf::fs::path(cr.stdout_path()));
+    std::cerr << "\n";
+
+    std::cerr << "stderr:\n";
+    cat_file(atf::fs::path(cr.stderr_path()));
+    std::cerr << "\n";
+}
+
 static
 bool
-run_status_check(const status_check& sc, const atf::check::check_result& cr)
+run_status_check(const status_check& sc, const atf::check::check_result& cr,
+                 const bool forwarded)
 {
     bool result;
 
@@ -561,15 +1070,8 @@ run_status_check(const status_check& sc, const atf::check::check_result& cr)
         result = false;
     }
 
-    if (result == false) {
-        std::cerr << "stdout:\n";
-        cat_file(atf::fs::path(cr.stdout_path()));
-        std::cerr << "\n";
-
-        std::cerr << "stderr:\n";
-        cat_file(atf::fs::path(cr.stderr_path()));
-        std::cerr << "\n";
-    }
+    if (result == false && !forwarded)
+        print_outputs(cr);
 
     return result;
 }
@@ -577,42 +1079,106 @@ run_status_check(const status_check& sc, const atf::check::check_result& cr)
 static
 bool
 run_status_checks(const std::vector< status_check >& checks,
-                  const atf::check::check_result& result)
+                  const atf::check::check_result& result,
+                  const bool forwarded)
 {
     bool ok = false;
 
     for (std::vector< status_check >::const_iterator iter = checks.begin();
          !ok && iter != checks.end(); iter++) {
-         ok |= run_status_check(*iter, result);
+         ok |= run_status_check(*iter, result, forwarded);
     }
 
     return ok;
 }
 
+// Checks the time used by the command against the maxima given with -w and
+// -c; a maximum that is not set is not checked.
+static
+bool
+run_time_checks(const atf::check::check_result& cr, const ::timeval& max_wall,
+                const ::timeval& max_cpu)
+{
+    bool result = true;
+
+    const ::timeval wall = cr.wall_time();
+    if (timerisset(&max_wall) && timercmp(&wall, &max_wall, >)) {
+        std::cerr << "Fail: command used too much wall time: "
+                  << format_duration(wall) << ", maximum: "
+                  << format_duration(max_wall) << "\n";
+        result = false;
+    }
+
+    const ::timeval cpu = cr.cpu_time();
+    if (timerisset(&max_cpu) && timercmp(&cpu, &max_cpu, >)) {
+        std::cerr << "Fail: command used too much CPU time: "
+                  << format_duration(cpu) << ", maximum: "
+                  << format_duration(max_cpu) << "\n";
+        result = false;
+    }
+
+    return result;
+}
+
+// The 'matches' argument holds the result of looking for the expression of
+// a match check in the output, which is computed in advance for all checks
+// at once by run_output_checks; it is ignored for other types of checks.
+//
+// If 'cap' is not NULL, the output was captured with bounded capture: the
+// comparisons are done against its size and digest and failure reports
+// only show its summary.  The file in 'path' only exists if there are
+// match or save checks.  Otherwise, digest checks hash the file in 'path'
+// once the command has exited.
 static
 bool
 run_output_check(const output_check oc, const atf::fs::path& path,
-                 const std::string& stdxxx)
+                 const std::string& stdxxx, const bool matches,
+                 const bool forwarded, const atf::check::capture* cap)
 {
     bool result;
 
     if (oc.type == oc_empty) {
-        const bool is_empty = file_empty(path);
+        const bool is_empty = cap != NULL ? cap->bytes() == 0 :
+            file_empty(path);
         if (!oc.negated && !is_empty) {
             std::cerr << "Fail: " << stdxxx << " not empty\n";
-            print_diff(atf::fs::path("/dev/null"), path);
+            if (cap != NULL)
+                print_capture(stdxxx, *cap);
+            else
+                print_diff("/dev/null", std::vector< std::string >(), stdxxx,
+                           read_file_lines(path));
             result = false;
         } else if (oc.negated && is_empty) {
             std::cerr << "Fail: " << stdxxx << " is empty\n";
             result = false;
         } else
             result = true;
+    } else if (oc.type == oc_file && cap != NULL) {
+        uint64_t bytes;
+        std::string digest;
+        file_summary(atf::fs::path(oc.value), bytes, digest);
+
+        const bool equals = bytes == cap->bytes() && digest == cap->digest();
+        if (!oc.negated && !equals) {
+            std::cerr << "Fail: " << stdxxx << " does not match golden "
+                "output\n";
+            std::cerr << oc.value << ": " << bytes << " bytes, sha256 "
+                      << digest << "\n";
+            print_capture(stdxxx, *cap);
+            result = false;
+        } else if (oc.negated && equals) {
+            std::cerr << "Fail: " << stdxxx << " matches golden output\n";
+            print_capture(stdxxx, *cap);
+            result = false;
+        } else
+            result = true;
     } else if (oc.type == oc_file) {
         const bool equals = compare_files(path, atf::fs::path(oc.value));
         if (!oc.negated && !equals) {
             std::cerr << "Fail: " << stdxxx << " does not match golden "
                 "output\n";
-            print_diff(atf::fs::path(oc.value), path);
+            print_diff(oc.value, read_file_lines(atf::fs::path(oc.value)),
+                       stdxxx, read_file_lines(path));
             result = false;
         } else if (oc.negated && equals) {
             std::cerr << "Fail: " << stdxxx << " matches golden output\n";
@@ -622,50 +1188,94 @@ run_output_check(const output_check oc, const atf::fs::path& path,
             result = true;
     } else if (oc.type == oc_ignore) {
         result = true;
+    } else if (oc.type == oc_digest || oc.type == oc_digestfile) {
+        const std::string expected = oc.type == oc_digest ? oc.value :
+            read_digest_file(atf::fs::path(oc.value));
+
+        uint64_t bytes;
+        std::string digest;
+        if (cap != NULL) {
+            bytes = cap->bytes();
+            digest = cap->digest();
+        } else
+            file_summary(path, bytes, digest);
+
+        const bool equals = expected == digest;
+        if (!oc.negated && !equals) {
+            std::cerr << "Fail: " << stdxxx << " does not match expected "
+                "digest\n";
+            std::cerr << "expected: sha256 " << expected << "\n";
+            if (cap != NULL)
+                print_capture(stdxxx, *cap);
+            else
+                std::cerr << stdxxx << ": " << bytes << " bytes, sha256 "
+                          << digest << "\n";
+            result = false;
+        } else if (oc.negated && equals) {
+            std::cerr << "Fail: " << stdxxx << " matches expected digest\n";
+            if (cap != NULL)
+                print_capture(stdxxx, *cap);
+            result = false;
+        } else
+            result = true;
+    } else if (oc.type == oc_inline && cap != NULL) {
+        const std::string expected = decode(oc.value);
+        const std::string digest = string_digest(expected);
+
+        const bool equals = expected.length() == cap->bytes() &&
+            digest == cap->digest();
+        if (!oc.negated && !equals) {
+            std::cerr << "Fail: " << stdxxx << " does not match expected "
+                "value\n";
+            std::cerr << "expected: " << expected.length() << " bytes, "
+                "sha256 " << digest << "\n";
+            print_capture(stdxxx, *cap);
+            result = false;
+        } else if (oc.negated && equals) {
+            std::cerr << "Fail: " << stdxxx << " matches expected value\n";
+            print_capture(stdxxx, *cap);
+            result = false;
+        } else
+            result = true;
     } else if (oc.type == oc_inline) {
-        atf::fs::path path2 = atf::fs::path(atf::config::get("atf_workdir"))
-                              / "inline.XXXXXX";
-        temp_file temp(path2);
-        temp.write(decode(oc.value));
-        temp.close();
+        const std::string expected = decode(oc.value);
 
-        const bool equals = compare_files(path, temp.get_path());
+        const bool equals = compare_file_contents(path, expected);
         if (!oc.negated && !equals) {
             std::cerr << "Fail: " << stdxxx << " does not match expected "
                 "value\n";
-            print_diff(temp.get_path(), path);
+            std::istringstream is(expected);
+            print_diff("expected", atf::diff::read_lines(is), stdxxx,
+                       read_file_lines(path));
             result = false;
         } else if (oc.negated && equals) {
             std::cerr << "Fail: " << stdxxx << " matches expected value\n";
-            cat_file(temp.get_path());
+            std::cerr << expected;
             result = false;
         } else
             result = true;
     } else if (oc.type == oc_match) {
-        const bool matches = grep_file(path, oc.value);
         if (!oc.negated && !matches) {
             std::cerr << "Fail: regexp " + oc.value + " not in " << stdxxx
                       << "\n";
-            cat_file(path);
+            if (!forwarded && cap != NULL)
+                print_capture(stdxxx, *cap);
+            else if (!forwarded)
+                cat_file(path);
             result = false;
         } else if (oc.negated && matches) {
             std::cerr << "Fail: regexp " + oc.value + " is in " << stdxxx
                       << "\n";
-            cat_file(path);
+            if (!forwarded && cap != NULL)
+                print_capture(stdxxx, *cap);
+            else if (!forwarded)
+                cat_file(path);
             result = false;
         } else
             result = true;
     } else if (oc.type == oc_save) {
         INV(!oc.negated);
-        std::ifstream ifs(path.c_str(), std::fstream::binary);
-        ifs >> std::noskipws;
-        std::istream_iterator< char > begin(ifs), end;
-
-        std::ofstream ofs(oc.value.c_str(), std::fstream::binary
-                                     | std::fstream::trunc);
-        std::ostream_iterator <char> obegin(ofs);
-
-        std::copy(begin, end, obegin);
+        copy_file(path, atf::fs::path(oc.value));
         result = true;
     } else {
         UNREACHABLE;
@@ -678,18 +1288,297 @@ run_output_check(const output_check oc, const atf::fs::path& path,
 static
 bool
 run_output_checks(const std::vector< output_check >& checks,
-                  const atf::fs::path& path, const std::string& stdxxx)
+                  const atf::fs::path& path, const std::string& stdxxx,
+                  const bool forwarded, const atf::check::capture* cap)
 {
     bool ok = true;
 
+    std::vector< std::string > regexps;
+    for (std::vector< output_check >::const_iterator iter = checks.begin();
+         iter != checks.end(); iter++) {
+        if ((*iter).type == oc_match)
+            regexps.push_back((*iter).value);
+    }
+
+    std::vector< bool > found;
+    if (!regexps.empty())
+        found = grep_file(path, regexps);
+
+    std::vector< bool >::const_iterator found_iter = found.begin();
     for (std::vector< output_check >::const_iterator iter = checks.begin();
          iter != checks.end(); iter++) {
-         ok &= run_output_check(*iter, path, stdxxx);
+        const bool matches = (*iter).type == oc_match && *found_iter++;
+        ok &= run_output_check(*iter, path, stdxxx, matches, forwarded, cap);
     }
 
     return ok;
 }
 
+// Tells whether any of the checks needs the full output of the command,
+// which is otherwise not kept with bounded capture.
+static
+bool
+need_full_output(const std::vector< output_check >& checks)
+{
+    for (std::vector< output_check >::const_iterator iter = checks.begin();
+         iter != checks.end(); iter++) {
+        if ((*iter).type == oc_match || (*iter).type == oc_save)
+            return true;
+    }
+    return false;
+}
+
+// Reads the specification of a check in batch mode.
+//
+// A specification is the number of arguments followed by the arguments
+// themselves, all of them terminated by a NUL character.  The arguments are
+// those that would be given to atf-check to run the check on its own.
+//
+// Returns false if the end of the input was reached before the
+// specification.
+static
+bool
+read_check_spec(std::istream& is, std::vector< std::string >& args)
+{
+    std::string line;
+    if (std::getline(is, line, '\0').fail())
+        return false;
+
+    size_t nargs;
+    try {
+        nargs = atf::text::to_type< size_t >(line);
+    } catch (const std::runtime_error&) {
+        throw std::runtime_error("Invalid argument count '" + line + "' in "
+                                 "check specification");
+    }
+
+    args.clear();
+    for (size_t i = 0; i < nargs; i++) {
+        if (std::getline(is, line, '\0').fail())
+            throw std::runtime_error("Unexpected end of input in check "
+                                     "specification");
+        args.push_back(line);
+    }
+
+    return true;
+}
+
+// Decodes the escape sequence of an ANSI-C quoted string that starts at
+// 'pos', just after the backslash, and advances 'pos' past it.
+static
+char
+decode_ansi_c_escape(const std::string& text, std::string::size_type& pos)
+{
+    const char c = text[pos++];
+    switch (c) {
+    case 'a': return '\a';
+    case 'b': return '\b';
+    case 'e': case 'E': return 033;
+    case 'f': return '\f';
+    case 'n': return '\n';
+    case 'r': return '\r';
+    case 't': return '\t';
+    case 'v': return '\v';
+    case 'x':
+        {
+            int value = 0;
+            int count = 0;
+            while (count < 2 && pos < text.length() &&
+                   std::isxdigit(static_cast< unsigned char >(text[pos]))) {
+                const char d = text[pos++];
+                value = value * 16 + (std::isdigit(d) ? d - '0' :
+                                      std::tolower(d) - 'a' + 10);
+                count++;
+            }
+            return count == 0 ? 'x' : static_cast< char >(value);
+        }
+    default:
+        if (c >= '0' && c <= '7') {
+            int value = c - '0';
+            int count = 1;
+            while (count < 3 && pos < text.length() &&
+                   text[pos] >= '0' && text[pos] <= '7') {
+                value = value * 8 + (text[pos++] - '0');
+                count++;
+            }
+            return static_cast< char >(value);
+        }
+        return c;
+    }
+}
+
+// Extracts the next word of a shell command line starting at 'pos',
+// removing its quoting, and advances 'pos' past it.  Only the quoting
+// forms used by the shells to print variables are supported.
+static
+std::string
+unquote_shell_word(const std::string& text, std::string::size_type& pos)
+{
+    std::string word;
+
+    while (pos < text.length() && !std::isspace(
+               static_cast< unsigned char >(text[pos]))) {
+        const char c = text[pos++];
+        if (c == '\'' || (c == '$' && pos < text.length() &&
+                          text[pos] == '\'')) {
+            const bool ansi_c = c == '$';
+            if (ansi_c)
+                pos++;
+            while (pos < text.length() && text[pos] != '\'') {
+                if (ansi_c && text[pos] == '\\' && pos + 1 < text.length()) {
+                    pos++;
+                    word += decode_ansi_c_escape(text, pos);
+                } else
+                    word += text[pos++];
+            }
+            if (pos == text.length())
+                throw std::runtime_error("Unterminated quoted string in "
+                                         "environment");
+            pos++;
+        } else if (c == '"') {
+            while (pos < text.length() && text[pos] != '"') {
+                if (text[pos] == '\\' && pos + 1 < text.length() &&
+                    std::strchr("$`\"\\\n", text[pos + 1]) != NULL) {
+                    if (text[pos + 1] != '\n')
+                        word += text[pos + 1];
+                    pos += 2;
+                } else
+                    word += text[pos++];
+            }
+            if (pos == text.length())
+                throw std::runtime_error("Unterminated quoted string in "
+                                         "environment");
+            pos++;
+        } else if (c == '\\' && pos < text.length())
+            word += text[pos++];
+        else
+            word += c;
+    }
+
+    return word;
+}
+
+// Parses the output of the 'export -p' builtin of the shell and returns
+// the variables it defines in 'name=value' form.
+static
+std::vector< std::string >
+parse_exported_vars(const std::string& text)
+{
+    std::vector< std::string > vars;
+
+    std::string::size_type pos = 0;
+    while (pos < text.length()) {
+        if (std::isspace(static_cast< unsigned char >(text[pos]))) {
+            pos++;
+            continue;
+        }
+
+        // Every line is of the form 'export name=value' or 'declare -x
+        // name=value', so the words without an equal sign are either
+        // commands, options or variables that are exported but unset.
+        const std::string word = unquote_shell_word(text, pos);
+        const std::string::size_type eq = word.find('=');
+        if (eq != std::string::npos && eq > 0)
+            vars.push_back(word);
+    }
+
+    return vars;
+}
+
+// Reads the context of a check in server mode, which precedes every check
+// specification and is composed of three NUL-terminated fields: the working
+// directory, the umask in octal and the output of the 'export -p' builtin
+// of the shell.
+//
+// Returns false if the end of the input was reached before the context.
+static
+bool
+read_check_context(std::istream& is, check_context& ctx)
+{
+    if (std::getline(is, ctx.directory, '\0').fail())
+        return false;
+
+    std::string umask_str, env_str;
+    if (std::getline(is, umask_str, '\0').fail() ||
+        std::getline(is, env_str, '\0').fail())
+        throw std::runtime_error("Unexpected end of input in check context");
+
+    char* endptr;
+    const long value = std::strtol(umask_str.c_str(), &endptr, 8);
+    while (std::isspace(static_cast< unsigned char >(*endptr)))
+        endptr++;
+    if (umask_str.empty() || *endptr != '\0' || value < 0 || value > 0777)
+        throw std::runtime_error("Invalid umask '" + umask_str + "' in check "
+                                 "context");
+    ctx.umask = static_cast< mode_t >(value);
+
+    ctx.environment = parse_exported_vars(env_str);
+
+    return true;
+}
+
+// Makes the current process adopt the state of the shell that sent a check
+// in server mode.
+static
+void
+apply_check_context(const check_context& ctx)
+{
+    if (::chdir(ctx.directory.c_str()) == -1)
+        throw atf::system_error("atf_check::apply_check_context",
+                                "chdir(2) to " + ctx.directory + " failed",
+                                errno);
+
+    ::umask(ctx.umask);
+
+    // The array is leaked on purpose: it becomes the environment of the
+    // process, which exits once the check is done.
+    char** env = new char*[ctx.environment.size() + 1];
+    for (size_t i = 0; i < ctx.environment.size(); i++)
+        env[i] = ::strdup(ctx.environment[i].c_str());
+    env[ctx.environment.size()] = NULL;
+    environ = env;
+}
+
+static
+int
+open_anonymous_file(void)
+{
+    const std::string tmpl = atf::config::get("atf_workdir") +
+        "/atf-check.XXXXXX";
+
+    atf::auto_array< char > buf(new char[tmpl.length() + 1]);
+    std::strcpy(buf.get(), tmpl.c_str());
+
+    const int fd = ::mkstemp(buf.get());
+    if (fd == -1)
+        throw atf::system_error("atf_check::open_anonymous_file",
+                                "mkstemp(3) failed", errno);
+    ::unlink(buf.get());
+
+    return fd;
+}
+
+// Copies the whole contents of an open file to the given stream and closes
+// the file.
+static
+void
+dump_and_close(const int fd, std::ostream& os)
+{
+    atf::auto_array< char > buf(new char[block_size]);
+
+    ssize_t n = 0;
+    if (::lseek(fd, 0, SEEK_SET) != -1) {
+        while ((n = ::read(fd, buf.get(), block_size)) > 0 ||
+               (n == -1 && errno == EINTR)) {
+            if (n > 0)
+                os.write(buf.get(), n);
+        }
+    }
+    os.flush();
+
+    ::close(fd);
+}
+
 // ------------------------------------------------------------------------
 // The "atf_check" application.
 // ------------------------------------------------------------------------
@@ -697,7 +1586,17 @@ run_output_checks(const std::vector< output_check >& checks,
 namespace {
 
 class atf_check : public atf::application::app {
+    const bool m_batch_allowed;
+    std::string m_bflag;
+    size_t m_jobs;
+    std::string m_rflag;
+    bool m_lflag;
+    std::size_t m_mflag;
+    bool m_iflag;
     bool m_xflag;
+    ::timeval m_tflag;
+    ::timeval m_wflag;
+    ::timeval m_cflag;
 
     std::vector< status_check > m_status_checks;
     std::vector< output_check > m_stdout_checks;
@@ -708,13 +1607,20 @@ class atf_check : public atf::application::app {
     bool run_output_checks(const atf::check::check_result&,
                            const std::string&) const;
 
+    batch_check start_batch_check(const size_t,
+                                  const std::vector< std::string >&,
+                                  const check_context*) const;
+    bool finish_batch_check(const batch_check&, std::ostream&) const;
+    int run_batch(void) const;
+    int run_server(void) const;
+
     std::string specific_args(void) const;
     options_set specific_options(void) const;
     void process_option(int, const char*);
     void process_option_s(const std::string&);
 
 public:
-    atf_check(void);
+    explicit atf_check(const bool);
     int main(void);
 };
 
@@ -723,10 +1629,20 @@ public:
 const char* atf_check::m_description =
     "atf-check executes given command and analyzes its results.";
 
-atf_check::atf_check(void) :
+// The 'batch_allowed' argument is false for the instances that run the
+// individual checks of a batch, which cannot start batches on their own.
+atf_check::atf_check(const bool batch_allowed) :
     app(m_description, "atf-check(1)"),
+    m_batch_allowed(batch_allowed),
+    m_jobs(0),
+    m_lflag(false),
+    m_mflag(0),
+    m_iflag(false),
     m_xflag(false)
 {
+    timerclear(&m_tflag);
+    timerclear(&m_wflag);
+    timerclear(&m_cflag);
 }
 
 bool
@@ -735,17 +1651,264 @@ atf_check::run_output_checks(const atf::check::check_result& r,
     const
 {
     if (stdxxx == "stdout") {
+        if (r.bounded()) {
+            const atf::check::capture cap = r.stdout_capture();
+            return ::run_output_checks(m_stdout_checks,
+                atf::fs::path(r.stdout_path()), "stdout", m_lflag, &cap);
+        }
         return ::run_output_checks(m_stdout_checks,
-            atf::fs::path(r.stdout_path()), "stdout");
+            atf::fs::path(r.stdout_path()), "stdout", m_lflag, NULL);
     } else if (stdxxx == "stderr") {
+        if (r.bounded()) {
+            const atf::check::capture cap = r.stderr_capture();
+            return ::run_output_checks(m_stderr_checks,
+                atf::fs::path(r.stderr_path()), "stderr", m_lflag, &cap);
+        }
         return ::run_output_checks(m_stderr_checks,
-            atf::fs::path(r.stderr_path()), "stderr");
+            atf::fs::path(r.stderr_path()), "stderr", m_lflag, NULL);
     } else {
         UNREACHABLE;
         return false;
     }
 }
 
+// Starts a child process that runs the check described by 'args' as if
+// they had been given to atf-check on the command line.
+//
+// In server mode, 'ctx' is not NULL and the check runs in the given context
+// and inherits the standard descriptors of atf-check.  Otherwise, its output
+// is captured to be dumped once it finishes.
+batch_check
+atf_check::start_batch_check(const size_t index,
+                             const std::vector< std::string >& args,
+                             const check_context* ctx)
+    const
+{
+    int stdout_fd = -1;
+    int stderr_fd = -1;
+    if (ctx == NULL) {
+        stdout_fd = open_anonymous_file();
+        try {
+            stderr_fd = open_anonymous_file();
+        } catch (...) {
+            ::close(stdout_fd);
+            throw;
+        }
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+
+    const pid_t pid = ::fork();
+    if (pid == -1) {
+        if (ctx == NULL) {
+            ::close(stdout_fd);
+            ::close(stderr_fd);
+        }
+        throw atf::system_error("atf_check::start_batch_check",
+                                "fork(2) failed", errno);
+    } else if (pid == 0) {
+        if (ctx == NULL) {
+            // The standard input may be the stream of check specifications,
+            // so do not let the checked commands consume it.
+            const int nullfd = ::open("/dev/null", O_RDONLY);
+            if (nullfd == -1 || ::dup2(nullfd, STDIN_FILENO) == -1 ||
+                ::dup2(stdout_fd, STDOUT_FILENO) == -1 ||
+                ::dup2(stderr_fd, STDERR_FILENO) == -1)
+                ::_exit(EXIT_FAILURE);
+            ::close(nullfd);
+            ::close(stdout_fd);
+            ::close(stderr_fd);
+        } else {
+            try {
+                apply_check_context(*ctx);
+            } catch (const std::runtime_error& e) {
+                std::cerr << m_prog_name << ": ERROR: " << e.what() << "\n";
+                std::exit(EXIT_FAILURE);
+            }
+        }
+
+        std::vector< char* > argv;
+        argv.push_back(const_cast< char* >(m_argv0));
+        for (std::vector< std::string >::const_iterator iter = args.begin();
+             iter != args.end(); iter++)
+            argv.push_back(const_cast< char* >((*iter).c_str()));
+        argv.push_back(NULL);
+
+        const int exitcode = atf_check(false).run(
+            static_cast< int >(argv.size() - 1), &argv[0]);
+        std::cout.flush();
+        std::cerr.flush();
+        std::exit(exitcode);
+    }
+
+    return batch_check(index, pid, stdout_fd, stderr_fd);
+}
+
+// Waits for the child process of a check, dumps its output and prints the
+// verdict of the check to 'verdicts'.
+bool
+atf_check::finish_batch_check(const batch_check& bc, std::ostream& verdicts)
+    const
+{
+    int status;
+    while (::waitpid(bc.pid, &status, 0) == -1) {
+        if (errno != EINTR)
+            throw atf::system_error("atf_check::finish_batch_check",
+                                    "waitpid(2) failed", errno);
+    }
+
+    if (bc.stdout_fd != -1)
+        dump_and_close(bc.stdout_fd, std::cout);
+    if (bc.stderr_fd != -1)
+        dump_and_close(bc.stderr_fd, std::cerr);
+
+    bool passed = false;
+    verdicts << "check " << bc.index << ": ";
+    if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+        verdicts << "passed\n";
+        passed = true;
+    } else if (WIFEXITED(status))
+        verdicts << "failed\n";
+    else
+        verdicts << "broken: received signal " << WTERMSIG(status) << "\n";
+    verdicts.flush();
+
+    return passed;
+}
+
+// Runs all the checks given in the file specified by -b, keeping up to
+// m_jobs of them in flight.  Verdicts are printed to stdout in input order.
+int
+atf_check::run_batch(void)
+    const
+{
+    std::ifstream file;
+    if (m_bflag != "-") {
+        file.open(m_bflag.c_str(), std::ios::binary);
+        if (!file)
+            throw std::runtime_error("Failed to open " + m_bflag);
+    }
+    std::istream& is = m_bflag == "-" ? std::cin : file;
+
+    std::list< batch_check > running;
+    bool ok = true;
+    size_t count = 0;
+    bool eof = false;
+    try {
+        while (!eof || !running.empty()) {
+            std::vector< std::string > args;
+            while (!eof && running.size() < m_jobs) {
+                if (read_check_spec(is, args))
+                    running.push_back(start_batch_check(++count, args,
+                                                        NULL));
+                else
+                    eof = true;
+            }
+
+            if (!running.empty()) {
+                ok &= finish_batch_check(running.front(), std::cout);
+                running.pop_front();
+            }
+        }
+    } catch (...) {
+        for (std::list< batch_check >::const_iterator iter = running.begin();
+             iter != running.end(); iter++) {
+            ::kill((*iter).pid, SIGTERM);
+            (void)finish_batch_check(*iter, std::cout);
+        }
+        throw;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Opens one of the files given to -b and -r in server mode.  FIFOs are
+// opened for reading and writing so that clients can open and close them
+// for every check, and all descriptors are kept away from the checks.
+static
+int
+open_server_file(const std::string& path, const int flags)
+{
+    struct stat sb;
+    const bool fifo = ::stat(path.c_str(), &sb) != -1 && S_ISFIFO(sb.st_mode);
+
+    const int fd = fifo ? ::open(path.c_str(), O_RDWR)
+                        : ::open(path.c_str(), flags, 0666);
+    if (fd == -1)
+        throw atf::system_error("atf_check::open_server_file",
+                                "Failed to open " + path, errno);
+    if (::fcntl(fd, F_SETFD, FD_CLOEXEC) == -1) {
+        const int original_errno = errno;
+        ::close(fd);
+        throw atf::system_error("atf_check::open_server_file",
+                                "fcntl(2) failed", original_errno);
+    }
+    return fd;
+}
+
+// Runs the checks that arrive through the file specified by -b one at a
+// time, each in the context sent along with it, and writes their verdicts
+// to the file specified by -r as soon as they are known.
+int
+atf_check::run_server(void)
+    const
+{
+    const int requests_fd = m_bflag == "-" ? STDIN_FILENO :
+        open_server_file(m_bflag, O_RDONLY);
+    int replies_fd = -1;
+    try {
+        replies_fd = open_server_file(m_rflag,
+                                      O_WRONLY | O_CREAT | O_TRUNC);
+    } catch (...) {
+        if (requests_fd != STDIN_FILENO)
+            ::close(requests_fd);
+        throw;
+    }
+
+    request_streambuf buf(requests_fd);
+    std::istream is(&buf);
+
+    bool ok = true;
+    size_t count = 0;
+    try {
+        std::vector< std::string > args;
+        check_context ctx;
+        while (read_check_context(is, ctx)) {
+            if (!read_check_spec(is, args))
+                throw std::runtime_error("Unexpected end of input in check "
+                                         "specification");
+
+            std::ostringstream verdict;
+            ok &= finish_batch_check(start_batch_check(++count, args, &ctx),
+                                     verdict);
+
+            const std::string text = verdict.str();
+            std::string::size_type pos = 0;
+            while (pos < text.length()) {
+                const ssize_t n = ::write(replies_fd, text.data() + pos,
+                                          text.length() - pos);
+                if (n == -1 && errno != EINTR)
+                    throw atf::system_error("atf_check::run_server",
+                                            "Failed to write to " + m_rflag,
+                                            errno);
+                if (n > 0)
+                    pos += n;
+            }
+        }
+    } catch (...) {
+        ::close(replies_fd);
+        if (requests_fd != STDIN_FILENO)
+            ::close(requests_fd);
+        throw;
+    }
+    ::close(replies_fd);
+    if (requests_fd != STDIN_FILENO)
+        ::close(requests_fd);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 std::string
 atf_check::specific_args(void)
     const
@@ -763,11 +1926,35 @@ atf_check::specific_options(void)
     opts.insert(option('s', "qual:value", "Handle status. Qualifier "
                 "must be one of: ignore exit:<num> signal:<name|num>"));
     opts.insert(option('o', "action:arg", "Handle stdout. Action must be "
-                "one of: empty ignore file:<path> inline:<val> match:regexp "
-                "save:<path>"));
+                "one of: digest:sha256:<hex> digestfile:<path> empty ignore "
+                "file:<path> inline:<val> match:regexp save:<path>"));
     opts.insert(option('e', "action:arg", "Handle stderr. Action must be "
-                "one of: empty ignore file:<path> inline:<val> match:regexp "
-                "save:<path>"));
+                "one of: digest:sha256:<hex> digestfile:<path> empty ignore "
+                "file:<path> inline:<val> match:regexp save:<path>"));
+    if (m_batch_allowed) {
+        opts.insert(option('b', "file", "Run the checks specified in file, "
+                    "or in stdin if file is -"));
+    }
+    opts.insert(option('c', "duration", "Fail if the command uses more CPU "
+                "time than this"));
+    opts.insert(option('i', "", "Let the command inherit the descriptors "
+                "above stderr"));
+    if (m_batch_allowed) {
+        opts.insert(option('j', "jobs", "Run up to this many checks in "
+                    "parallel in batch mode"));
+    }
+    opts.insert(option('l', "", "Forward the output of the command to "
+                "stderr while it runs"));
+    opts.insert(option('m', "size", "Only keep the first and last size "
+                "bytes of the output, plus its digest"));
+    if (m_batch_allowed)
+        opts.insert(option('r', "file", "Run as a server for the checks "
+                    "sent to the file given with -b and write the verdicts "
+                    "to file"));
+    opts.insert(option('t', "duration", "Kill the command and fail if it "
+                "runs for longer than this"));
+    opts.insert(option('w', "duration", "Fail if the command takes more "
+                "wall time than this"));
     opts.insert(option('x', "", "Execute command as a shell command"));
 
     return opts;
@@ -789,6 +1976,49 @@ atf_check::process_option(int ch, const char* arg)
         m_stderr_checks.push_back(parse_output_check_arg(arg));
         break;
 
+    case 'b':
+        m_bflag = arg;
+        break;
+
+    case 'c':
+        m_cflag = parse_duration(arg);
+        break;
+
+    case 'j':
+        try {
+            m_jobs = atf::text::to_type< size_t >(arg);
+        } catch (const std::runtime_error&) {
+            m_jobs = 0;
+        }
+        if (m_jobs == 0)
+            throw atf::application::usage_error("Invalid number of jobs %s",
+                                                arg);
+        break;
+
+    case 'i':
+        m_iflag = true;
+        break;
+
+    case 'l':
+        m_lflag = true;
+        break;
+
+    case 'm':
+        m_mflag = parse_size(arg);
+        break;
+
+    case 'r':
+        m_rflag = arg;
+        break;
+
+    case 't':
+        m_tflag = parse_duration(arg);
+        break;
+
+    case 'w':
+        m_wflag = parse_duration(arg);
+        break;
+
     case 'x':
         m_xflag = true;
         break;
@@ -801,13 +2031,46 @@ atf_check::process_option(int ch, const char* arg)
 int
 atf_check::main(void)
 {
+    if (!m_bflag.empty()) {
+        if (m_argc > 0 || !m_status_checks.empty() ||
+            !m_stdout_checks.empty() || !m_stderr_checks.empty() ||
+            m_lflag || m_mflag != 0 || m_iflag || m_xflag ||
+            timerisset(&m_tflag) ||
+            timerisset(&m_wflag) || timerisset(&m_cflag))
+            throw atf::application::usage_error("Checks must be given in "
+                                                "the batch file with -b");
+        if (!m_rflag.empty() && m_jobs > 1)
+            throw atf::application::usage_error("-j cannot be used with -r");
+        if (m_jobs == 0)
+            m_jobs = 1;
+        return m_rflag.empty() ? run_batch() : run_server();
+    } else if (m_jobs != 0)
+        throw atf::application::usage_error("-j requires -b");
+    else if (!m_rflag.empty())
+        throw atf::application::usage_error("-r requires -b");
+
     if (m_argc < 1)
         throw atf::application::usage_error("No command specified");
 
     int status = EXIT_FAILURE;
 
+    const ::timeval* timeout = timerisset(&m_tflag) ? &m_tflag : NULL;
+    const std::size_t limit = m_mflag;
+    const int keep =
+        (need_full_output(m_stdout_checks) ? ATF_CHECK_KEEP_STDOUT : 0) |
+        (need_full_output(m_stderr_checks) ? ATF_CHECK_KEEP_STDERR : 0) |
+        (m_iflag ? ATF_CHECK_INHERIT_FDS : 0);
     std::auto_ptr< atf::check::check_result > r =
-        m_xflag ? execute_with_shell(m_argv) : execute(m_argv);
+        m_xflag ? execute_with_shell(m_argv, m_lflag, timeout, limit, keep)
+                : execute(m_argv, m_lflag, timeout, limit, keep);
+
+    if (r->timedout()) {
+        std::cerr << "Fail: command timed out after "
+                  << format_duration(m_tflag) << "\n";
+        if (!m_lflag)
+            print_outputs(*r);
+        return EXIT_FAILURE;
+    }
 
     if (m_status_checks.empty())
         m_status_checks.push_back(status_check(sc_exit, false, EXIT_SUCCESS));
@@ -821,9 +2084,10 @@ atf_check::main(void)
     if (m_stderr_checks.empty())
         m_stderr_checks.push_back(output_check(oc_empty, false, ""));
 
-    if ((run_status_checks(m_status_checks, *r) == false) ||
+    if ((run_status_checks(m_status_checks, *r, m_lflag) == false) ||
         (run_output_checks(*r, "stderr") == false) ||
-        (run_output_checks(*r, "stdout") == false))
+        (run_output_checks(*r, "stdout") == false) ||
+        (run_time_checks(*r, m_wflag, m_cflag) == false))
         status = EXIT_FAILURE;
     else
         status = EXIT_SUCCESS;
@@ -834,5 +2098,5 @@ atf_check::main(void)
 int
 main(int argc, char* const* argv)
 {
-    return atf_check().run(argc, argv);
+    return atf_check(true).run(argc, argv);
 }
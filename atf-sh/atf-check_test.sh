@@ -198,6 +198,16 @@ oflag_file_body()
 
     dd if=/dev/urandom of=bin bs=1k count=10
     h_pass "cat bin" -o file:bin
+
+    dd if=/dev/urandom of=big bs=1k count=200
+    h_pass "cat big" -o file:big
+    h_fail "cat big; echo extra" -o file:big
+    h_fail "cat bin bin" -o file:bin
+
+    cp big big-modified
+    echo x | dd of=big-modified bs=1 seek=150000 conv=notrunc
+    cmp -s big big-modified && atf_fail "Failed to modify the test file"
+    h_fail "cat big-modified" -o file:big
 }
 
 atf_test_case oflag_inline
@@ -225,6 +235,8 @@ oflag_inline_body()
 
     h_fail "echo foo bar" -o inline:"foo bar"
     h_fail "echo -n foo bar" -o inline:"foo bar\n"
+    h_fail "echo foo baz" -o inline:"foo bar\n"
+    h_fail "true" -o inline:"foo bar\n"
 }
 
 atf_test_case oflag_match
@@ -251,6 +263,69 @@ oflag_save_body()
     h_pass "echo foo" -o save:out
     echo foo >exp
     cmp -s out exp || atf_fail "Saved output does not match expected results"
+
+    dd if=/dev/urandom of=big bs=1k count=200
+    h_pass "cat big" -o save:out
+    cmp -s out big || atf_fail "Saved output does not match expected results"
+
+    h_pass "true" -o save:out
+    if test -s out; then
+        atf_fail "Saved output was not truncated"
+    fi
+}
+
+atf_test_case oflag_digest
+oflag_digest_head()
+{
+    atf_set "descr" "Tests for the -o option using the 'digest:' and" \
+                    "'digestfile:' arguments"
+}
+oflag_digest_body()
+{
+    foo=b5bb9d8014a0f9b1d61e21e796d78dccdf1352f23cd32812f4850b878ae4944c
+
+    h_pass "echo foo" -o digest:sha256:${foo}
+    h_pass "echo foo" -o digest:sha256:$(echo ${foo} | tr a-f A-F)
+    h_pass "true" -o digest:sha256:e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855
+    h_fail "echo bar" -o digest:sha256:${foo}
+    h_fail "echo foo" -o not-digest:sha256:${foo}
+    h_pass "echo bar" -o not-digest:sha256:${foo}
+
+    echo ${foo} >digest
+    h_pass "echo foo" -o digestfile:digest
+    echo sha256:${foo} >digest
+    h_pass "echo foo" -o digestfile:digest
+    echo foo >golden
+    sha256sum golden >digest 2>/dev/null || echo "${foo}  golden" >digest
+    h_pass "echo foo" -o digestfile:digest
+    h_fail "echo bar" -o digestfile:digest
+
+    seq_cmd='i=1; while [ ${i} -le 10000 ]; do echo ${i}; i=$((${i} + 1)); done'
+    ( eval "${seq_cmd}" ) >golden
+    sha256sum golden >digest 2>/dev/null || \
+        atf_skip "sha256sum not available to compute a large digest"
+    h_pass "${seq_cmd}" -o digestfile:digest -o match:'^5000$'
+    h_pass "${seq_cmd}" -o save:saved -o digestfile:digest
+    cmp -s golden saved || atf_fail "save: did not store the full output"
+
+    h_fail "${seq_cmd}; echo extra" -o digestfile:digest
+    atf_check -o ignore grep '^Fail: stdout does not match expected digest$' tmp
+    atf_check -o ignore grep "^expected: sha256 $(cut -d ' ' -f 1 digest)\$" tmp
+    atf_check -o ignore grep '^stdout: 48900 bytes, sha256 [0-9a-f]*$' tmp
+    h_fail "${seq_cmd}; echo extra" -m 1k -o digestfile:digest
+    atf_check -o ignore grep '^\[\.\.\. [0-9]* bytes omitted \.\.\.\]$' tmp
+
+    # The output of a command that leaves a process behind is checked
+    # as soon as the command exits.
+    h_pass "(sleep 3; echo late) & echo foo" -o digest:sha256:${foo}
+
+    echo foo >digest
+    atf_check -s exit:1 -o ignore -e match:'Invalid digest in digest' \
+        ${Atf_Check} -o digestfile:digest echo foo
+    atf_check -s exit:1 -e match:"Unsupported digest algorithm 'md5'" \
+        ${Atf_Check} -o digest:md5:d3b07384d113edec49eaa6238ad5ff00 echo foo
+    atf_check -s exit:1 -e match:"Invalid digest 'sha256:abc'" \
+        ${Atf_Check} -o digest:sha256:abc echo foo
 }
 
 atf_test_case oflag_multiple
@@ -264,6 +339,9 @@ oflag_multiple_body()
     h_pass "echo foo; echo bar" -o match:foo -o match:bar
     h_fail "echo foo baz" -o match:bar -o match:foo
     h_fail "echo foo; echo baz" -o match:bar -o match:foo
+    h_pass "echo foo; echo bar" -o match:bar -o not-match:baz -o match:foo
+    h_fail "echo foo; echo bar" -o match:foo -o not-match:bar -o match:bar
+    h_pass "echo foo; echo bar" -o match:foo -o match:foo -e empty
 }
 
 atf_test_case oflag_negated
@@ -373,6 +451,25 @@ eflag_match_body()
     h_fail "echo foo bar 1>&2" -e "match:^bar"
 }
 
+atf_test_case eflag_digest
+eflag_digest_head()
+{
+    atf_set "descr" "Tests for the -e option using the 'digest:' and" \
+                    "'digestfile:' arguments"
+}
+eflag_digest_body()
+{
+    foo=b5bb9d8014a0f9b1d61e21e796d78dccdf1352f23cd32812f4850b878ae4944c
+
+    h_pass "echo foo 1>&2" -e digest:sha256:${foo}
+    h_fail "echo bar 1>&2" -e digest:sha256:${foo}
+    h_pass "echo bar 1>&2" -e not-digest:sha256:${foo}
+
+    echo sha256:${foo} >digest
+    h_pass "echo foo 1>&2" -e digestfile:digest
+    h_fail "echo bar 1>&2" -e digestfile:digest
+}
+
 atf_test_case eflag_multiple
 eflag_multiple_head()
 {
@@ -400,6 +497,274 @@ eflag_negated_body()
     h_fail "echo foo bar 1>&2" -e not-match:foo
 }
 
+atf_test_case iflag
+iflag_head()
+{
+    atf_set "descr" "Tests for the -i option"
+}
+iflag_body()
+{
+    ${Atf_Check} -x 'echo closed >&3' 3>out >stdout 2>stderr && \
+        atf_fail "The command inherited descriptor 3 without -i"
+    atf_check -o empty cat out
+
+    ${Atf_Check} -i -x 'echo inherited >&3' 3>out >stdout 2>stderr || \
+        atf_fail "The command did not inherit descriptor 3 with -i"
+    atf_check -o inline:'inherited\n' cat out
+}
+
+atf_test_case lflag
+lflag_head()
+{
+    atf_set "descr" "Tests for the -l option"
+}
+lflag_body()
+{
+    atf_check -o ignore -e match:'^foo$' -e match:'^bar$' \
+        ${Atf_Check} -l -o inline:'foo\n' -e inline:'bar\n' \
+        -x 'echo foo; echo bar 1>&2'
+
+    atf_check -s not-exit:0 -o ignore -e match:'^foo$' \
+        -e not-match:'^stdout:' ${Atf_Check} -l -o ignore -x 'echo foo; false'
+}
+
+atf_test_case mflag
+mflag_head()
+{
+    atf_set "descr" "Tests for the -m option"
+}
+mflag_body()
+{
+    seq_cmd='i=1; while [ ${i} -le 1000 ]; do echo ${i}; i=$((${i} + 1)); done'
+    ( eval "${seq_cmd}" ) >golden
+
+    atf_check -o ignore -e empty ${Atf_Check} -m 16 -o file:golden \
+        -x "${seq_cmd}"
+    atf_check -o ignore -e empty ${Atf_Check} -m 1k -o inline:'foo\n' \
+        -e empty echo foo
+    atf_check -o ignore -e empty ${Atf_Check} -m 16 -o match:'^999$' \
+        -o save:saved -x "${seq_cmd}"
+    cmp -s golden saved || atf_fail "save: did not store the full output"
+
+    atf_check -s not-exit:0 -o ignore -e save:stderr \
+        ${Atf_Check} -m 16 -x "${seq_cmd}; exit 1"
+    atf_check -o ignore grep '^Fail: incorrect exit status' stderr
+    atf_check -o ignore \
+        grep '^stdout: 3893 bytes, 1000 lines, sha256 [0-9a-f]\{64\}$' stderr
+    atf_check -o ignore grep '^\[\.\.\. 3861 bytes omitted \.\.\.\]$' stderr
+    atf_check -o ignore grep '^999$' stderr
+    if grep '^500$' stderr >/dev/null; then
+        atf_fail "Output not bounded in failure report"
+    fi
+
+    echo extra >>golden
+    atf_check -s not-exit:0 -o ignore \
+        -e match:'^Fail: stdout does not match golden output$' \
+        -e match:'^golden: 3899 bytes, sha256 ' \
+        ${Atf_Check} -m 16 -o file:golden -x "${seq_cmd}"
+    atf_check -s not-exit:0 -o ignore \
+        -e match:'^expected: 4 bytes, sha256 ' \
+        ${Atf_Check} -m 16 -o inline:'bar\n' echo foo
+
+    for s in 0 abc 1x 2kk; do
+        atf_check -s exit:1 -e match:"Invalid size '${s}'" \
+            ${Atf_Check} -m "${s}" true
+    done
+}
+
+atf_test_case tflag
+tflag_head()
+{
+    atf_set "descr" "Tests for the -t option"
+}
+tflag_body()
+{
+    atf_check -o ignore -e empty ${Atf_Check} -t 30 -o inline:'foo\n' \
+        echo foo
+    atf_check -o ignore -e empty ${Atf_Check} -t 500ms -s exit:1 false
+
+    atf_check -s not-exit:0 -o ignore \
+        -e match:'^Fail: command timed out after 0.500s$' \
+        -e match:'^started$' \
+        ${Atf_Check} -t 0.5 -o ignore -e ignore \
+        -x '(sleep 2; touch grandchild) & echo started >&2; sleep 30'
+    sleep 3
+    test ! -f grandchild || atf_fail "Descendants of the command not killed"
+
+    atf_check -s not-exit:0 -o ignore -e match:'timed out' \
+        -e not-match:'^stdout:' ${Atf_Check} -l -t 100ms sleep 30
+
+    for d in 0 0ms 1.x abc -1 .5; do
+        atf_check -s exit:1 -e match:"Invalid duration '${d}'" \
+            ${Atf_Check} -t "${d}" true
+    done
+}
+
+atf_test_case wflag
+wflag_head()
+{
+    atf_set "descr" "Tests for the -w option"
+}
+wflag_body()
+{
+    atf_check -o ignore -e empty ${Atf_Check} -w 30s sleep 1
+    atf_check -s not-exit:0 -o ignore \
+        -e match:'^Fail: command used too much wall time: 1\.[0-9]{3}s, maximum: 0\.100s$' \
+        ${Atf_Check} -w 100ms sleep 1
+}
+
+atf_test_case cflag
+cflag_head()
+{
+    atf_set "descr" "Tests for the -c option"
+}
+cflag_body()
+{
+    atf_check -o ignore -e empty ${Atf_Check} -c 30 sleep 1
+    atf_check -s not-exit:0 -o ignore \
+        -e match:'^Fail: command used too much CPU time: .*, maximum: 0\.001s$' \
+        ${Atf_Check} -c 1ms -x \
+        'i=0; while [ ${i} -lt 100000 ]; do i=$((${i} + 1)); done'
+}
+
+atf_test_case bflag
+bflag_head()
+{
+    atf_set "descr" "Tests for the -b option"
+}
+bflag_body()
+{
+    printf '%s\0' 1 true 4 -o inline:'foo bar\n' echo 'foo bar' >checks
+    printf '%s\0' 3 -s exit:1 false 2 echo foo 1 cat >>checks
+    printf '%s\0' 4 -s signal:kill -x 'kill -9 $$' >>checks
+
+    cat >expout <<EOF
+Executing command [ true ]
+check 1: passed
+Executing command [ echo foo bar ]
+check 2: passed
+Executing command [ false ]
+check 3: passed
+Executing command [ echo foo ]
+check 4: failed
+Executing command [ cat ]
+check 5: passed
+Executing command [ ${Atf_Shell} -c kill -9 \$\$ ]
+check 6: passed
+EOF
+    atf_check -s exit:1 -o file:expout -e match:'^Fail: stdout not empty' \
+        ${Atf_Check} -b checks
+    atf_check -s exit:1 -o file:expout -e match:'^Fail: stdout not empty' \
+        -x "${Atf_Check} -b - <checks"
+
+    printf '%s\0' 1 true 1 true >checks
+    atf_check -o match:'check 2: passed' ${Atf_Check} -b checks
+
+    printf '%s\0' 2 -z true >checks
+    atf_check -s exit:1 -o match:'check 1: failed' \
+        -e match:'Unknown option -z' ${Atf_Check} -b checks
+    printf '%s\0' 2 -b checks >checks
+    atf_check -s exit:1 -o match:'check 1: failed' \
+        -e match:'Unknown option -b' ${Atf_Check} -b checks
+
+    printf '%s\0' 3 true >checks
+    atf_check -s exit:1 -o ignore -e match:'Unexpected end of input' \
+        ${Atf_Check} -b checks
+    printf '%s\0' foo >checks
+    atf_check -s exit:1 -e match:"Invalid argument count 'foo'" \
+        ${Atf_Check} -b checks
+
+    atf_check -s exit:1 -e match:'Checks must be given in the batch file' \
+        ${Atf_Check} -b checks -o empty
+    atf_check -s exit:1 -e match:'Checks must be given in the batch file' \
+        ${Atf_Check} -b checks true
+}
+
+atf_test_case jflag
+jflag_head()
+{
+    atf_set "descr" "Tests for the -j option"
+}
+jflag_body()
+{
+    for i in 1 2 3 4; do
+        printf '%s\0' 4 -o inline:"${i}\n" -x "sleep 1; echo ${i}" >>checks
+    done
+
+    cat >expout <<EOF
+Executing command [ ${Atf_Shell} -c sleep 1; echo 1 ]
+check 1: passed
+Executing command [ ${Atf_Shell} -c sleep 1; echo 2 ]
+check 2: passed
+Executing command [ ${Atf_Shell} -c sleep 1; echo 3 ]
+check 3: passed
+Executing command [ ${Atf_Shell} -c sleep 1; echo 4 ]
+check 4: passed
+EOF
+    start=$(date +%s)
+    atf_check -o file:expout ${Atf_Check} -b checks -j 4
+    end=$(date +%s)
+    [ $((end - start)) -lt 4 ] || atf_fail "Checks did not run in parallel"
+
+    atf_check -s exit:1 -e match:'-j requires -b' ${Atf_Check} -j 2 true
+    atf_check -s exit:1 -e match:'Invalid number of jobs 0' \
+        ${Atf_Check} -b checks -j 0
+}
+
+atf_test_case rflag
+rflag_head()
+{
+    atf_set "descr" "Tests for the -r option"
+}
+rflag_body()
+{
+    mkdir dir
+    printf '%s\0' "$(pwd)/dir" 0027 "export FOO='a b'
+declare -x BAR=\$'x\\ty' BAZ" 3 -o match:'/dir$' pwd >requests
+    printf '%s\0' "$(pwd)" 0027 "" 4 -o inline:'0027\n' -x umask >>requests
+    printf '%s\0' "$(pwd)" 0022 "export FOO='a b'
+declare -x BAR=\$'x\\ty' BAZ" 4 -o inline:'a b|x\ty|unset\n' -x \
+        'echo "${FOO}|${BAR}|${BAZ-unset}"' >>requests
+    printf '%s\0' "$(pwd)" 0022 "" 3 -o inline:'in\n' cat >>requests
+    printf '%s\0' "$(pwd)" 0022 "" 1 false >>requests
+
+    echo in | atf_check -s exit:1 -o match:'Executing command.*pwd' \
+        -o match:'Executing command.*false' -e match:'Fail' \
+        ${Atf_Check} -b requests -r replies
+    cat >expout <<EOF
+check 1: passed
+check 2: passed
+check 3: passed
+check 4: passed
+check 5: failed
+EOF
+    atf_check -o file:expout cat replies
+
+    mkfifo fifo_requests fifo_replies
+    ${Atf_Check} -b fifo_requests -r fifo_replies &
+    pid=${!}
+    printf '%s\0' "$(pwd)" 0022 "" 1 true >fifo_requests
+    read verdict <fifo_replies
+    atf_check_equal 'check 1: passed' "${verdict}"
+    printf '%s\0' "$(pwd)" 0022 "" 1 false >fifo_requests
+    read verdict <fifo_replies
+    atf_check_equal 'check 2: failed' "${verdict}"
+    kill ${pid}
+    wait ${pid} || true
+
+    printf '%s\0' "$(pwd)" 0022 >requests
+    atf_check -s exit:1 -e match:'Unexpected end of input' \
+        ${Atf_Check} -b requests -r replies
+    printf '%s\0' "$(pwd)" 9999 "" 1 true >requests
+    atf_check -s exit:1 -e match:"Invalid umask '9999'" \
+        ${Atf_Check} -b requests -r replies
+
+    atf_check -s exit:1 -e match:'-r requires -b' \
+        ${Atf_Check} -r replies true
+    atf_check -s exit:1 -e match:'-j cannot be used with -r' \
+        ${Atf_Check} -b requests -r replies -j 2
+}
+
 atf_test_case stdin
 stdin_head()
 {
@@ -443,6 +808,7 @@ atf_init_test_cases()
     atf_add_test_case oflag_inline
     atf_add_test_case oflag_match
     atf_add_test_case oflag_save
+    atf_add_test_case oflag_digest
     atf_add_test_case oflag_multiple
     atf_add_test_case oflag_negated
 
@@ -452,9 +818,21 @@ atf_init_test_cases()
     atf_add_test_case eflag_inline
     atf_add_test_case eflag_match
     atf_add_test_case eflag_save
+    atf_add_test_case eflag_digest
     atf_add_test_case eflag_multiple
     atf_add_test_case eflag_negated
 
+    atf_add_test_case iflag
+    atf_add_test_case lflag
+    atf_add_test_case mflag
+    atf_add_test_case tflag
+    atf_add_test_case wflag
+    atf_add_test_case cflag
+
+    atf_add_test_case bflag
+    atf_add_test_case jflag
+    atf_add_test_case rflag
+
     atf_add_test_case stdin
 
     atf_add_test_case invalid_umask
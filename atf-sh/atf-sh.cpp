@@ -27,18 +27,36 @@
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+#if defined(HAVE_CONFIG_H)
+#include "bconfig.h"
+#endif
+
 extern "C" {
+#include <sys/stat.h>
+
 #include <unistd.h>
 }
 
+#include <cctype>
 #include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <utility>
+#include <vector>
 
-#include "atf-c++/config.hpp"
+extern "C" {
+#include "atf-c/config.h"
+#include "atf-c/detail/sha256.h"
+}
 
 #include "atf-c++/detail/application.hpp"
+#include "atf-c++/detail/env.hpp"
+#include "atf-c++/detail/exceptions.hpp"
 #include "atf-c++/detail/fs.hpp"
 #include "atf-c++/detail/sanity.hpp"
 
@@ -59,37 +77,467 @@ fix_plain_name(const char *filename)
         return std::string(filename);
 }
 
+// The maximum size of the static heads passed in the command line of the
+// shell, which must stay well below the limits of the system.
+const std::string::size_type max_inline_heads = 64 * 1024;
+
+// Characters that can appear unquoted in the arguments to atf_set of a
+// head that is parsed statically.
+const char* const bare_chars =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_./:=+,@%-";
+
+static
+std::string
+shell_quote(const std::string& str)
+{
+    std::string quoted = "'";
+    for (std::string::const_iterator iter = str.begin(); iter != str.end();
+         ++iter) {
+        if (*iter == '\'')
+            quoted += "'\\''";
+        else
+            quoted += *iter;
+    }
+    return quoted + "'";
+}
+
+static
+bool
+is_identifier_char(const char ch)
+{
+    return std::isalnum(static_cast< unsigned char >(ch)) || ch == '_';
+}
+
+static
+std::string
+trim(const std::string& str)
+{
+    const std::string::size_type begin = str.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+        return "";
+    const std::string::size_type end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1);
+}
+
+// Splits a line into words following the quoting rules of the shell, but
+// only for the constructs whose meaning does not depend on the state of the
+// shell.  Returns false if the line contains anything else.
+static
+bool
+split_static_words(const std::string& line, std::vector< std::string >& words)
+{
+    std::string::size_type pos = 0;
+    for (;;) {
+        while (pos < line.length() && (line[pos] == ' ' || line[pos] == '\t'))
+            pos++;
+        if (pos == line.length())
+            return true;
+
+        std::string word;
+        while (pos < line.length() && line[pos] != ' ' && line[pos] != '\t') {
+            const char ch = line[pos];
+            if (ch == '\'') {
+                const std::string::size_type end = line.find('\'', pos + 1);
+                if (end == std::string::npos)
+                    return false;
+                word += line.substr(pos + 1, end - pos - 1);
+                pos = end + 1;
+            } else if (ch == '"') {
+                const std::string::size_type end =
+                    line.find_first_of("\"$`\\", pos + 1);
+                if (end == std::string::npos || line[end] != '"')
+                    return false;
+                word += line.substr(pos + 1, end - pos - 1);
+                pos = end + 1;
+            } else if (ch != '\0' && std::strchr(bare_chars, ch) != NULL) {
+                word += ch;
+                pos++;
+            } else
+                return false;
+        }
+        words.push_back(word);
+    }
+}
+
+// Parses the body of a head and returns the lines that listing its test
+// case prints for the variables it sets, in the same format and order as
+// _atf_list_tcs.  Returns false if the body does anything other than
+// calling atf_set with constant arguments, or if the values would not be
+// printed verbatim.
+static
+bool
+parse_static_head(const std::vector< std::string >& body,
+                  std::vector< std::string >& lines)
+{
+    std::vector< std::pair< std::string, std::string > > vars;
+    std::map< std::string, std::string > values;
+
+    for (std::vector< std::string >::const_iterator iter = body.begin();
+         iter != body.end(); ++iter) {
+        const std::string line = trim(*iter);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::vector< std::string > words;
+        if (!split_static_words(line, words) || words.size() < 2 ||
+            words[0] != "atf_set")
+            return false;
+
+        const std::string& name = words[1];
+        if (name.empty() || name == "ident" || name == "has.cleanup" ||
+            name.find_first_not_of(bare_chars) != std::string::npos ||
+            name.find_first_of(",/:=+@%") != std::string::npos)
+            return false;
+
+        // atf_get prints the value through an unquoted echo, so mimic the
+        // field splitting and give up on anything that the shell or echo
+        // could expand.
+        std::string value;
+        for (std::vector< std::string >::size_type i = 2; i < words.size();
+             i++) {
+            std::istringstream fields(words[i]);
+            std::string field;
+            while (fields >> field) {
+                if (!value.empty())
+                    value += ' ';
+                value += field;
+            }
+        }
+        if (value.find_first_of("*?[\\") != std::string::npos ||
+            (!value.empty() && value[0] == '-'))
+            return false;
+
+        std::string normalized = name;
+        for (std::string::iterator iter2 = normalized.begin();
+             iter2 != normalized.end(); ++iter2) {
+            if (*iter2 == '.' || *iter2 == '-')
+                *iter2 = '_';
+        }
+        vars.push_back(std::make_pair(name, normalized));
+        values[normalized] = value;
+    }
+
+    for (std::vector< std::pair< std::string, std::string > >::const_iterator
+         iter = vars.begin(); iter != vars.end(); ++iter)
+        lines.push_back((*iter).first + ": " + values[(*iter).second]);
+    return true;
+}
+
+// Recognizes the definition of a head at the beginning of a line and
+// returns the name of its test case and whether the opening brace of its
+// body is on the same line.
+static
+bool
+head_definition(const std::string& line, std::string& tcname, bool& brace)
+{
+    std::string::size_type pos = 0;
+    while (pos < line.length() && is_identifier_char(line[pos]))
+        pos++;
+
+    const std::string suffix = "_head";
+    if (pos <= suffix.length() ||
+        line.compare(pos - suffix.length(), suffix.length(), suffix) != 0)
+        return false;
+    tcname = line.substr(0, pos - suffix.length());
+
+    std::string rest = trim(line.substr(pos));
+    if (rest.compare(0, 1, "(") != 0)
+        return false;
+    rest = trim(rest.substr(1));
+    if (rest.compare(0, 1, ")") != 0)
+        return false;
+    rest = trim(rest.substr(1));
+    brace = rest == "{";
+    return brace || rest.empty();
+}
+
+// Generates shell code that describes the heads of the test program that
+// can be listed without running them.
+//
+// For every head that only calls atf_set with constant arguments, this
+// defines a function that prints the variables of its test case as
+// _atf_list_tcs would.  Heads that are defined more than once, inside other
+// constructs or with any dynamic content are left out so that they are
+// executed as usual.
+static
+std::string
+static_heads(const atf::fs::path& program)
+{
+    std::ifstream is(program.c_str());
+    if (!is)
+        return "";
+
+    std::vector< std::string > lines;
+    std::string line;
+    while (std::getline(is, line))
+        lines.push_back(line);
+
+    std::map< std::string, int > definitions;
+    std::vector< std::pair< std::string, std::vector< std::string > > > heads;
+    for (std::vector< std::string >::size_type i = 0; i < lines.size(); i++) {
+        std::string tcname;
+        bool brace;
+        if (!head_definition(trim(lines[i]), tcname, brace))
+            continue;
+
+        definitions[tcname]++;
+        if (lines[i] != trim(lines[i]))
+            definitions[tcname]++;  // Nested definitions are never static.
+
+        std::vector< std::string >::size_type j = i + 1;
+        if (!brace) {
+            while (j < lines.size() && trim(lines[j]).empty())
+                j++;
+            if (j == lines.size() || trim(lines[j]) != "{")
+                continue;
+            j++;
+        }
+
+        std::vector< std::string > body;
+        while (j < lines.size() && trim(lines[j]) != "}")
+            body.push_back(lines[j++]);
+        if (j == lines.size())
+            continue;
+
+        std::vector< std::string > output;
+        if (parse_static_head(body, output))
+            heads.push_back(std::make_pair(tcname, output));
+    }
+
+    std::string code;
+    for (std::vector< std::pair< std::string, std::vector< std::string > > >
+         ::const_iterator iter = heads.begin(); iter != heads.end(); ++iter) {
+        if (definitions[(*iter).first] != 1)
+            continue;
+
+        code += "__static_head_" + (*iter).first + "=true ; ";
+        code += "_atf_static_head_" + (*iter).first + "() { : ; ";
+        for (std::vector< std::string >::const_iterator iter2 =
+             (*iter).second.begin(); iter2 != (*iter).second.end(); ++iter2)
+            code += "echo " + shell_quote(*iter2) + " ; ";
+        code += "} ; ";
+    }
+    return code;
+}
+
+// The configuration values needed to run a test program, which are looked up
+// only once per execution.
+struct script_config {
+    const std::string libexecdir;
+    const std::string pkgdatadir;
+    const std::string shell;
+
+    script_config(void) :
+        libexecdir(atf_config_get("atf_libexecdir")),
+        pkgdatadir(atf_config_get("atf_pkgdatadir")),
+        shell(atf_config_get("atf_shell"))
+    {
+    }
+};
+
 static
 std::string*
-construct_script(const char* filename)
+construct_script(const script_config& config, const char* filename)
 {
-    const std::string libexecdir = atf::config::get("atf_libexecdir");
-    const std::string pkgdatadir = atf::config::get("atf_pkgdatadir");
-    const std::string shell = atf::config::get("atf_shell");
+    const std::string& libexecdir = config.libexecdir;
+    const std::string& pkgdatadir = config.pkgdatadir;
+    const std::string& shell = config.shell;
+
+    std::string heads = static_heads(atf::fs::path(filename));
+    if (heads.length() > max_inline_heads)
+        heads.clear();
 
     std::string* command = new std::string();
-    command->reserve(512);
+    command->reserve(512 + heads.length());
     (*command) += ("Atf_Check='" + libexecdir + "/atf-check' ; " +
                    "Atf_Shell='" + shell + "' ; " +
                    ". " + pkgdatadir + "/libatf-sh.subr ; " +
                    ". " + fix_plain_name(filename) + " ; " +
+                   heads +
                    "main \"${@}\"");
     return command;
 }
 
+// Describes the state of a file that is part of a cached script, so that
+// the cached copy can be discarded when the file changes.  The change time
+// catches modifications that restore the modification time, and both
+// times include their nanoseconds where available so that quick
+// successive edits are not missed.
+static
+std::string
+file_stamp(const atf::fs::path& p, const struct stat& sb)
+{
+    std::ostringstream stamp;
+    stamp << p.str() << ":" << sb.st_dev << ":" << sb.st_ino << ":"
+          << sb.st_size << ":" << sb.st_mtime;
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+    stamp << "." << sb.st_mtim.tv_nsec;
+#endif
+    stamp << ":" << sb.st_ctime;
+#if defined(HAVE_STRUCT_STAT_ST_CTIM)
+    stamp << "." << sb.st_ctim.tv_nsec;
+#endif
+    return stamp.str();
+}
+
+static
+void
+append_file(std::ostream& os, const atf::fs::path& p)
+{
+    std::ifstream is(p.c_str());
+    if (!is)
+        throw std::runtime_error("Cannot open " + p.str());
+
+    std::string line;
+    while (std::getline(is, line))
+        os << line << "\n";
+}
+
+// Returns an executable script that combines the atf-sh library with the
+// test program in 'filename', whose status is given in 'program_sb', so
+// that the shell does not have to locate and load them separately on every
+// execution.
+//
+// The script is stored in 'cachedir' under a name derived from the absolute
+// path of the test program.  Its second line records the state of its
+// inputs and the configuration used to generate it, and the script is
+// regenerated whenever these do not match the current ones.  Because the
+// script is executed directly, it sets the name and the directory of the
+// test program that the library would otherwise derive from $0.
+static
+atf::fs::path
+cached_script(const std::string& cachedir, const script_config& config,
+              const char* filename, const struct stat& program_sb)
+{
+    const atf::fs::path program = atf::fs::path(filename).to_absolute();
+    const atf::fs::path library = atf::fs::path(config.pkgdatadir) /
+        "libatf-sh.subr";
+
+    struct stat library_sb;
+    if (::stat(library.c_str(), &library_sb) == -1)
+        throw atf::system_error("atf_sh::cached_script",
+                                "Cannot stat " + library.str(), errno);
+
+    const std::string interpreter = "#! " + config.shell;
+    const std::string header = "# atf-sh cache: " +
+        file_stamp(library, library_sb) + " " +
+        file_stamp(program, program_sb) + " " + config.libexecdir + " " +
+        config.shell;
+
+    atf_sha256_t sha256;
+    atf_sha256_init(&sha256);
+    atf_sha256_update(&sha256, program.c_str(), program.str().length());
+    char hex[ATF_SHA256_HEX_LENGTH + 1];
+    atf_sha256_final_hex(&sha256, hex);
+    const atf::fs::path cached = atf::fs::path(cachedir) /
+        (std::string(hex) + ".sh");
+
+    {
+        std::ifstream is(cached.c_str());
+        std::string line1, line2;
+        if (is && std::getline(is, line1) && line1 == interpreter &&
+            std::getline(is, line2) && line2 == header)
+            return cached;
+    }
+
+    if (::mkdir(cachedir.c_str(), 0755) == -1 && errno != EEXIST)
+        throw atf::system_error("atf_sh::cached_script",
+                                "Cannot create " + cachedir, errno);
+
+    // Write the new script aside and rename it into place so that
+    // concurrent executions of the test program never see a partial copy.
+    std::ostringstream tmpname;
+    tmpname << cached.str() << ".tmp." << ::getpid();
+    const std::string tmp = tmpname.str();
+    {
+        std::ofstream os(tmp.c_str());
+        if (!os)
+            throw std::runtime_error("Cannot create " + tmp);
+
+        os << interpreter << "\n";
+        os << header << "\n";
+        os << "Atf_Check='" << config.libexecdir << "/atf-check'\n";
+        os << "Atf_Shell='" << config.shell << "'\n";
+        append_file(os, library);
+        os << "Prog_Name=" << shell_quote(program.leaf_name()) << "\n";
+        os << "Source_Dir=" << shell_quote(program.branch_path().str())
+           << "\n";
+        append_file(os, program);
+        os << static_heads(program) << "\n";
+        os << "main \"${@}\"\n";
+
+        os.close();
+        if (!os) {
+            ::unlink(tmp.c_str());
+            throw std::runtime_error("Cannot write " + tmp);
+        }
+    }
+    if (::chmod(tmp.c_str(), 0755) == -1) {
+        const int original_errno = errno;
+        ::unlink(tmp.c_str());
+        throw atf::system_error("atf_sh::cached_script",
+                                "Cannot make " + tmp + " executable",
+                                original_errno);
+    }
+    if (std::rename(tmp.c_str(), cached.c_str()) == -1) {
+        const int original_errno = errno;
+        ::unlink(tmp.c_str());
+        throw atf::system_error("atf_sh::cached_script",
+                                "Cannot rename " + tmp, original_errno);
+    }
+
+    return cached;
+}
+
+// Executes the cached combined script for the test program if
+// ATF_SH_CACHEDIR is set.  Only returns if the cache cannot be used.
+static
+void
+exec_cached(const script_config& config, const int interpreter_argc,
+            const char* const* interpreter_argv,
+            const struct stat& program_sb)
+{
+    PRE(interpreter_argc >= 1);
+
+    if (!atf::env::has("ATF_SH_CACHEDIR"))
+        return;
+    const std::string cachedir = atf::env::get("ATF_SH_CACHEDIR");
+    if (cachedir.empty())
+        return;
+
+    try {
+        const atf::fs::path cached = cached_script(cachedir, config,
+                                                   interpreter_argv[0],
+                                                   program_sb);
+
+        const char** argv = new const char*[interpreter_argc + 1];
+        argv[0] = cached.c_str();
+        for (int i = 1; i < interpreter_argc; i++)
+            argv[i] = interpreter_argv[i];
+        argv[interpreter_argc] = NULL;
+
+        (void)execv(cached.c_str(), const_cast< char** >(argv));
+        delete [] argv;
+    } catch (const std::runtime_error&) {
+    }
+    // The cache is only an optimization: if it cannot be used, just run
+    // the test program in the regular way.
+}
+
 static
 const char**
-construct_argv(const std::string& shell, const int interpreter_argc,
+construct_argv(const script_config& config, const int interpreter_argc,
                const char* const* interpreter_argv)
 {
     PRE(interpreter_argc >= 1);
     PRE(interpreter_argv[0] != NULL);
 
-    const std::string* script = construct_script(interpreter_argv[0]);
+    const std::string* script = construct_script(config,
+                                                 interpreter_argv[0]);
 
     const int count = 4 + (interpreter_argc - 1) + 1;
     const char** argv = new const char*[count];
-    argv[0] = shell.c_str();
+    argv[0] = config.shell.c_str();
     argv[1] = "-c";
     argv[2] = script->c_str();
     argv[3] = interpreter_argv[0];
@@ -133,19 +581,26 @@ atf_sh::main(void)
         throw atf::application::usage_error("No test program provided");
 
     const atf::fs::path script(m_argv[0]);
-    if (!atf::fs::exists(script))
-        throw std::runtime_error("The test program '" + script.str() + "' "
-                                 "does not exist");
+    struct stat sb;
+    if (::stat(script.c_str(), &sb) == -1) {
+        if (errno == ENOENT)
+            throw std::runtime_error("The test program '" + script.str() +
+                                     "' does not exist");
+        throw atf::system_error("atf_sh::main", "Cannot stat " +
+                                script.str(), errno);
+    }
+
+    const script_config config;
+    exec_cached(config, m_argc, m_argv, sb);
 
-    const std::string shell = atf::config::get("atf_shell");
-    const char** argv = construct_argv(shell, m_argc, m_argv);
+    const char** argv = construct_argv(config, m_argc, m_argv);
     // Don't bother keeping track of the memory allocated by construct_argv:
     // we are going to exec or die immediately.
 
-    const int ret = execv(shell.c_str(), const_cast< char** >(argv));
+    const int ret = execv(config.shell.c_str(), const_cast< char** >(argv));
     INV(ret == -1);
-    std::cerr << "Failed to execute " << shell << ": " << std::strerror(errno)
-              << "\n";
+    std::cerr << "Failed to execute " << config.shell << ": "
+              << std::strerror(errno) << "\n";
     return EXIT_FAILURE;
 }
 
@@ -144,6 +144,102 @@ null_stderr_body()
         atf_fail "atf_check does not print stderr's contents"
 }
 
+atf_test_case batch
+batch_head()
+{
+    atf_set "descr" "Verifies that atf_check_batch_add and" \
+                    "atf_check_batch_run work"
+}
+batch_body()
+{
+    h="$(atf_get_srcdir)/misc_helpers -s $(atf_get_srcdir)"
+
+    atf_check -s eq:0 -o save:stdout -e ignore -x "${h} atf_check_batch_ok"
+    for i in 1 2 3; do
+        grep "^check ${i}: passed" stdout >/dev/null || \
+            atf_fail "atf_check_batch_run did not run check ${i}"
+    done
+    grep '^Batch done' stdout >/dev/null || \
+        atf_fail "atf_check_batch_run failed with an empty batch"
+
+    atf_check -s eq:1 -o save:stdout -e save:stderr -x \
+        "${h} -r resfile atf_check_batch_fail"
+    grep '^check 2: failed' stdout >/dev/null || \
+        atf_fail "atf_check_batch_run did not report the failed check"
+    grep 'Not reached' stdout >/dev/null && \
+        atf_fail "atf_check_batch_run did not abort the test case"
+    grep '^failed: atf-check failed' resfile >/dev/null || \
+        atf_fail "atf_check_batch_run did not fail the test case"
+    grep 'stdout not empty' stderr >/dev/null || \
+        atf_fail "atf_check_batch_run does not print the failure details"
+}
+
+atf_test_case server
+server_head()
+{
+    atf_set "descr" "Verifies that atf_check keeps its semantics when" \
+                    "running checks through the atf-check server"
+}
+server_body()
+{
+    h="$(atf_get_srcdir)/misc_helpers -s $(atf_get_srcdir)"
+
+    atf_check -s eq:1 -o save:stdout -e save:stderr -x \
+        "${h} -r resfile atf_check_server"
+    if [ -d /proc/self/fd ]; then
+        grep '^Server: [0-9][0-9]*$' stdout >/dev/null || \
+            atf_fail "atf_check did not start the server"
+    fi
+    grep '^Checks done' stdout >/dev/null || \
+        atf_fail "atf_check failed to run checks through the server"
+    grep 'Executing command.*false' stdout >/dev/null || \
+        atf_fail "atf_check does not print an informative message"
+    grep 'Not reached' stdout >/dev/null && \
+        atf_fail "atf_check did not abort the test case"
+    grep '^failed: atf-check failed' resfile >/dev/null || \
+        atf_fail "atf_check did not fail the test case"
+}
+
+atf_test_case server_bypass
+server_bypass_head()
+{
+    atf_set "descr" "Verifies that atf_check executes atf-check directly" \
+                    "when the server could change the behavior of a check"
+}
+server_bypass_body()
+{
+    h="$(atf_get_srcdir)/misc_helpers -s $(atf_get_srcdir)"
+
+    atf_check -s eq:0 -o save:stdout -e ignore -x \
+        "${h} atf_check_server_bypass"
+    grep '^Checks done' stdout >/dev/null || \
+        atf_fail "atf_check failed to run the checks"
+
+    pid=$(sed -n 's/^Server: //p' stdout)
+    if [ -n "${pid}" -a "${pid}" != none ]; then
+        kill -0 "${pid}" 2>/dev/null && \
+            atf_fail "The atf-check server outlived the test case"
+    fi
+    true
+}
+
+atf_test_case process_state
+process_state_head()
+{
+    atf_set "descr" "Verifies that the checks run by atf_check inherit" \
+                    "the ignored signals and exported functions of the" \
+                    "shell"
+}
+process_state_body()
+{
+    h="$(atf_get_srcdir)/misc_helpers -s $(atf_get_srcdir)"
+
+    atf_check -s eq:0 -o save:stdout -e ignore -x \
+        "${h} atf_check_process_state"
+    grep '^Checks done' stdout >/dev/null || \
+        atf_fail "atf_check failed to run the checks"
+}
+
 atf_test_case equal
 equal_head()
 {
@@ -190,6 +286,10 @@ atf_init_test_cases()
     atf_add_test_case experr_mismatch
     atf_add_test_case null_stdout
     atf_add_test_case null_stderr
+    atf_add_test_case batch
+    atf_add_test_case server
+    atf_add_test_case server_bypass
+    atf_add_test_case process_state
     atf_add_test_case equal
     atf_add_test_case flush_stdout_on_timeout
 }
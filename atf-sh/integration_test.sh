@@ -81,11 +81,163 @@ EOF
     atf_check -s eq:0 -o file:expout -e empty atf-sh tp ' hello bye ' 'foo bar'
 }
 
+atf_test_case cache
+cache_body()
+{
+    create_test_program tp <<EOF
+main() {
+    echo "first \${#}"
+}
+EOF
+
+    mkdir cache
+    atf_check -s eq:0 -o inline:'first 2\n' -e empty \
+        env ATF_SH_CACHEDIR="$(pwd)/cache" ./tp a b
+    atf_check -s eq:0 -o inline:'1\n' -e empty -x 'ls cache | wc -l | tr -d " "'
+    atf_check -s eq:0 -o ignore -e empty grep '^main() {$' cache/*.sh
+    test -x cache/*.sh || atf_fail "The cached script is not executable"
+
+    cached=$(echo cache/*.sh)
+    sed -e 's,echo "first,echo "cached,' "${cached}" >tmp
+    cat tmp >"${cached}"
+    atf_check -s eq:0 -o inline:'cached 0\n' -e empty \
+        env ATF_SH_CACHEDIR="$(pwd)/cache" ./tp
+
+    create_test_program tp <<EOF
+main() {
+    echo "second \${#}"
+}
+EOF
+    atf_check -s eq:0 -o inline:'second 1\n' -e empty \
+        env ATF_SH_CACHEDIR="$(pwd)/cache" ./tp a
+    atf_check -s eq:0 -o inline:'1\n' -e empty -x 'ls cache | wc -l | tr -d " "'
+
+    # Changes within the same second that keep the size of the program
+    # must be noticed too.
+    sed -e 's,second,thirdd,' tp >tmp
+    cat tmp >tp
+    atf_check -s eq:0 -o inline:'thirdd 0\n' -e empty \
+        env ATF_SH_CACHEDIR="$(pwd)/cache" ./tp
+
+    touch file
+    atf_check -s eq:0 -o inline:'thirdd 0\n' -e empty \
+        env ATF_SH_CACHEDIR="$(pwd)/file/cache" ./tp
+}
+
+atf_test_case static_heads
+static_heads_body()
+{
+    create_test_program tp <<EOF
+atf_test_case simple cleanup
+simple_head()
+{
+    # A comment.
+    atf_set "descr" 'Simple   test'  "with words"
+    atf_set require.progs /bin/ls
+    atf_set descr "Final 'description'"
+}
+simple_body() { :; }
+simple_cleanup() { :; }
+
+atf_test_case dynamic
+dynamic_head()
+{
+    atf_set descr "Value \$(echo computed)"
+}
+dynamic_body() { :; }
+
+atf_test_case nohead
+nohead_body() { :; }
+
+atf_init_test_cases()
+{
+    atf_add_test_case simple
+    atf_add_test_case dynamic
+    atf_add_test_case nohead
+}
+EOF
+
+    cat >expout <<EOF
+Content-Type: application/X-atf-tp; version="1"
+
+ident: simple
+has.cleanup: true
+descr: Final 'description'
+require.progs: /bin/ls
+descr: Final 'description'
+
+ident: dynamic
+descr: Value computed
+
+ident: nohead
+EOF
+    atf_check -s eq:0 -o file:expout -e empty ./tp -l
+
+    mkdir cache
+    atf_check -s eq:0 -o file:expout -e empty \
+        env ATF_SH_CACHEDIR="$(pwd)/cache" ./tp -l
+    atf_check -s eq:0 -o ignore -e empty \
+        grep '_atf_static_head_simple()' cache/*.sh
+    atf_check -s eq:1 -o empty -e empty \
+        grep '_atf_static_head_dynamic()' cache/*.sh
+}
+
+atf_test_case test_case_names
+test_case_names_body()
+{
+    create_test_program tp <<EOF
+i=0
+while [ \${i} -lt 2000 ]; do
+    atf_test_case tc\${i}
+    i=\$((\${i} + 1))
+done
+tc1999_body() { echo "Running last"; }
+
+atf_init_test_cases()
+{
+    i=0
+    while [ \${i} -lt 2000 ]; do
+        atf_add_test_case tc\${i}
+        i=\$((\${i} + 1))
+    done
+    atf_add_test_case tc0
+}
+EOF
+    atf_check -s eq:0 -o save:stdout -e empty ./tp -l
+    atf_check -s eq:0 -o inline:'2000\n' -e empty \
+        -x "grep '^ident: ' stdout | wc -l | tr -d ' '"
+    atf_check -s eq:0 -o inline:'ident: tc0\n' -e empty \
+        -x "grep '^ident: ' stdout | head -n 1"
+    atf_check -s eq:0 -o inline:'ident: tc1999\n' -e empty \
+        -x "grep '^ident: ' stdout | tail -n 1"
+    atf_check -s eq:0 -o match:'Running last' -e ignore ./tp tc1999
+    atf_check -s eq:1 -o empty -e match:"Unknown test case \`tc2000'" \
+        ./tp tc2000
+
+    create_test_program tp <<EOF
+atf_init_test_cases()
+{
+    atf_add_test_case 'foo bar'
+}
+EOF
+    atf_check -s eq:1 -o empty -e match:"Invalid test case name \`foo bar'" \
+        ./tp -l
+
+    create_test_program tp <<EOF
+atf_test_case 'foo;bar'
+EOF
+    atf_check -s eq:1 -o empty -e match:"Invalid test case name \`foo;bar'" \
+        ./tp -l
+}
+
 atf_init_test_cases()
 {
     atf_add_test_case no_args
     atf_add_test_case missing_script
     atf_add_test_case arguments
+    atf_add_test_case cache
+    atf_add_test_case static_heads
+    atf_add_test_case test_case_names
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -99,6 +99,131 @@ atf_check_null_stderr_body()
     atf_check -s eq:0 -o empty -e empty -x 'echo "These are the contents" 1>&2'
 }
 
+atf_test_case atf_check_batch_ok
+atf_check_batch_ok_head()
+{
+    atf_set "descr" "Helper test case for the t_atf_check test program"
+}
+atf_check_batch_ok_body()
+{
+    atf_check_batch_add true
+    atf_check_batch_add -o inline:'a b\n' echo 'a b'
+    atf_check_batch_add -s exit:1 -x 'exit 1'
+    atf_check_batch_run 2
+    atf_check_batch_run
+    echo "Batch done"
+}
+
+atf_test_case atf_check_batch_fail
+atf_check_batch_fail_head()
+{
+    atf_set "descr" "Helper test case for the t_atf_check test program"
+}
+atf_check_batch_fail_body()
+{
+    atf_check_batch_add true
+    atf_check_batch_add echo foo
+    atf_check_batch_run
+    echo "Not reached"
+}
+
+atf_test_case atf_check_server
+atf_check_server_head()
+{
+    atf_set "descr" "Helper test case for the t_atf_check test program"
+}
+atf_check_server_body()
+{
+    atf_check_use_server
+    atf_check true
+    echo "Server: ${_atf_check_server_pid}"
+
+    mkdir dir
+    cd dir
+    atf_check -o match:'/dir$' pwd
+    cd ..
+
+    export FOO=bar
+    atf_check -o inline:'bar\n' -x 'echo ${FOO}'
+    unset FOO
+    atf_check -o inline:'\n' -x 'echo ${FOO}'
+    BAZ="a'b\"c d" atf_check -o inline:"a'b\"c d\\n" -x 'echo "${BAZ}"'
+
+    umask 0027
+    atf_check -o inline:'0027\n' -x umask
+
+    echo hello | atf_check -o inline:'hello\n' cat
+    atf_check -o inline:'file\n' cat <<EOF
+file
+EOF
+
+    output=$(atf_check -o ignore echo foo)
+    case "${output}" in
+        *"Executing command [ echo foo ]"*) ;;
+        *) atf_fail "Output of atf_check not captured" ;;
+    esac
+
+    atf_check -s exit:1 -x 'exit 1'
+    atf_check -o inline:'foo\n' echo foo
+    echo "Checks done"
+    atf_check false
+    echo "Not reached"
+}
+
+atf_test_case atf_check_server_bypass
+atf_check_server_bypass_head()
+{
+    atf_set "descr" "Helper test case for the t_atf_check test program"
+}
+atf_check_server_bypass_body()
+{
+    atf_check_use_server
+    atf_check true
+    echo "Server: ${_atf_check_server_pid}"
+
+    exec 3>fd3
+    atf_check -i -x 'echo hi >&3'
+    atf_check -s exit:1 -e match:'Bad file descriptor' -x 'echo hi >&3'
+    exec 3>&-
+    atf_check -o inline:'hi\n' cat fd3
+
+    echo in >fd9
+    exec 8>fd8 9<fd9
+    atf_check true
+    echo out >&8
+    read line <&9
+    exec 8>&- 9<&-
+    atf_check_equal in "${line}"
+    atf_check -o inline:'out\n' cat fd8
+
+    ( atf_check -o inline:'sub\n' echo sub )
+    atf_check -o inline:'async\n' echo async &
+    wait ${!}
+
+    ulimit -n 64
+    atf_check -o inline:'64\n' -x 'ulimit -n'
+    echo "Checks done"
+}
+
+atf_test_case atf_check_process_state
+atf_check_process_state_head()
+{
+    atf_set "descr" "Helper test case for the t_atf_check test program"
+}
+atf_check_process_state_body()
+{
+    trap '' USR1
+    atf_check -o inline:'survived\n' -x 'kill -USR1 $$; echo survived'
+    trap - USR1
+
+    if [ -n "${BASH_VERSION}" ]; then
+        exported_function() { echo "exported"; }
+        export -f exported_function
+        atf_check -o inline:'exported\n' -x exported_function
+    fi
+    echo "Checks done"
+}
+
 atf_test_case atf_check_equal_ok
 atf_check_equal_ok_head()
 {
@@ -253,6 +378,45 @@ tc_missing_body_head()
     atf_set "descr" "Helper test case for the t_tc test program"
 }
 
+# Waits for a file created by another test case running concurrently.
+wait_for_peer()
+{
+    i=0
+    while [ ! -f "${1}" ]; do
+        [ ${i} -lt 30 ] || atf_fail "The other test case did not run" \
+                                    "concurrently"
+        sleep 1
+        i=$((${i} + 1))
+    done
+}
+
+atf_test_case tc_parallel_a
+tc_parallel_a_head()
+{
+    atf_set "descr" "Helper test case for the t_tc test program"
+}
+tc_parallel_a_body()
+{
+    touch ../a.ready
+    wait_for_peer ../b.ready
+}
+
+atf_test_case tc_parallel_b cleanup
+tc_parallel_b_head()
+{
+    atf_set "descr" "Helper test case for the t_tc test program"
+}
+tc_parallel_b_body()
+{
+    touch ../b.ready
+    wait_for_peer ../a.ready
+    touch body.done
+}
+tc_parallel_b_cleanup()
+{
+    test -f body.done && touch ../b.cleanup.done
+}
+
 # -------------------------------------------------------------------------
 # Helper tests for "t_tp".
 # -------------------------------------------------------------------------
@@ -281,6 +445,11 @@ atf_init_test_cases()
     atf_add_test_case atf_check_experr_mismatch
     atf_add_test_case atf_check_null_stdout
     atf_add_test_case atf_check_null_stderr
+    atf_add_test_case atf_check_batch_ok
+    atf_add_test_case atf_check_batch_fail
+    atf_add_test_case atf_check_server
+    atf_add_test_case atf_check_server_bypass
+    atf_add_test_case atf_check_process_state
     atf_add_test_case atf_check_equal_ok
     atf_add_test_case atf_check_equal_fail
     atf_add_test_case atf_check_equal_eval_ok
@@ -300,6 +469,8 @@ atf_init_test_cases()
     atf_add_test_case tc_pass_return_error
     atf_add_test_case tc_fail
     atf_add_test_case tc_missing_body
+    atf_add_test_case tc_parallel_a
+    atf_add_test_case tc_parallel_b
 
     # Add helper tests for t_tp.
     [ -f $(atf_get_srcdir)/subrs ] && . $(atf_get_srcdir)/subrs
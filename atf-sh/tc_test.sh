@@ -55,10 +55,46 @@ missing_body_body()
     atf_check -s eq:1 -o ignore -e ignore ${h} tc_missing_body
 }
 
+atf_test_case parallel
+parallel_head()
+{
+    atf_set "descr" "Verifies that several test cases can be run at once," \
+                    "each in its own work directory"
+}
+parallel_body()
+{
+    h="$(atf_get_srcdir)/misc_helpers -s $(atf_get_srcdir)"
+    for i in 1 2; do
+        rm -f a.ready b.ready b.cleanup.done
+        atf_check -s eq:0 -o match:'^tc_parallel_a: passed$' \
+            -o match:'^tc_parallel_b: passed$' -e ignore \
+            ${h} -j 2 tc_parallel_a tc_parallel_b
+        test -f b.cleanup.done || \
+            atf_fail "Cleanup did not run in the work directory of its" \
+                "test case"
+        for d in *.work*; do
+            test ! -e "${d}" || atf_fail "Work directory ${d} not removed"
+        done
+    done
+
+    atf_check -s eq:1 -o empty -e match:'An error' \
+        ${h} -r results -j 1 tc_pass_true tc_fail
+    atf_check -s eq:0 -o inline:'passed\n' -e empty cat results.tc_pass_true
+    test ! -f results.tc_fail || atf_fail "Unexpected result for tc_fail"
+
+    atf_check -s eq:1 -o ignore -e match:'Cannot run test case parts' \
+        ${h} -j 2 tc_pass_true:cleanup
+    atf_check -s eq:1 -o ignore -e match:"Unknown test case \`foo'" \
+        ${h} -j 2 tc_pass_true foo
+    atf_check -s eq:1 -o ignore -e match:'Invalid number of jobs' \
+        ${h} -j 0 tc_pass_true
+}
+
 atf_init_test_cases()
 {
     atf_add_test_case default_status
     atf_add_test_case missing_body
+    atf_add_test_case parallel
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
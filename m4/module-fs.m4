@@ -66,4 +66,8 @@ AC_DEFUN([ATF_MODULE_FS], [
         AC_DEFINE([HAVE_GETCWD_DYN], [1],
                   [Define to 1 if getcwd(NULL, 0) works])
     fi
+
+    AC_CHECK_FUNCS([copy_file_range])
+    AC_CHECK_MEMBERS([struct stat.st_mtim, struct stat.st_ctim])
+    AC_CHECK_HEADERS([linux/fs.h])
 ])
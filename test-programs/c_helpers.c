@@ -383,6 +383,33 @@ ATF_TC_BODY(metadata_no_head, tc)
 {
 }
 
+struct metadata_param {
+    const char *name;
+    int value;
+};
+
+static const struct metadata_param metadata_params_list[] = {
+    { "one", 1 },
+    { "two", 2 },
+};
+
+ATF_TC(metadata_params);
+ATF_TC_HEAD(metadata_params, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Shared description");
+    atf_tc_set_md_var(tc, "timeout", "10");
+}
+ATF_TC_BODY(metadata_params, tc)
+{
+    const struct metadata_param *p = ATF_TC_PARAM(tc, struct metadata_param);
+    char ident[64];
+
+    snprintf(ident, sizeof(ident), "metadata_params/%s", p->name);
+    ATF_REQUIRE_STREQ(atf_tc_get_ident(tc), ident);
+    ATF_REQUIRE_STREQ(atf_tc_get_md_var(tc, "descr"), "Shared description");
+    printf("value: %d\n", p->value);
+}
+
 /* ---------------------------------------------------------------------
  * Helper tests for "t_srcdir".
  * --------------------------------------------------------------------- */
@@ -493,6 +520,7 @@ ATF_TP_ADD_TCS(tp)
     /* Add helper tests for t_meta_data. */
     ATF_TP_ADD_TC(tp, metadata_no_descr);
     ATF_TP_ADD_TC(tp, metadata_no_head);
+    ATF_TP_ADD_TC_PARAMS(tp, metadata_params, metadata_params_list, name);
 
     /* Add helper tests for t_srcdir. */
     ATF_TP_ADD_TC(tp, srcdir_exists);
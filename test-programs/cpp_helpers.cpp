@@ -241,6 +241,32 @@ ATF_TEST_CASE_BODY(metadata_no_head)
 {
 }
 
+struct metadata_param {
+    const char* name;
+    int value;
+};
+
+static const metadata_param metadata_params_list[] = {
+    { "one", 1 },
+    { "two", 2 },
+};
+
+ATF_TEST_CASE(metadata_params);
+ATF_TEST_CASE_HEAD(metadata_params)
+{
+    set_md_var("descr", "Shared description");
+    set_md_var("timeout", "10");
+}
+ATF_TEST_CASE_BODY(metadata_params)
+{
+    const metadata_param& p = get_param< metadata_param >();
+
+    ATF_REQUIRE_EQ(get_md_var("ident"),
+                   std::string("metadata_params/") + p.name);
+    ATF_REQUIRE_EQ(get_md_var("descr"), "Shared description");
+    std::cout << "value: " << p.value << "\n";
+}
+
 // ------------------------------------------------------------------------
 // Helper tests for "t_srcdir".
 // ------------------------------------------------------------------------
@@ -345,6 +371,8 @@ ATF_INIT_TEST_CASES(tcs)
     // Add helper tests for t_meta_data.
     ATF_ADD_TEST_CASE(tcs, metadata_no_descr);
     ATF_ADD_TEST_CASE(tcs, metadata_no_head);
+    ATF_ADD_TEST_CASE_PARAMS(tcs, metadata_params, metadata_params_list,
+                             name);
 
     // Add helper tests for t_srcdir.
     ATF_ADD_TEST_CASE(tcs, srcdir_exists);
@@ -55,10 +55,39 @@ no_head_body()
     done
 }
 
+atf_test_case params
+params_head()
+{
+    atf_set "descr" "Tests that parameterized test cases are expanded to" \
+                    "one instance per parameter that shares the metadata"
+}
+params_body()
+{
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:0 -o save:list -e ignore ${h} -s $(atf_get_srcdir) -l
+        for p in one two; do
+            atf_check -s eq:0 -o ignore -e ignore \
+                grep "^ident: metadata_params/${p}\$" list
+        done
+        atf_check -s eq:1 -o ignore -e ignore \
+            grep "^ident: metadata_params\$" list
+        atf_check -s eq:0 -o inline:"2\n" -e ignore \
+            grep -c "^descr: Shared description\$" list
+        atf_check -s eq:0 -o inline:"2\n" -e ignore \
+            grep -c "^timeout: 10\$" list
+
+        atf_check -s eq:0 -o match:"value: 2" -e ignore ${h} \
+            -s $(atf_get_srcdir) metadata_params/two
+        atf_check -s eq:1 -o empty -e match:"Unknown test case" ${h} \
+            -s $(atf_get_srcdir) metadata_params
+    done
+}
+
 atf_init_test_cases()
 {
     atf_add_test_case no_descr
     atf_add_test_case no_head
+    atf_add_test_case params
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4